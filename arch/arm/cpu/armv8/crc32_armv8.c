@@ -0,0 +1,23 @@
+/*
+ * crc32 using the ARMv8 CRC32 instructions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <asm/system.h>
+#include <u-boot/crc.h>
+
+uint32_t crc32_armv8_le(uint32_t crc, const unsigned char *p, size_t len);
+
+int crc32_armv8_disable __attribute__((section(".data")));
+
+int crc32_armv8(uint32_t *crc, const unsigned char *buf, uint len)
+{
+	if (crc32_armv8_disable || !cpu_has_isar0(ID_AA64ISAR0_CRC32_SHIFT))
+		return -ENOSYS;
+	*crc = crc32_armv8_le(*crc, buf, len);
+
+	return 0;
+}
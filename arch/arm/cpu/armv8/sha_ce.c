@@ -0,0 +1,37 @@
+/*
+ * SHA-1/SHA-256 using the ARMv8 Cryptography Extensions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <asm/system.h>
+#include <u-boot/sha_ce.h>
+
+void sha1_ce_transform(uint32_t state[5], const uint8_t *src,
+		       unsigned int blocks);
+void sha256_ce_transform(uint32_t state[8], const uint8_t *src,
+			 unsigned int blocks);
+
+int sha_ce_disable __attribute__((section(".data")));
+
+int sha1_ce_blocks(uint32_t state[5], const uint8_t *data,
+		   unsigned int blocks)
+{
+	if (sha_ce_disable || !cpu_has_isar0(ID_AA64ISAR0_SHA1_SHIFT))
+		return -ENOSYS;
+	sha1_ce_transform(state, data, blocks);
+
+	return 0;
+}
+
+int sha256_ce_blocks(uint32_t state[8], const uint8_t *data,
+		     unsigned int blocks)
+{
+	if (sha_ce_disable || !cpu_has_isar0(ID_AA64ISAR0_SHA2_SHIFT))
+		return -ENOSYS;
+	sha256_ce_transform(state, data, blocks);
+
+	return 0;
+}
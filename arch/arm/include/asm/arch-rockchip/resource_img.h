@@ -16,4 +16,12 @@
  */
 int rockchip_read_resource_file(void *buf, const char *name,
 				int offset, int len);
+
+/*
+ * locate file in resource partition
+ * @name: file name
+ * @blk: returns the first block of the file on the boot device
+ * @size: returns the size(by bytes) of the file
+ */
+int rockchip_get_resource_file_range(const char *name, u32 *blk, u32 *size);
 #endif
@@ -13,5 +13,7 @@
 
 int vendor_storage_read(u16 id, void *pbuf, u16 size);
 int vendor_storage_write(u16 id, void *pbuf, u16 size);
+/* write journaled items out as a full vendor copy */
+int vendor_storage_sync(void);
 
 #endif /* _ROCKCHIP_VENDOR_ */
@@ -32,6 +32,9 @@
 #include <asm/armv7.h>
 #endif
 #include <asm/setup.h>
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+#include <asm/arch/vendor.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -91,6 +94,9 @@ static void announce_and_cleanup(int fake)
 #ifdef CONFIG_USB_DEVICE
 	udc_disconnect();
 #endif
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	vendor_storage_sync();
+#endif
 
 	board_quiesce_devices();
 
@@ -4,182 +4,192 @@
  * SPDX-License-Identifier:     GPL-2.0+
  */
 
+/*
+ * Boot device access for the parameter, resource, kernel and vendor
+ * storage code.
+ *
+ * The boot device is looked up once as a driver model block device, so all
+ * reads go through blk_dread() (and the block cache, when enabled) whatever
+ * the media is.
+ *
+ * Boot code mostly reads small pieces one after the other: a header, then
+ * the data that follows it. A readahead window catches this: the first
+ * read that continues the previous one fills the window with a larger
+ * transfer, and following reads are served from it. The window doubles on
+ * each refill while the access stays sequential, up to
+ * CONFIG_ROCKCHIP_BLK_READAHEAD_SIZE bytes. Reads at least that large go
+ * straight to the caller's buffer. Any write or erase of the device, from
+ * here or elsewhere (fastboot, mmc write, gpt write, ...), drops the
+ * window.
+ */
+
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <mmc.h>
 #include <rknand.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <android_avb/avb_ops_user.h>
 #include "rockchip_blk.h"
 
-struct blkdev {
-	int if_type;
-	int devnum;
-	ulong (*write)(struct blkdev *blkdev, lbaint_t start, lbaint_t blkcnt, const void *buffer);
-	ulong (*read)(struct blkdev *blkdev, lbaint_t start, lbaint_t blkcnt, void *buffer);
-	void *priv;
+#define READAHEAD_MIN_BLKS	16
+
+struct blk_readahead {
+	char *buf;
+	lbaint_t max;		/* size of buf, in blocks */
+	lbaint_t window;	/* blocks read by the next refill */
+	lbaint_t start;		/* first block held in buf */
+	lbaint_t cnt;		/* blocks held in buf */
+	lbaint_t next;		/* block following the last read */
+	ulong write_gen;	/* blk_desc write_gen when buf was filled */
 };
 
-static struct blkdev *blkdev;
+static struct blk_desc *bootdev;
+static struct blk_readahead ra;
 
-struct mmc *mmcblk_dev_init(int dev)
+static struct blk_desc *rockchip_find_bootdev(int type)
 {
-	struct mmc *mmcdev;
+	struct udevice *dev __maybe_unused;
+	struct mmc *mmc;
 
-	mmcdev = find_mmc_device(dev);
-	if (!mmcdev) {
-		printf("no mmc device at slot %x\n", dev);
+	switch (type) {
+	case BOOT_FROM_EMMC:
+		mmc = find_mmc_device(0);
+		if (!mmc) {
+			printf("no mmc device at slot 0\n");
+			return NULL;
+		}
+		if (mmc_init(mmc))
+			return NULL;
+		return mmc_get_blk_desc(mmc);
+#ifdef CONFIG_RKNAND
+	case BOOT_FROM_FLASH:
+		if (rknand_scan_namespace())
+			return NULL;
+		return blk_get_devnum_by_type(IF_TYPE_RKNAND, 0);
+#endif
+#ifdef CONFIG_SPI_FLASH_BLK
+	case BOOT_FROM_SPI_NOR:
+		if (spi_flash_probe_bus_cs(0, 0, 0, 0, &dev)) {
+			printf("Failed to initialize SPI flash\n");
+			return NULL;
+		}
+		if (blk_get_from_parent(dev, &dev))
+			return NULL;
+		return dev_get_uclass_platdata(dev);
+#endif
+	default:
+		printf("boot device type %d not supported\n", type);
 		return NULL;
 	}
-
-	if (mmc_init(mmcdev))
-		return NULL;
-
-	return mmcdev;
 }
 
-static struct spi_flash *spi_flash_init(int dev)
+struct blk_desc *rockchip_get_bootdev(void)
 {
-	struct spi_flash *flash;
-	struct udevice *udev;
-	int ret;
+	if (bootdev)
+		return bootdev;
 
-	ret = spi_flash_probe_bus_cs(0, 0, 0, 0, &udev);
-	if (ret) {
-		printf("Failed to initialize SPI flash(error %d)\n", ret);
+	bootdev = rockchip_find_bootdev(get_bootdev_type());
+	if (!bootdev)
 		return NULL;
-	}
 
-	flash = dev_get_uclass_priv(udev);
-
-	return flash;
-}
-
-ulong blk_read(struct blkdev* blkdev, lbaint_t start, lbaint_t blkcnt, void *buffer)
-{
-	struct blk_desc *desc;
-	const char *if_name;
-	ulong n;
-
-	if_name = blk_get_if_type_name(blkdev->if_type);
-	desc = blk_get_dev(if_name, blkdev->devnum);
-	n = blk_dread(desc, start, blkcnt, buffer);
-
-	return n == blkcnt ? 0 : 1;
-}
-
-ulong blk_write(struct blkdev *blkdev, lbaint_t start, lbaint_t blkcnt, const void *buffer)
-{
-	struct blk_desc *desc;
-	const char *if_name;
-	ulong n;
-
-	if_name = blk_get_if_type_name(blkdev->if_type);
-	desc = blk_get_dev(if_name, blkdev->devnum);
-	n = blk_dwrite(desc, start, blkcnt, buffer);
+	ra.max = CONFIG_ROCKCHIP_BLK_READAHEAD_SIZE / bootdev->blksz;
+	if (ra.max) {
+		ra.buf = malloc_cache_aligned(ra.max * bootdev->blksz);
+		if (!ra.buf)
+			ra.max = 0;
+	}
+	ra.window = min_t(lbaint_t, READAHEAD_MIN_BLKS, ra.max);
 
-	return n == blkcnt ? 0 : 1;
+	return bootdev;
 }
 
-ulong sf_read(struct blkdev *blkdev, lbaint_t start, lbaint_t blkcnt, void *buffer)
+/*
+ * Refill the window at @blk, with at least the @cnt blocks asked for, and
+ * grow it while the reader stays sequential.
+ */
+static int readahead_fill(struct blk_desc *desc, lbaint_t blk, lbaint_t cnt)
 {
-	struct spi_flash *flash = (struct spi_flash *)blkdev->priv;
-	u32 offset = start << 9;
-	size_t len = blkcnt << 9;
+	lbaint_t n = min(max(ra.window, cnt), desc->lba - blk);
 
-	return spi_flash_read(flash, offset, len, buffer);
-}
-
-ulong sf_write(struct blkdev *blkdev, lbaint_t start, lbaint_t blkcnt, const void *buffer)
-{
-	struct spi_flash *flash = (struct spi_flash *)blkdev->priv;
-	u32 offset = start << 9;
-	size_t len = blkcnt << 9;
+	ra.cnt = 0;
+	if (blk_dread(desc, blk, n, ra.buf) != n)
+		return -EIO;
+	ra.write_gen = desc->write_gen;
+	ra.start = blk;
+	ra.cnt = n;
+	ra.window = min(ra.window * 2, ra.max);
 
-	return spi_flash_write(flash, offset, len, buffer);
+	return 0;
 }
 
-static int get_bootdev_if_type(int dev)
+int blkdev_read(void *buffer, u32 blk, u32 cnt)
 {
-	int if_type;
-
-	switch (dev) {
-	case BOOT_FROM_EMMC:
-		if_type = IF_TYPE_MMC;
-		break;
-	case BOOT_FROM_FLASH:
-		if_type = IF_TYPE_RKNAND;
-		break;
-	default:
-		if_type = dev;
-		break;
+	struct blk_desc *desc = rockchip_get_bootdev();
+	char *dst = buffer;
+	lbaint_t n;
+
+	if (!desc)
+		return -ENODEV;
+	if ((lbaint_t)blk + cnt > desc->lba)
+		return -EINVAL;
+
+	/* The device was written since the window was filled */
+	if (ra.write_gen != desc->write_gen)
+		ra.cnt = 0;
+
+	/* A seek starts over with a small window */
+	if (blk != ra.next)
+		ra.window = min_t(lbaint_t, READAHEAD_MIN_BLKS, ra.max);
+
+	while (cnt) {
+		if (ra.cnt && blk >= ra.start && blk < ra.start + ra.cnt) {
+			n = min_t(lbaint_t, cnt, ra.start + ra.cnt - blk);
+			memcpy(dst, ra.buf + (blk - ra.start) * desc->blksz,
+			       n * desc->blksz);
+		} else if (blk == ra.next && cnt < ra.max) {
+			if (readahead_fill(desc, blk, cnt))
+				return -EIO;
+			continue;
+		} else {
+			n = cnt;
+			if (blk_dread(desc, blk, n, dst) != n)
+				return -EIO;
+		}
+		blk += n;
+		cnt -= n;
+		dst += n * desc->blksz;
 	}
+	ra.next = blk;
 
-	return if_type;
+	return 0;
 }
 
-static struct blkdev *blkdev_init(void)
+int blkdev_write(void *buffer, u32 blk, u32 cnt)
 {
-	struct blkdev *blkdev;
-	int dev;
-	int if_type;
-	void *priv;
-
-
-	dev = get_bootdev_type();
-	if_type = get_bootdev_if_type(dev);
-
-	if (if_type == IF_TYPE_MMC) {
-		priv = mmcblk_dev_init(0);
-	} else if (if_type == IF_TYPE_RKNAND) {
-		priv = (void *)rknand_scan_namespace();
-	} else if (if_type == BOOT_FROM_SPI_NOR) {
-		priv = spi_flash_init(0);
-	}
+	struct blk_desc *desc = rockchip_get_bootdev();
 
-	blkdev = malloc(sizeof(*blkdev));
-	if (!blkdev) {
-		printf("out of memory for blkdev\n");
-		return NULL;
-	}
+	if (!desc)
+		return -ENODEV;
+	if ((lbaint_t)blk + cnt > desc->lba)
+		return -EINVAL;
 
-	blkdev->if_type = if_type;
-	blkdev->devnum = 0;
-	blkdev ->priv = priv;
-	if ((if_type == IF_TYPE_MMC) || (if_type == IF_TYPE_RKNAND)) {
-		blkdev->read = blk_read;
-		blkdev->write = blk_write;
-	} else if (if_type == BOOT_FROM_SPI_NOR) {
-		blkdev->read = sf_read;
-		blkdev->write = sf_write;
-	}
+	if (blk_dwrite(desc, blk, cnt, buffer) != cnt)
+		return -EIO;
 
-	return blkdev;
+	return 0;
 }
 
-int blkdev_read(void *buffer, u32 blk, u32 cnt)
+#ifdef CONFIG_AVB_LIBAVB_USER
+/* Verified boot reads its partitions from the boot device as well */
+struct blk_desc *avb_ops_user_get_blk(void)
 {
-	if (!blkdev) {
-		blkdev = blkdev_init();
-		if (!blkdev)
-			return -ENODEV;
-	}
-
-	return blkdev->read(blkdev, blk, cnt, buffer);
-}
-
-
-int blkdev_write(void *buffer, u32 blk, u32 cnt)
-{
-	if (!blkdev) {
-		blkdev = blkdev_init();
-		if (!blkdev)
-			return -ENODEV;
-	}
-
-	return blkdev->write(blkdev, blk, cnt, buffer);
+	return rockchip_get_bootdev();
 }
+#endif
 
 /* Gets the storage type of the current device */
 int get_bootdev_type(void)
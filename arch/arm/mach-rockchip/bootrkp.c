@@ -5,10 +5,15 @@
  */
 
 #include <common.h>
+#include <boot_plan.h>
 #include <bootm.h>
+#include <decomp_stream.h>
+#include <image.h>
 #include <linux/list.h>
 #include <libfdt.h>
 #include <malloc.h>
+#include <asm/unaligned.h>
+#include <u-boot/crc.h>
 #include <asm/arch/bootrkp.h>
 #include <asm/arch/resource_img.h>
 #include "rockchip_parameter.h"
@@ -78,7 +83,7 @@ static void boot_lmb_init(bootm_headers_t *images)
 }
 #endif
 
-static int read_boot_mode_from_misc(struct blk_part *misc)
+static int read_boot_mode_from_misc(disk_partition_t *misc)
 {
 	struct bootloader_message *bmsg;
 	int size = DIV_ROUND_UP(sizeof(struct bootloader_message),
@@ -86,7 +91,7 @@ static int read_boot_mode_from_misc(struct blk_part *misc)
 	int ret = 0;
 
 	bmsg = memalign(ARCH_DMA_MINALIGN, size);
-	ret = blkdev_read(bmsg, misc->from + BOOTLOADER_MESSAGE_BLK_OFFSET,
+	ret = blkdev_read(bmsg, misc->start + BOOTLOADER_MESSAGE_BLK_OFFSET,
 			  size >> 9);
 	if (ret < 0)
 		goto out;
@@ -104,57 +109,277 @@ out:
 	return ret;
 }
 
+/* Largest single transfer issued by the loader, 4MB */
+#define LOAD_CHUNK_BLKS			8192
+
+/* Transfer size for compressed images, 256KB, decompressed from the cache */
+#define STREAM_CHUNK_BLKS		512
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN		0x800000
+#endif
+
+/**
+ * struct load_item - one artifact in the bootrkp I/O plan
+ *
+ * @name: name for messages
+ * @blk: first block to read from the boot device
+ * @blks: number of blocks to read
+ * @dst: where the first block lands, i.e. the final load address
+ * @data: start of the image data covered by the crc
+ * @size: size(by bytes) of the image data
+ * @crc: crc of the bytes of @data already in memory
+ * @done: number of bytes of @data already covered by @crc
+ * @krnl: set for KRNL images, whose trailing crc32 is checked
+ * @comp: compression of the image data (IH_COMP_...); compressed images
+ *	are decompressed to @data while they are read
+ * @head: image data that came with the header, for compressed images
+ * @max: room at @data for the decompressed image
+ */
+struct load_item {
+	const char *name;
+	ulong blk;
+	ulong blks;
+	void *dst;
+	void *data;
+	ulong size;
+	uint32_t crc;
+	ulong done;
+	bool krnl;
+	int comp;
+	const void *head;
+	ulong max;
+};
+
 /*
  * non-OTA packaged kernel.img & boot.img
- * return the image size on success, and a
- * negative value on error.
+ *
+ * Only the first block is read here, to learn the image size. Where the
+ * image goes is decided by the caller, from the header, and set with
+ * place_rockchip_image().
  */
-static int read_rockchip_image(struct blk_part *part, void *dst)
+static int plan_rockchip_image(disk_partition_t *part, void *hdr_buf,
+			       struct load_item *item)
 {
-	struct rockchip_image *img;
-	int header_len = 8;
+	struct rockchip_image *img = hdr_buf;
 	int cnt;
 	int ret;
 
-	img = memalign(ARCH_DMA_MINALIGN, RK_BLK_SIZE);
-	if (!img) {
-		printf("out of memory\n");
-		return -ENOMEM;
-	}
-
 	/* read first block with header imformation */
-	ret = blkdev_read(img, part->from, 1);
-	if (ret < 0)
-		goto err;
+	ret = blkdev_read(img, part->start, 1);
+	if (ret)
+		return -EIO;
 	if (img->tag != TAG_KERNEL) {
 		printf("%s: invalid image tag(0x%x)\n", part->name, img->tag);
-		ret = -ENODEV;
-		goto err;
+		return -ENODEV;
 	}
 
-	memcpy(dst, img->image, RK_BLK_SIZE - header_len);
-	/*
-	 * read the rest blks
-	 * total size  = image size + 8 bytes header + 4 bytes crc32
-	 */
+	/* total size  = image size + 8 bytes header + 4 bytes crc32 */
 	cnt = DIV_ROUND_UP(img->size + 8 + 4, RK_BLK_SIZE);
-	ret = blkdev_read(dst + RK_BLK_SIZE - header_len,
-			  part->from + 1, cnt - 1);
-	if (!ret)
-		ret = img->size;
-err:
-	free(img);
-	return ret;
+
+	item->name = (const char *)part->name;
+	item->blk = part->start + 1;
+	item->blks = cnt - 1;
+	item->size = img->size;
+	item->krnl = true;
+	item->crc = 0;
+	item->done = 0;
+
+	return 0;
+}
+
+/*
+ * Put the image data that came with the header at @dst. The rest is left
+ * for load_items(), which reads it straight to @dst + (RK_BLK_SIZE - 8),
+ * right behind it.
+ */
+static void place_rockchip_image(struct load_item *item, void *hdr_buf,
+				 void *dst)
+{
+	struct rockchip_image *img = hdr_buf;
+	int header_len = 8;
+
+	memcpy(dst, img->image, RK_BLK_SIZE - header_len);
+	item->dst = dst + RK_BLK_SIZE - header_len;
+	item->data = dst;
+}
+
+/* Bytes an image item takes once loaded, from the start of its data */
+static ulong load_item_extent(struct load_item *item)
+{
+	return (item->blks + 1) * RK_BLK_SIZE;
+}
+
+static void load_item_crc(struct load_item *item, ulong avail)
+{
+	avail = min(avail, item->size);
+	if (!IS_ENABLED(CONFIG_ROCKCHIP_PARTITION_BOOT_CRC) || !item->krnl ||
+	    avail <= item->done)
+		return;
+
+	item->crc = crc32_rk(item->crc, item->data + item->done,
+			  avail - item->done);
+	item->done = avail;
+}
+
+/* Pick the stored crc, at [size, size + 4), out of @len bytes at @pos */
+static void load_item_stored_crc(u8 *crc, const u8 *buf, ulong pos,
+				 ulong len, ulong size)
+{
+	ulong i;
+
+	for (i = max(pos, size); i < min(pos + len, size + 4); i++)
+		crc[i - size] = buf[i - pos];
+}
+
+/*
+ * Read a compressed KRNL image through a small buffer and decompress each
+ * chunk as it comes in, straight to the load address. The crc covers the
+ * compressed data, so it is worked out on the chunks on the way.
+ */
+static int load_item_stream(struct load_item *item)
+{
+	struct decomp_stream ds;
+	ulong head = RK_BLK_SIZE - 8;
+	ulong blk = item->blk;
+	ulong left = item->blks;
+	ulong pos, len, use, out;
+	u8 stored[4] = { 0 };
+	char *buf;
+	int ret, err;
+
+	buf = memalign(ARCH_DMA_MINALIGN, STREAM_CHUNK_BLKS * RK_BLK_SIZE);
+	if (!buf) {
+		printf("%s: out of memory\n", item->name);
+		return -ENOMEM;
+	}
+	ret = decomp_stream_init(&ds, item->comp, item->data, item->max);
+	if (ret) {
+		printf("%s: cannot decompress (%d)\n", item->name, ret);
+		free(buf);
+		return ret;
+	}
+
+	/* Image offset of the first byte of each chunk */
+	pos = 0;
+	len = head;
+	use = min(len, item->size);
+	do {
+		const u8 *src = pos ? (u8 *)buf : item->head;
+
+		if (IS_ENABLED(CONFIG_ROCKCHIP_PARTITION_BOOT_CRC))
+			item->crc = crc32_rk(item->crc, src, use);
+		load_item_stored_crc(stored, src, pos, len, item->size);
+		ret = decomp_stream_write(&ds, src, use);
+		if (ret)
+			break;
+
+		pos += len;
+		if (!left)
+			break;
+		len = min_t(ulong, left, STREAM_CHUNK_BLKS);
+		ret = blkdev_read(buf, blk, len);
+		if (ret) {
+			ds.error = "read failed";
+			break;
+		}
+		blk += len;
+		left -= len;
+		len *= RK_BLK_SIZE;
+		use = pos < item->size ? min(len, item->size - pos) : 0;
+	} while (1);
+
+	err = decomp_stream_finish(&ds, &out);
+	free(buf);
+	if (ret || err) {
+		printf("%s: %s\n", item->name,
+		       ds.error ? ds.error : "stream truncated");
+		return ret ? ret : err;
+	}
+
+	if (IS_ENABLED(CONFIG_ROCKCHIP_PARTITION_BOOT_CRC) &&
+	    get_unaligned_le32(stored) != item->crc) {
+		printf("%s: crc32 mismatch (0x%08x != 0x%08x)\n",
+		       item->name, item->crc, get_unaligned_le32(stored));
+		return -EBADMSG;
+	}
+	printf("%s: %s image, 0x%08lx bytes decompressed\n", item->name,
+	       genimg_get_comp_name(item->comp), out);
+
+	return 0;
+}
+
+static int load_item_cmp(const void *a, const void *b)
+{
+	const struct load_item *ia = a;
+	const struct load_item *ib = b;
+
+	if (ia->blk == ib->blk)
+		return 0;
+	return ia->blk < ib->blk ? -1 : 1;
+}
+
+/*
+ * Read all items in block order, in chunks of up to LOAD_CHUNK_BLKS
+ * blocks, updating the crc of each KRNL image as its data lands.
+ */
+static int load_items(struct load_item *items, int num)
+{
+	struct load_item *item;
+	void *dst;
+	ulong blk, left, n;
+	uint32_t crc;
+	int i, ret;
+
+	qsort(items, num, sizeof(*items), load_item_cmp);
+
+	for (i = 0; i < num; i++) {
+		item = &items[i];
+		if (item->comp != IH_COMP_NONE) {
+			ret = load_item_stream(item);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		blk = item->blk;
+		dst = item->dst;
+		left = item->blks;
+		load_item_crc(item, dst - item->data);
+		while (left) {
+			n = min_t(ulong, left, LOAD_CHUNK_BLKS);
+			ret = blkdev_read(dst, blk, n);
+			if (ret) {
+				printf("%s: read failed\n", item->name);
+				return -EIO;
+			}
+			blk += n;
+			dst += n * RK_BLK_SIZE;
+			left -= n;
+			load_item_crc(item, dst - item->data);
+		}
+
+		if (!IS_ENABLED(CONFIG_ROCKCHIP_PARTITION_BOOT_CRC) ||
+		    !item->krnl)
+			continue;
+		crc = get_unaligned_le32(item->data + item->size);
+		if (crc != item->crc) {
+			printf("%s: crc32 mismatch (0x%08x != 0x%08x)\n",
+			       item->name, item->crc, crc);
+			return -EBADMSG;
+		}
+	}
+
+	return 0;
 }
 
 int rockchip_get_boot_mode(void)
 {
-	struct blk_part *misc;
+	disk_partition_t misc;
 	int boot_mode;
 
-	misc = rockchip_get_blk_part(PART_MISC);
-	if (misc)
-		boot_mode = read_boot_mode_from_misc(misc);
+	if (!rockchip_get_part_info(PART_MISC, &misc))
+		boot_mode = read_boot_mode_from_misc(&misc);
 	else
 		boot_mode = ANDROID_BOOT_MODE_RECOVERY;
 
@@ -167,41 +392,100 @@ static int do_bootrkp(cmd_tbl_t *cmdtp, int flag, int argc,
 	ulong fdt_addr_r = env_get_ulong("fdt_addr_r", 16, 0);
 	ulong ramdisk_addr_r = env_get_ulong("ramdisk_addr_r", 16, 0);
 	ulong kernel_addr_r = env_get_ulong("kernel_addr_r", 16, 0x480000);
-	struct blk_part *boot;
-	struct blk_part *kernel;
+	struct load_item items[3];
+	struct rockchip_image *img;
+	disk_partition_t boot;
+	disk_partition_t kernel;
+	void *hdr = NULL;
 	ulong ramdisk_size;
 	ulong kernel_size;
-	ulong fdt_size;
+	ulong addr;
+	u32 fdt_blk;
+	u32 fdt_size;
 	int boot_mode;
 	int ret = 0;
 
 	boot_mode = rockchip_get_boot_mode();
 
 	if (boot_mode == ANDROID_BOOT_MODE_RECOVERY)
-		boot = rockchip_get_blk_part(PART_RECOVERY);
+		ret = rockchip_get_part_info(PART_RECOVERY, &boot);
 	else
-		boot = rockchip_get_blk_part(PART_BOOT);
-	kernel = rockchip_get_blk_part(PART_KERNEL);
+		ret = rockchip_get_part_info(PART_BOOT, &boot);
+	if (!ret)
+		ret = rockchip_get_part_info(PART_KERNEL, &kernel);
 
-	if (!kernel || !boot) {
+	if (ret) {
 		ret = CMD_RET_FAILURE;
 		goto out;
 	}
 
-	kernel_size = read_rockchip_image(kernel, (void *)kernel_addr_r);
-	if (kernel_size < 0) {
+	/* The kernel header is kept, a compressed kernel starts in it */
+	hdr = memalign(ARCH_DMA_MINALIGN, 2 * RK_BLK_SIZE);
+	if (!hdr) {
+		printf("out of memory\n");
 		ret = CMD_RET_FAILURE;
 		goto out;
 	}
 
-	ramdisk_size = read_rockchip_image(boot, (void *)ramdisk_addr_r);
-	if (ramdisk_size < 0) {
+	/*
+	 * Ask the planner where each piece goes before reading it, so that
+	 * booti finds them where it wants them and copies nothing.
+	 */
+	memset(items, 0, sizeof(items));
+	boot_plan_init();
+	img = hdr;
+	if (plan_rockchip_image(&kernel, img, &items[0])) {
 		ret = CMD_RET_FAILURE;
 		goto out;
 	}
+	if (IS_ENABLED(CONFIG_DECOMP_STREAM))
+		items[0].comp = decomp_stream_detect(img->image,
+						     RK_BLK_SIZE - 8);
+	if (items[0].comp != IH_COMP_NONE) {
+		/* Its Image header is only seen once it is decompressed */
+		addr = boot_plan_kernel(kernel_addr_r, NULL,
+					CONFIG_SYS_BOOTM_LEN);
+		if (addr)
+			kernel_addr_r = addr;
+		items[0].head = img->image;
+		items[0].data = (void *)kernel_addr_r;
+		items[0].max = CONFIG_SYS_BOOTM_LEN;
+	} else {
+		addr = boot_plan_kernel(kernel_addr_r, img->image,
+					load_item_extent(&items[0]));
+		if (addr)
+			kernel_addr_r = addr;
+		place_rockchip_image(&items[0], img, (void *)kernel_addr_r);
+	}
 
-	fdt_size = rockchip_read_resource_file((void *)fdt_addr_r, DTB_FILE, 0, 0);
-	if (fdt_size < 0) {
+	if (plan_rockchip_image(&boot, hdr + RK_BLK_SIZE, &items[1])) {
+		ret = CMD_RET_FAILURE;
+		goto out;
+	}
+	addr = boot_plan_ramdisk(ramdisk_addr_r, load_item_extent(&items[1]));
+	if (addr)
+		ramdisk_addr_r = addr;
+	place_rockchip_image(&items[1], hdr + RK_BLK_SIZE,
+			     (void *)ramdisk_addr_r);
+	kernel_size = items[0].size;
+	ramdisk_size = items[1].size;
+
+	if (rockchip_get_resource_file_range(DTB_FILE, &fdt_blk, &fdt_size)) {
+		ret = CMD_RET_FAILURE;
+		goto out;
+	}
+	addr = boot_plan_fdt(fdt_addr_r, fdt_size);
+	if (addr)
+		fdt_addr_r = addr;
+	items[2].name = DTB_FILE;
+	items[2].blk = fdt_blk;
+	items[2].blks = DIV_ROUND_UP(fdt_size, RK_BLK_SIZE);
+	items[2].dst = (void *)fdt_addr_r;
+	items[2].data = items[2].dst;
+	items[2].size = fdt_size;
+	items[2].krnl = false;
+
+	if (load_items(items, ARRAY_SIZE(items))) {
 		ret = CMD_RET_FAILURE;
 		goto out;
 	}
@@ -223,6 +507,7 @@ static int do_bootrkp(cmd_tbl_t *cmdtp, int flag, int argc,
 	do_bootm_linux(0, 0, NULL, &images);
 #endif
 out:
+	free(hdr);
 	return ret;
 }
 
@@ -89,12 +89,55 @@ struct resource_file {
 	char		name[MAX_FILE_NAME_LEN];
 	uint32_t	f_offset;
 	uint32_t	f_size;
+	struct resource_cache *cache;
+	struct hlist_node hash;
+};
+
+/**
+ * struct resource_cache - file data kept in RAM
+ *
+ * @file: the file this data belongs to
+ * @data: copy of the first @len bytes of the file
+ * @len: number of bytes cached, counted from the start of the file
+ * @link: node in cache_head, most recently used first
+ */
+struct resource_cache {
+	struct resource_file *file;
+	void		*data;
+	int		len;
 	struct list_head link;
 };
 
-static struct blk_part *rsce_blk;
+#define RESOURCE_HASH_BITS		6
+#define RESOURCE_HASH_SIZE		(1 << RESOURCE_HASH_BITS)
+
+static disk_partition_t rsce_part;
+
+/*
+ * The entries are read once from storage and kept in an array, indexed by
+ * a hash of the file name. rsce_state is 0 before the first read, then the
+ * number of valid entries, or a negative error if there is no usable
+ * resource image.
+ */
+static struct resource_file *rsce_files;
+static struct hlist_head rsce_hash[RESOURCE_HASH_SIZE];
+static int rsce_state;
+
+static LIST_HEAD(cache_head);
+static int cache_used;
 
-static LIST_HEAD(entrys_head);
+/* FNV-1a */
+static uint32_t resource_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash & (RESOURCE_HASH_SIZE - 1);
+}
 
 static int resource_image_check_header(const struct resource_img_hdr *hdr)
 {
@@ -117,23 +160,19 @@ static int resource_image_check_header(const struct resource_img_hdr *hdr)
 	return ret;
 }
 
-static int add_file_to_list(struct resource_entry *entry)
+static int add_file_to_index(struct resource_entry *entry,
+			     struct resource_file *file)
 {
-	struct resource_file *file;
-
 	if (memcmp(entry->tag, ENTRY_TAG, ENTRY_TAG_SIZE)) {
 		printf("invalid entry tag\n");
 		return -ENOENT;
 	}
-	file = malloc(sizeof(*file));
-	if (!file) {
-		printf("out of memory\n");
-		return -ENOMEM;
-	}
-	strcpy(file->name, entry->name);
+	strlcpy(file->name, entry->name, sizeof(file->name));
 	file->f_offset = entry->f_offset;
 	file->f_size = entry->f_size;
-	list_add_tail(&file->link, &entrys_head);
+	file->cache = NULL;
+	hlist_add_head(&file->hash,
+		       &rsce_hash[resource_name_hash(file->name)]);
 	debug("entry:%p  %s offset:%d size:%d\n",
 	      entry, file->name, file->f_offset, file->f_size);
 
@@ -148,9 +187,9 @@ static int read_file_info_from_blk_dev(void)
 	int size;
 	int ret;
 	int e_num;
+	int nums = 0;
 
-	rsce_blk = rockchip_get_blk_part(PART_RESOURCE);
-	if (!rsce_blk) {
+	if (rockchip_get_part_info(PART_RESOURCE, &rsce_part)) {
 		printf("no resource partition found\n");
 		return  -ENODEV;
 	}
@@ -161,49 +200,64 @@ static int read_file_info_from_blk_dev(void)
 		return -ENOMEM;
 	}
 
-	ret = blkdev_read(hdr, rsce_blk->from, 1);
-	if (ret < 0)
+	ret = blkdev_read(hdr, rsce_part.start, 1);
+	if (ret) {
+		ret = -EIO;
 		goto out;
+	}
 	ret = resource_image_check_header(hdr);
 	if (ret < 0)
 		goto out;
 	content = memalign(ARCH_DMA_MINALIGN,
 			   hdr->e_blks * hdr->e_nums * RK_BLK_SIZE);
-	if (!content) {
+	rsce_files = calloc(hdr->e_nums, sizeof(*rsce_files));
+	if (!content || !rsce_files) {
 		printf("alloc memory for content failed\n");
-		goto out;
+		ret = -ENOMEM;
+		goto err;
 	}
-	ret = blkdev_read(content, rsce_blk->from + hdr->c_offset,
+	ret = blkdev_read(content, rsce_part.start + hdr->c_offset,
 			  hdr->e_blks * hdr->e_nums);
-	if (ret < 0)
+	if (ret) {
+		ret = -EIO;
 		goto err;
+	}
 
 	for (e_num = 0; e_num < hdr->e_nums; e_num++) {
 		size = e_num * hdr->e_blks * RK_BLK_SIZE;
 		entry = (struct resource_entry *)(content + size);
-		add_file_to_list(entry);
+		if (!add_file_to_index(entry, &rsce_files[nums]))
+			nums++;
 	}
+	ret = nums;
 
 err:
+	if (ret <= 0) {
+		free(rsce_files);
+		rsce_files = NULL;
+	}
 	free(content);
 out:
 	free(hdr);
 
-	return 0;
+	return ret;
 }
 
-static struct resource_file *get_file_info(struct resource_img_hdr *hdr,
-					   const void *content,
-					   const char *name)
+static struct resource_file *get_file_info(const char *name)
 {
 	struct resource_file *file;
-	struct list_head *node;
+	struct hlist_node *node;
 
-	if (list_empty(&entrys_head))
-		read_file_info_from_blk_dev();
+	if (!rsce_state) {
+		rsce_state = read_file_info_from_blk_dev();
+		if (!rsce_state)
+			rsce_state = -ENOENT;
+	}
+	if (rsce_state < 0)
+		return NULL;
 
-	list_for_each(node, &entrys_head) {
-		file = list_entry(node, struct resource_file, link);
+	hlist_for_each_entry(file, node, &rsce_hash[resource_name_hash(name)],
+			     hash) {
 		if (!strcmp(file->name, name))
 			return file;
 	}
@@ -211,6 +265,65 @@ static struct resource_file *get_file_info(struct resource_img_hdr *hdr,
 	return NULL;
 }
 
+static void resource_cache_drop(struct resource_cache *cache)
+{
+	list_del(&cache->link);
+	cache->file->cache = NULL;
+	cache_used -= cache->len;
+	free(cache->data);
+	free(cache);
+}
+
+/* Copy the wanted part of @file to @buf if it is held in the cache */
+static int resource_cache_read(struct resource_file *file, void *buf,
+			       int offset, int len)
+{
+	struct resource_cache *cache = file->cache;
+	int start = offset * RK_BLK_SIZE;
+
+	if (!cache || start + len > cache->len)
+		return -ENOENT;
+
+	memcpy(buf, cache->data + start, len);
+	list_move(&cache->link, &cache_head);
+
+	return 0;
+}
+
+/*
+ * Keep a copy of data just read from the start of @file, evicting the least
+ * recently used files until it fits in CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE.
+ */
+static void resource_cache_add(struct resource_file *file, const void *buf,
+			       int offset, int len)
+{
+	struct resource_cache *cache;
+
+	if (offset || len > CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE)
+		return;
+	if (file->cache)
+		resource_cache_drop(file->cache);
+	while (cache_used + len > CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE) {
+		cache = list_entry(cache_head.prev, struct resource_cache, link);
+		resource_cache_drop(cache);
+	}
+
+	cache = malloc(sizeof(*cache));
+	if (!cache)
+		return;
+	cache->data = malloc(len);
+	if (!cache->data) {
+		free(cache);
+		return;
+	}
+	memcpy(cache->data, buf, len);
+	cache->file = file;
+	cache->len = len;
+	file->cache = cache;
+	cache_used += len;
+	list_add(&cache->link, &cache_head);
+}
+
 /*
  * read file from resource partition
  * @buf: destination buf to store file data;
@@ -225,7 +338,7 @@ int rockchip_read_resource_file(void *buf, const char *name,
 	int ret = 0;
 	int blks;
 
-	file = get_file_info(NULL, NULL, name);
+	file = get_file_info(name);
 	if (!file) {
 		printf("Can't find file:%s\n", name);
 		return -ENOENT;
@@ -233,10 +346,39 @@ int rockchip_read_resource_file(void *buf, const char *name,
 
 	if (len <= 0 || len > file->f_size)
 		len = file->f_size;
+	if (CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE &&
+	    !resource_cache_read(file, buf, offset, len))
+		return len;
+
 	blks = DIV_ROUND_UP(len, RK_BLK_SIZE);
-	ret = blkdev_read(buf, rsce_blk->from + file->f_offset + offset, blks);
-	if (!ret)
+	ret = blkdev_read(buf, rsce_part.start + file->f_offset + offset, blks);
+	if (!ret) {
+		if (CONFIG_ROCKCHIP_RESOURCE_CACHE_SIZE)
+			resource_cache_add(file, buf, offset, len);
 		ret = len;
+	}
 
 	return ret;
 }
+
+/*
+ * locate file in resource partition
+ * @name: file name
+ * @blk: returns the first block of the file on the boot device
+ * @size: returns the size(by bytes) of the file
+ */
+int rockchip_get_resource_file_range(const char *name, u32 *blk, u32 *size)
+{
+	struct resource_file *file;
+
+	file = get_file_info(name);
+	if (!file) {
+		printf("Can't find file:%s\n", name);
+		return -ENOENT;
+	}
+
+	*blk = rsce_part.start + file->f_offset;
+	*size = file->f_size;
+
+	return 0;
+}
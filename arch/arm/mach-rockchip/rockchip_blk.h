@@ -17,4 +17,10 @@ int blkdev_read(void *buffer, u32 blk, u32 cnt);
 int blkdev_write(void *buffer, u32 blk, u32 cnt);
 int get_bootdev_type(void);
 
+/*
+ * get the block device backing blkdev_read(), NULL if the boot
+ * device cannot be found
+ */
+struct blk_desc *rockchip_get_bootdev(void);
+
 #endif
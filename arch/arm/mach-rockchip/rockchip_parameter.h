@@ -7,19 +7,15 @@
 #ifndef _ROCKCHIP_PARAMS_H_
 #define _ROCKCHIP_PARAMS_H_
 
-#include <linux/list.h>
+#include <part.h>
 
-#define RK_PARAM_OFFSET			0x2000
-#define PART_NAME_SIZE			32
 #define RK_BLK_SIZE			(1 << 9)
 
-struct blk_part {
-	char name[PART_NAME_SIZE];
-	unsigned long from;
-	unsigned long size;
-	struct list_head node;
-};
-
-struct blk_part *rockchip_get_blk_part(const char *name);
+/*
+ * get a partition of the boot device from the rockchip parameter
+ * @name: partition name
+ * @info: returns the partition start and size, in blocks
+ */
+int rockchip_get_part_info(const char *name, disk_partition_t *info);
 
 #endif
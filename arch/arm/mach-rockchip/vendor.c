@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <malloc.h>
+#include <vendor_journal.h>
 #include <asm/arch/vendor.h>
 
 #include "rockchip_blk.h"
@@ -44,6 +45,8 @@
 /* #define VENDOR_STORAGE_TEST */
 #ifdef VENDOR_STORAGE_TEST
 int vendor_storage_test(void);
+/* Run the test once, it calls vendor_storage_init() again itself */
+static bool vendor_tested;
 #endif /* VENDOR_STORAGE_TEST */
 
 struct vendor_item {
@@ -97,10 +100,34 @@ struct vendor_info {
 #define FLASH_VENDOR_HASH_OFFSET (FLASH_VENDOR_INFO_SIZE - 8)
 #define FLASH_VENDOR_VERSION2_OFFSET (FLASH_VENDOR_INFO_SIZE - 4)
 
+/*
+ * id -> item lookup table, built at init. Open addressing on the low id
+ * bits, each slot holds the item index + 1 (0: empty slot).
+ */
+#define VENDOR_INDEX_SIZE	256
+
 /* vendor info */
 static struct vendor_info vendor_info;
 /* The storage type of the device */
 static int bootdev_type;
+/* blocks of each vendor copy */
+static u16 vendor_part_blks;
+static u8 vendor_index[VENDOR_INDEX_SIZE];
+
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+/*
+ * Item updates are appended to a journal in the free space of the vendor
+ * copy they were made against (the base copy), from the first block after
+ * its data up to, but not including, the block holding version2. Only
+ * when the journal is full, or on vendor_storage_sync(), is a new full
+ * copy written and the journal restarted behind it.
+ */
+static struct vendor_journal vendor_journal;
+/* vendor copy the journal belongs to */
+static u16 journal_part;
+/* first block of the journal in that copy */
+static u16 journal_offset;
+#endif
 
 /**********************************************************/
 /*              vendor API implementation                 */
@@ -156,6 +183,118 @@ static int vendor_ops(u8 *buffer, u32 addr, u32 n_sec, int write)
 	return ret;
 }
 
+static void vendor_index_add(u16 id, int index)
+{
+	u32 i = id % VENDOR_INDEX_SIZE;
+
+	while (vendor_index[i])
+		i = (i + 1) % VENDOR_INDEX_SIZE;
+	vendor_index[i] = index + 1;
+}
+
+static void vendor_index_build(void)
+{
+	int i;
+
+	memset(vendor_index, 0, sizeof(vendor_index));
+	for (i = 0; i < vendor_info.hdr->item_num; i++)
+		vendor_index_add(vendor_info.item[i].id, i);
+}
+
+static struct vendor_item *vendor_find_item(u16 id)
+{
+	struct vendor_item *item;
+	u32 i = id % VENDOR_INDEX_SIZE;
+
+	while (vendor_index[i]) {
+		item = vendor_info.item + vendor_index[i] - 1;
+		if (item->id == id)
+			return item;
+		i = (i + 1) % VENDOR_INDEX_SIZE;
+	}
+
+	return NULL;
+}
+
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+static int vendor_journal_write(struct vendor_journal *vj, u32 blk, u32 cnt,
+				const void *buf)
+{
+	return vendor_ops((u8 *)buf, vendor_part_blks * journal_part +
+			  journal_offset + blk, cnt, 1);
+}
+
+/* Attach an empty journal, as large as it can be, to the copy @part */
+static void vendor_journal_attach(u16 part)
+{
+	u32 data_end = (u32)(vendor_info.data - (u8 *)vendor_info.hdr) +
+		       vendor_info.hdr->free_offset;
+
+	journal_part = part;
+	journal_offset = DIV_ROUND_UP(data_end, VENDOR_BLOCK_SIZE);
+	vendor_journal.write = vendor_journal_write;
+	vendor_journal_reset(&vendor_journal, vendor_info.hdr->version,
+			     journal_offset < vendor_part_blks - 1 ?
+			     vendor_part_blks - 1 - journal_offset : 0);
+}
+
+/*
+ * SPI NOR is written through the sf block layer, which erases and rewrites
+ * the whole erase sector around each append, base copy included. That is
+ * no safer than writing a full copy, so take no more records there: those
+ * already in the journal are folded into the next copy.
+ */
+static void vendor_journal_limit(void)
+{
+	if (bootdev_type == BOOT_FROM_SPI_NOR)
+		vendor_journal.blks = vendor_journal.used;
+}
+
+/* Attach an empty journal to the copy @part, which matches vendor_info */
+static void vendor_journal_start(u16 part)
+{
+	vendor_journal_attach(part);
+	vendor_journal_limit();
+}
+
+static int vendor_item_update(u16 id, const void *pbuf, u16 size);
+
+static int vendor_journal_apply(void *ctx, u16 id, const void *data,
+				u16 size)
+{
+	return vendor_item_update(id, data, size);
+}
+
+/*
+ * Attach the journal to the copy @part just read into vendor_info and
+ * replay its records. The journal area is copied out first, as applying
+ * records may allocate item data over it.
+ */
+static void vendor_journal_load(u16 part)
+{
+	u32 len;
+	u8 *buf;
+
+	vendor_journal_attach(part);
+	len = vendor_journal.blks * VENDOR_BLOCK_SIZE;
+	if (!len)
+		return;
+
+	buf = malloc(len);
+	if (!buf) {
+		/* Can't replay, so don't append behind unknown records */
+		vendor_journal.used = vendor_journal.blks;
+		return;
+	}
+	memcpy(buf, (u8 *)vendor_info.hdr + journal_offset * VENDOR_BLOCK_SIZE,
+	       len);
+	vendor_journal_replay(&vendor_journal, buf, vendor_info.hdr->version,
+			      vendor_journal.blks, vendor_journal_apply, NULL);
+	free(buf);
+	vendor_journal_limit();
+}
+#endif
+
 /*
  * The VendorStorage partition is divided into four parts
  * (vendor 0-3) and its structure is shown in the following figure.
@@ -213,6 +352,7 @@ int vendor_storage_init(void)
 	/* Invalid bootdev type */
 	if (ret)
 		return ret;
+	vendor_part_blks = part_size;
 	/* Always use, no need to release */
 	buffer = (u8 *)malloc(size);
 	if (!buffer) {
@@ -248,6 +388,11 @@ int vendor_storage_init(void)
 		 */
 		if (max_index != (VENDOR_PART_NUM - 1))
 			ret = vendor_ops((u8 *)vendor_info.hdr, part_size * max_index, part_size, 0);
+		vendor_index_build();
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+		if (!ret)
+			vendor_journal_load(max_index);
+#endif
 	} else {
 		debug("[Vednor INFO]:Reset vendor info...\n");
 		memset((u8 *)vendor_info.hdr, 0, size);
@@ -256,12 +401,16 @@ int vendor_storage_init(void)
 		/* data field length */
 		vendor_info.hdr->free_size = ((u32)vendor_info.hash - (u32)vendor_info.data);
 		*(vendor_info.version2) = vendor_info.hdr->version;
+		vendor_index_build();
 	}
 	debug("[Vednor INFO]:ret=%d.\n", ret);
 
 #ifdef VENDOR_STORAGE_TEST
-	if (vendor_storage_test())
-		printf("[Vendor ERROR]:Vendor test result:failure\n");
+	if (!vendor_tested) {
+		vendor_tested = true;
+		if (vendor_storage_test())
+			printf("[Vendor ERROR]:Vendor test result:failure\n");
+	}
 #endif
 
 	return ret;
@@ -270,8 +419,6 @@ int vendor_storage_init(void)
 int vendor_storage_read(u16 id, void *pbuf, u16 size)
 {
 	int ret = 0;
-	u32 i;
-	u16 offset;
 	struct vendor_item *item;
 
 	/* init vendor storage */
@@ -281,77 +428,52 @@ int vendor_storage_read(u16 id, void *pbuf, u16 size)
 			return ret;
 	}
 
-	item = vendor_info.item;
-	for (i = 0; i < vendor_info.hdr->item_num; i++) {
-		if ((item + i)->id == id) {
-			debug("[Vednor INFO]:Find the matching item, id=%d\n", id);
-			/* Correct the size value */
-			if (size > (item + i)->size)
-				size = (item + i)->size;
-			offset = (item + i)->offset;
-			memcpy(pbuf, (vendor_info.data + offset), size);
-			return size;
-		}
+	item = vendor_find_item(id);
+	if (item) {
+		debug("[Vednor INFO]:Find the matching item, id=%d\n", id);
+		/* Correct the size value */
+		if (size > item->size)
+			size = item->size;
+		memcpy(pbuf, (vendor_info.data + item->offset), size);
+		return size;
 	}
 	debug("[Vednor ERROR]:No matching item, id=%d\n", id);
 
 	return -EINVAL;
 }
 
-int vendor_storage_write(u16 id, void *pbuf, u16 size)
+/* Update or create an item in vendor_info, without writing it out */
+static int vendor_item_update(u16 id, const void *pbuf, u16 size)
 {
-	int ret = 0;
-	u32 i, next_index, align_size;
+	u32 align_size;
 	struct vendor_item *item;
-	u16 part_size, max_item_num, offset;
-
-	/* init vendor storage */
-	if (!bootdev_type) {
-		ret = vendor_storage_init();
-		if (ret)
-			return ret;
-	}
+	u16 max_item_num;
 
 	switch (bootdev_type) {
 	case BOOT_FROM_EMMC:
-		part_size = EMMC_VENDOR_PART_BLKS;
 		max_item_num = EMMC_VENDOR_ITEM_NUM;
 		break;
 	case BOOT_FROM_FLASH:
 	case BOOT_FROM_SPI_NOR:
 	case BOOT_FROM_SPI_NAND:
-		part_size = FLASH_VENDOR_PART_BLKS;
 		max_item_num = FLASH_VENDOR_ITEM_NUM;
 		break;
 	default:
-		ret = -ENODEV;
-		break;
+		return -ENODEV;
 	}
-	/* Invalid bootdev? */
-	if (ret)
-		return ret;
 
-	next_index = vendor_info.hdr->next_index;
 	/* algin to 64 bytes*/
 	align_size = (size + VENDOR_BTYE_ALIGN) & (~VENDOR_BTYE_ALIGN);
 	if (size > align_size)
 		return -EINVAL;
 
-	item = vendor_info.item;
 	/* If item already exist, update the item data */
-	for (i = 0; i < vendor_info.hdr->item_num; i++) {
-		if ((item + i)->id == id) {
-			debug("[Vednor INFO]:Find the matching item, id=%d\n", id);
-			offset = (item + i)->offset;
-			memcpy((vendor_info.data + offset), pbuf, size);
-			(item + i)->size = size;
-			vendor_info.hdr->version++;
-			*(vendor_info.version2) = vendor_info.hdr->version;
-			vendor_info.hdr->next_index++;
-			if (vendor_info.hdr->next_index >= VENDOR_PART_NUM)
-				vendor_info.hdr->next_index = 0;
-			return vendor_ops((u8 *)vendor_info.hdr, part_size * next_index, part_size, 1);
-		}
+	item = vendor_find_item(id);
+	if (item) {
+		debug("[Vednor INFO]:Find the matching item, id=%d\n", id);
+		memcpy((vendor_info.data + item->offset), pbuf, size);
+		item->size = size;
+		return 0;
 	}
 	/*
 	 * If item does not exist, and free size is enough,
@@ -368,20 +490,77 @@ int vendor_storage_write(u16 id, void *pbuf, u16 size)
 		vendor_info.hdr->free_offset += align_size;
 		vendor_info.hdr->free_size -= align_size;
 		memcpy((vendor_info.data + item->offset), pbuf, size);
+		vendor_index_add(id, vendor_info.hdr->item_num);
 		vendor_info.hdr->item_num++;
-		vendor_info.hdr->version++;
-		vendor_info.hdr->next_index++;
-		*(vendor_info.version2) = vendor_info.hdr->version;
-		if (vendor_info.hdr->next_index >= VENDOR_PART_NUM)
-			vendor_info.hdr->next_index = 0;
-
-		return vendor_ops((u8 *)vendor_info.hdr, part_size * next_index, part_size, 1);
+		return 0;
 	}
 	debug("[Vednor ERROR]:Vendor has no space left!\n");
 
 	return -ENOMEM;
 }
 
+/* Write vendor_info out as the next vendor copy */
+static int vendor_commit(void)
+{
+	u32 next_index;
+	int ret;
+
+	next_index = vendor_info.hdr->next_index;
+	vendor_info.hdr->version++;
+	*(vendor_info.version2) = vendor_info.hdr->version;
+	vendor_info.hdr->next_index++;
+	if (vendor_info.hdr->next_index >= VENDOR_PART_NUM)
+		vendor_info.hdr->next_index = 0;
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	/* Don't carry old journal records over into the new copy */
+	memset(vendor_info.data + vendor_info.hdr->free_offset, 0,
+	       vendor_info.hdr->free_size);
+#endif
+
+	ret = vendor_ops((u8 *)vendor_info.hdr, vendor_part_blks * next_index,
+			 vendor_part_blks, 1);
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	if (!ret)
+		vendor_journal_start(next_index);
+#endif
+
+	return ret;
+}
+
+int vendor_storage_write(u16 id, void *pbuf, u16 size)
+{
+	int ret = 0;
+
+	/* init vendor storage */
+	if (!bootdev_type) {
+		ret = vendor_storage_init();
+		if (ret)
+			return ret;
+	}
+
+	ret = vendor_item_update(id, pbuf, size);
+	if (ret)
+		return ret;
+
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	ret = vendor_journal_append(&vendor_journal, id, pbuf, size);
+	if (ret != -ENOSPC)
+		return ret;
+#endif
+
+	return vendor_commit();
+}
+
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+int vendor_storage_sync(void)
+{
+	if (!bootdev_type || !vendor_journal.used)
+		return 0;
+
+	return vendor_commit();
+}
+#endif
+
 /**********************************************************/
 /*              vendor API uinit test                      */
 /**********************************************************/
@@ -419,17 +598,166 @@ void vendor_test_reset(void)
 	vendor_info.hdr->free_size =
 		((u32)vendor_info.hash - (u32)vendor_info.data);
 	*(vendor_info.version2) = vendor_info.hdr->version;
+	/*
+	 * vendor_storage_init() picks the first of these equal copies, so
+	 * the journal goes there and the next full copy behind it.
+	 */
+	vendor_info.hdr->next_index = 1;
 	/* write to flash. */
 	for (i = 0; i < VENDOR_PART_NUM; i++)
 		vendor_ops((u8 *)vendor_info.hdr, part_size * i, part_size, 1);
+	vendor_index_build();
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	vendor_journal_start(0);
+#endif
+}
+
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+/* Read the vendor storage again, as after a reboot */
+static int vendor_test_reinit(void)
+{
+	free(vendor_info.hdr);
+	bootdev_type = 0;
+
+	return vendor_storage_init();
+}
+
+/* Check that item @id holds @size bytes of @val */
+static int vendor_test_check(u16 id, u8 val, u16 size)
+{
+	u8 buffer[64];
+	int ret, j;
+
+	ret = vendor_storage_read(id, buffer, size);
+	if (ret != size) {
+		printf("[Vendor Test]:vendor read failed(id=%d)!\n", id);
+		return -EIO;
+	}
+	for (j = 0; j < size; j++) {
+		if (buffer[j] != val) {
+			printf("[Vendor Test]:Unexpected data(id=%d)\n", id);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
 }
 
 /*
- * A total of four tests
+ * Journal test: items written to the journal come back after a reboot,
+ * and a full journal or vendor_storage_sync() writes a new full copy
+ * which comes back with an empty journal.
+ */
+static int vendor_test_journal(void)
+{
+	u8 buffer[64];
+	u32 version, i;
+	u16 id, used;
+	int ret;
+
+	vendor_test_reset();
+	version = vendor_info.hdr->version;
+
+	/* No journal on SPI NOR: every write is a full copy */
+	if (bootdev_type == BOOT_FROM_SPI_NOR) {
+		memset(buffer, 0x10, sizeof(buffer));
+		ret = vendor_storage_write(0, buffer, sizeof(buffer));
+		if (ret)
+			return ret;
+		if (vendor_info.hdr->version != version + 1 ||
+		    vendor_journal.used) {
+			printf("[Vendor Test]:Write went to the journal\n");
+			return -EINVAL;
+		}
+		return vendor_test_check(0, 0x10, sizeof(buffer));
+	}
+
+	/* Replay: new and updated items only go to the journal */
+	for (id = 0; id < 4; id++) {
+		memset(buffer, id + 0x10, sizeof(buffer));
+		ret = vendor_storage_write(id, buffer, sizeof(buffer));
+		if (ret)
+			return ret;
+	}
+	memset(buffer, 0x55, sizeof(buffer));
+	ret = vendor_storage_write(1, buffer, sizeof(buffer));
+	if (ret)
+		return ret;
+	used = vendor_journal.used;
+	if (vendor_info.hdr->version != version || used != 5) {
+		printf("[Vendor Test]:Writes did not go to the journal\n");
+		return -EINVAL;
+	}
+	ret = vendor_test_reinit();
+	if (ret)
+		return ret;
+	if (vendor_info.hdr->version != version ||
+	    vendor_journal.used != used || vendor_info.hdr->item_num != 4) {
+		printf("[Vendor Test]:Journal replay failed\n");
+		return -EINVAL;
+	}
+	for (id = 0; id < 4; id++) {
+		ret = vendor_test_check(id, id == 1 ? 0x55 : id + 0x10,
+					sizeof(buffer));
+		if (ret)
+			return ret;
+	}
+
+	/* Commit: a full journal is folded into the next copy */
+	for (i = 0; i <= vendor_journal.blks; i++) {
+		memset(buffer, i, sizeof(buffer));
+		ret = vendor_storage_write(0, buffer, sizeof(buffer));
+		if (ret)
+			return ret;
+		if (vendor_info.hdr->version != version)
+			break;
+	}
+	if (vendor_info.hdr->version != version + 1 || journal_part != 1 ||
+	    vendor_journal.used) {
+		printf("[Vendor Test]:Full journal was not committed\n");
+		return -EINVAL;
+	}
+	ret = vendor_test_reinit();
+	if (ret)
+		return ret;
+	if (vendor_info.hdr->version != version + 1 || journal_part != 1 ||
+	    vendor_journal.used) {
+		printf("[Vendor Test]:Committed copy not found\n");
+		return -EINVAL;
+	}
+	ret = vendor_test_check(0, i, sizeof(buffer));
+	if (!ret)
+		ret = vendor_test_check(1, 0x55, sizeof(buffer));
+	if (ret)
+		return ret;
+
+	/* Sync: the journal is folded in on request */
+	memset(buffer, 0xaa, sizeof(buffer));
+	ret = vendor_storage_write(2, buffer, sizeof(buffer));
+	if (!ret)
+		ret = vendor_storage_sync();
+	if (ret)
+		return ret;
+	ret = vendor_test_reinit();
+	if (ret)
+		return ret;
+	if (vendor_info.hdr->version != version + 2 || journal_part != 2 ||
+	    vendor_journal.used) {
+		printf("[Vendor Test]:Sync did not write a full copy\n");
+		return -EINVAL;
+	}
+
+	return vendor_test_check(2, 0xaa, sizeof(buffer));
+}
+#endif
+
+/*
+ * A total of five tests
  * 1.All items test.
  * 2.Overrides the maximum number of items test.
  * 3.Single Item memory overflow test.
  * 4.Total memory overflow test.
+ * 5.Journal replay and commit test (ROCKCHIP_VENDOR_JOURNAL).
  */
 int vendor_storage_test(void)
 {
@@ -593,6 +921,15 @@ int vendor_storage_test(void)
 		debug("\t#id=%03d success,data=0x%02x,size=%d.\n", id, *buffer, size);
 	}
 
+#ifdef CONFIG_ROCKCHIP_VENDOR_JOURNAL
+	/* FIFTH TEST: Journal replay and commit test */
+	printf("[Vendor Test]:<Journal> Test Start...\n");
+	if (!vendor_test_journal())
+		printf("[Vendor Test]:<Journal> Test End, States:OK\n");
+	else
+		printf("[Vendor Test]:<Journal> Test End, States:Failed\n");
+#endif
+
 	/* Test end */
 	printf("[Vendor Test]:After Test, Vendor Resetting...\n");
 	vendor_test_reset();
@@ -14,6 +14,9 @@
 #include <bootm.h>
 #include <command.h>
 #include <android_bootloader_message.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 static int do_boot_android(cmd_tbl_t *cmdtp, int flag, int argc,
 			   char * const argv[])
@@ -708,6 +711,12 @@ int do_avb_flow(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	verify_flag = argv[1][0];
 	if (verify_flag == 'v') {
 		debug("start with verify!\n");
+		/* Verify boot where it runs from, up to below our stack */
+		load_address = CONFIG_SYS_LOAD_ADDR;
+		avb_ops_user_set_load_buffer(ops, requested_partitions[0],
+					     (void *)load_address,
+					     gd->start_addr_sp - SZ_1M -
+					     load_address);
 		if (avb_ab_flow(ops->ab_ops,
 				requested_partitions,
 				flags,
@@ -726,13 +735,14 @@ int do_avb_flow(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		strcat(avb_root_data, " ");
 		strcat(avb_root_data, slot_data->cmdline);
 		env_set("bootargs", avb_root_data);
-		load_address = CONFIG_SYS_LOAD_ADDR;
 		if (avb_close_optee_client())
 			printf("Can not close optee client!\n");
 
-		memcpy((uint8_t*)load_address,
-		       slot_data->loaded_partitions->data,
-		       slot_data->loaded_partitions->data_size);
+		/* Unless it was verified in place */
+		if (slot_data->loaded_partitions->data != (uint8_t *)load_address)
+			memcpy((uint8_t *)load_address,
+			       slot_data->loaded_partitions->data,
+			       slot_data->loaded_partitions->data_size);
 		android_bootloader_boot_kernel(load_address);
 	} else if (verify_flag == 'n') {
 		load_address = CONFIG_SYS_LOAD_ADDR;
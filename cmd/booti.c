@@ -8,6 +8,7 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <errno.h>
 #include <image.h>
 #include <lmb.h>
 #include <mapmem.h>
@@ -32,18 +33,14 @@ struct Image_header {
 
 #define LINUX_ARM64_IMAGE_MAGIC	0x644d5241
 
-static int booti_setup(bootm_headers_t *images)
+int booti_image_dest(ulong ep, const void *hdr, ulong *dst, ulong *size)
 {
-	struct Image_header *ih;
-	uint64_t dst;
+	const struct Image_header *ih = hdr;
 	uint64_t image_size, text_offset;
+	uint64_t base;
 
-	ih = (struct Image_header *)map_sysmem(images->ep, 0);
-
-	if (ih->magic != le32_to_cpu(LINUX_ARM64_IMAGE_MAGIC)) {
-		puts("Bad Linux ARM64 Image magic!\n");
-		return 1;
-	}
+	if (ih->magic != le32_to_cpu(LINUX_ARM64_IMAGE_MAGIC))
+		return -EINVAL;
 
 	/*
 	 * Prior to Linux commit a2c1d73b94ed, the text_offset field
@@ -51,7 +48,6 @@ static int booti_setup(bootm_headers_t *images)
 	 * field is zero, and we can assume a fixed value of 0x80000.
 	 */
 	if (ih->image_size == 0) {
-		puts("Image lacks image_size field, assuming 16MiB\n");
 		image_size = 16 << 20;
 		text_offset = 0x80000;
 	} else {
@@ -66,18 +62,37 @@ static int booti_setup(bootm_headers_t *images)
 	 * since memory below it is not accessible via the linear mapping.
 	 */
 	if (le64_to_cpu(ih->flags) & BIT(3))
-		dst = images->ep - text_offset;
+		base = ep - text_offset;
 	else
-		dst = gd->bd->bi_dram[0].start;
+		base = gd->bd->bi_dram[0].start;
+
+	*dst = ALIGN(base, SZ_2M) + text_offset;
+	*size = image_size;
+
+	return 0;
+}
 
-	dst = ALIGN(dst, SZ_2M) + text_offset;
+static int booti_setup(bootm_headers_t *images)
+{
+	struct Image_header *ih;
+	ulong dst, image_size;
+	int ret;
 
+	ih = (struct Image_header *)map_sysmem(images->ep, 0);
+	ret = booti_image_dest(images->ep, ih, &dst, &image_size);
+	if (!ret && ih->image_size == 0)
+		puts("Image lacks image_size field, assuming 16MiB\n");
 	unmap_sysmem(ih);
 
+	if (ret) {
+		puts("Bad Linux ARM64 Image magic!\n");
+		return 1;
+	}
+
 	if (images->ep != dst) {
 		void *src;
 
-		debug("Moving Image from 0x%lx to 0x%llx\n", images->ep, dst);
+		debug("Moving Image from 0x%lx to 0x%lx\n", images->ep, dst);
 
 		src = (void *)images->ep;
 		images->ep = dst;
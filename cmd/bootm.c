@@ -9,6 +9,7 @@
  * Boot support
  */
 #include <common.h>
+#include <boot_plan.h>
 #include <bootm.h>
 #include <command.h>
 #include <environment.h>
@@ -53,6 +54,10 @@ static cmd_tbl_t cmd_bootm_sub[] = {
 	U_BOOT_CMD_MKENT(prep, 0, 1, (void *)BOOTM_STATE_OS_PREP, "", ""),
 	U_BOOT_CMD_MKENT(fake, 0, 1, (void *)BOOTM_STATE_OS_FAKE_GO, "", ""),
 	U_BOOT_CMD_MKENT(go, 0, 1, (void *)BOOTM_STATE_OS_GO, "", ""),
+#ifdef CONFIG_BOOT_PLAN
+	/* Not a state: only shows the boot plan */
+	U_BOOT_CMD_MKENT(plan, 0, 1, (void *)0, "", ""),
+#endif
 };
 
 static int do_bootm_subcommand(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -67,6 +72,12 @@ static int do_bootm_subcommand(cmd_tbl_t *cmdtp, int flag, int argc,
 
 	if (c) {
 		state = (long)c->cmd;
+#ifdef CONFIG_BOOT_PLAN
+		if (!state) {
+			boot_plan_print();
+			return 0;
+		}
+#endif
 		if (state == BOOTM_STATE_START)
 			state |= BOOTM_STATE_FINDOS | BOOTM_STATE_FINDOTHER;
 	} else {
@@ -188,7 +199,12 @@ static char bootm_help_text[] =
 #if defined(CONFIG_TRACE)
 	"\tfake    - OS specific fake start without go\n"
 #endif
-	"\tgo      - start OS";
+	"\tgo      - start OS"
+#if defined(CONFIG_BOOT_PLAN)
+	"\n\nbootm plan\n"
+	"    - show where the last loader placed kernel, ramdisk and fdt"
+#endif
+	;
 #endif
 
 U_BOOT_CMD(
@@ -5,6 +5,11 @@
  */
 
 #include <common.h>
+#include <fs.h>
+#include <mapmem.h>
+
+/* Default buffer size for 'bootstage export' */
+#define BOOTSTAGE_EXPORT_SIZE	0x10000
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -39,6 +44,7 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 			      char * const argv[])
 {
 	ulong base, size;
+	void *buf;
 	int ret;
 
 	if (get_base_size(argc, argv, &base, &size))
@@ -48,20 +54,67 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 		return 1;
 	}
 
+	buf = map_sysmem(base, size);
 	if (0 == strcmp(argv[0], "stash"))
-		ret = bootstage_stash((void *)base, size);
+		ret = bootstage_stash(buf, size);
 	else
-		ret = bootstage_unstash((void *)base, size);
+		ret = bootstage_unstash(buf, size);
+	unmap_sysmem(buf);
 	if (ret)
 		return 1;
 
 	return 0;
 }
 
+static int do_bootstage_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	ulong base, size = BOOTSTAGE_EXPORT_SIZE;
+	loff_t written;
+	char *endp;
+	void *buf;
+	int len;
+
+	if (argc != 2 && argc != 3 && argc != 6)
+		return CMD_RET_USAGE;
+	base = simple_strtoul(argv[1], &endp, 16);
+	if (*argv[1] == 0 || *endp != 0)
+		return CMD_RET_USAGE;
+	if (argc > 2) {
+		size = simple_strtoul(argv[2], &endp, 16);
+		if (*argv[2] == 0 || *endp != 0)
+			return CMD_RET_USAGE;
+	}
+
+	buf = map_sysmem(base, size);
+	len = bootstage_export_json(buf, size);
+	unmap_sysmem(buf);
+	if (len >= size) {
+		printf("Trace needs %#x bytes but only %#lx are available\n",
+		       len + 1, size);
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", len);
+	if (argc < 6)
+		return 0;
+
+	if (fs_set_blk_dev(argv[3], argv[4], FS_TYPE_ANY))
+		return CMD_RET_FAILURE;
+	if (fs_write(argv[5], base, 0, len, &written) < 0) {
+		printf("Cannot write '%s'\n", argv[5]);
+		return CMD_RET_FAILURE;
+	}
+	printf("%llu bytes written to '%s'\n", (unsigned long long)written,
+	       argv[5]);
+
+	return 0;
+}
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(export, 6, 0, do_bootstage_export, "", ""),
 };
 
 /*
@@ -86,10 +139,13 @@ static int do_boostage(cmd_tbl_t *cmdtp, int flag, int argc,
 }
 
 
-U_BOOT_CMD(bootstage, 4, 1, do_boostage,
+U_BOOT_CMD(bootstage, 7, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"export <addr> [<size> [<interface> <dev[:part]> <filename>]]\n"
+	"    - Write a Chrome/Perfetto trace (JSON) to memory, setting\n"
+	"      'filesize', and optionally to a file"
 );
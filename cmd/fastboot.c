@@ -10,6 +10,7 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <fastboot.h>
 #include <g_dnl.h>
 #include <net.h>
 #include <usb.h>
@@ -68,6 +69,7 @@ static int do_fastboot(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
 		if (ctrlc())
 			break;
 		usb_gadget_handle_interrupts(controller_index);
+		fastboot_poll();
 	}
 
 	ret = CMD_RET_SUCCESS;
@@ -42,6 +42,8 @@ void set_working_fdt_addr(ulong addr)
 	void *buf;
 
 	buf = map_sysmem(addr, 0);
+	/* A new tree may have been loaded where the old one was */
+	fdt_cache_invalidate(buf);
 	working_fdt = buf;
 	env_set_hex("fdtaddr", addr);
 }
@@ -0,0 +1,225 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Boot artifact placement planner.
+ *
+ * The plan starts from the memory bootm may use, as boot_start_lmb() sets
+ * it up, and reserves each piece as it is placed so that the pieces and
+ * U-Boot itself never overlap. Pieces are placed where the final bootm
+ * steps want them: the kernel where booti runs it, the ramdisk below
+ * initrd_high and the FDT below fdt_high with room to grow. Those steps
+ * then check boot_plan_placed() and use the data where it is.
+ */
+
+#include <common.h>
+#include <boot_plan.h>
+#include <bootm.h>
+#include <environment.h>
+#include <image.h>
+#include <lmb.h>
+
+struct boot_plan_entry {
+	ulong want;		/* address the loader asked for */
+	ulong addr;		/* address given out, 0 if none */
+	ulong size;		/* bytes reserved at addr */
+	const char *note;	/* how the address was picked */
+};
+
+static struct {
+	struct lmb lmb;
+	struct boot_plan_entry item[BOOT_PLAN_COUNT];
+	bool ready;
+} plan;
+
+static const char * const boot_plan_name[BOOT_PLAN_COUNT] = {
+	[BOOT_PLAN_KERNEL]	= "kernel",
+	[BOOT_PLAN_RAMDISK]	= "ramdisk",
+	[BOOT_PLAN_FDT]		= "fdt",
+};
+
+void boot_plan_init(void)
+{
+	memset(&plan, 0, sizeof(plan));
+	lmb_init(&plan.lmb);
+	lmb_add(&plan.lmb, env_get_bootm_low(), env_get_bootm_size());
+	arch_lmb_reserve(&plan.lmb);
+	board_lmb_reserve(&plan.lmb);
+	plan.ready = true;
+}
+
+void boot_plan_reserve(ulong addr, ulong size)
+{
+	if (plan.ready && size)
+		lmb_reserve(&plan.lmb, addr, size);
+}
+
+/* Check that [addr, addr + size) is memory nobody else uses */
+static bool boot_plan_free(ulong addr, ulong size)
+{
+	struct lmb_property *rgn;
+	bool in_mem = false;
+	int i;
+
+	for (i = 0; i < plan.lmb.memory.cnt; i++) {
+		rgn = &plan.lmb.memory.region[i];
+		if (addr >= rgn->base && addr + size <= rgn->base + rgn->size)
+			in_mem = true;
+	}
+	if (!in_mem)
+		return false;
+
+	for (i = 0; i < plan.lmb.reserved.cnt; i++) {
+		rgn = &plan.lmb.reserved.region[i];
+		if (addr < rgn->base + rgn->size && addr + size > rgn->base)
+			return false;
+	}
+
+	return true;
+}
+
+static struct boot_plan_entry *boot_plan_start(enum boot_plan_item item,
+					       ulong want, ulong size)
+{
+	struct boot_plan_entry *e = &plan.item[item];
+
+	if (!plan.ready)
+		boot_plan_init();
+	e->want = want;
+	e->addr = 0;
+	e->size = size;
+	e->note = NULL;
+
+	return e;
+}
+
+/*
+ * Place @e at its wanted address if that is free and below @high, else
+ * below @high wherever there is room. A @high of ~0 means the data is used
+ * where it is anyway, 0 means there is no limit.
+ */
+static ulong boot_plan_place(struct boot_plan_entry *e, ulong high,
+			     const char *limit)
+{
+	ulong addr;
+
+	if (boot_plan_free(e->want, e->size) &&
+	    (high == ~0UL || !high || e->want + e->size <= high)) {
+		addr = e->want;
+		lmb_reserve(&plan.lmb, addr, e->size);
+		e->note = "in place";
+	} else if (high == ~0UL) {
+		/* The loader still puts it at @want, keep others off it */
+		boot_plan_reserve(e->want, e->size);
+		e->note = "not free";
+		return 0;
+	} else {
+		/* As bootm would allocate it, which reserves it as well */
+		if (high)
+			addr = lmb_alloc_base(&plan.lmb, e->size, 0x1000,
+					      high);
+		else
+			addr = lmb_alloc(&plan.lmb, e->size, 0x1000);
+		if (!addr) {
+			boot_plan_reserve(e->want, e->size);
+			e->note = "no room";
+			return 0;
+		}
+		e->note = limit;
+	}
+	e->addr = addr;
+
+	return addr;
+}
+
+ulong boot_plan_kernel(ulong want, const void *hdr, ulong size)
+{
+	struct boot_plan_entry *e = boot_plan_start(BOOT_PLAN_KERNEL, want,
+						    size);
+	ulong addr = want;
+
+#ifdef CONFIG_CMD_BOOTI
+	if (hdr && !booti_image_dest(want, hdr, &addr, &size))
+		e->size = size;
+#endif
+	/* Only booti moves the kernel, and only to one place */
+	if (!boot_plan_free(addr, e->size)) {
+		/* The loader still puts it at @want, keep others off it */
+		boot_plan_reserve(want, size);
+		e->note = "not free, left to bootm";
+		return 0;
+	}
+
+	lmb_reserve(&plan.lmb, addr, e->size);
+	e->addr = addr;
+	e->note = addr == want ? "in place" : "at Image text_offset";
+
+	return addr;
+}
+
+/* Get the limit set by environment variable @name, as bootm reads it */
+static ulong boot_plan_high(const char *name)
+{
+	const char *s = env_get(name);
+
+	if (s)
+		return simple_strtoul(s, NULL, 16);
+
+	return env_get_bootm_mapsize() + env_get_bootm_low();
+}
+
+ulong boot_plan_ramdisk(ulong want, ulong size)
+{
+	struct boot_plan_entry *e = boot_plan_start(BOOT_PLAN_RAMDISK, want,
+						    size);
+
+	return boot_plan_place(e, boot_plan_high("initrd_high"),
+			       "below initrd_high");
+}
+
+ulong boot_plan_fdt(ulong want, ulong size)
+{
+	struct boot_plan_entry *e = boot_plan_start(BOOT_PLAN_FDT, want,
+						    size + CONFIG_SYS_FDT_PAD);
+
+	return boot_plan_place(e, boot_plan_high("fdt_high"),
+			       "below fdt_high");
+}
+
+bool boot_plan_placed(enum boot_plan_item item, ulong addr, ulong size)
+{
+	struct boot_plan_entry *e = &plan.item[item];
+
+	return plan.ready && e->addr && addr == e->addr && size <= e->size;
+}
+
+void boot_plan_print(void)
+{
+	struct lmb_property *rgn;
+	struct boot_plan_entry *e;
+	int i;
+
+	if (!plan.ready) {
+		printf("No boot plan\n");
+		return;
+	}
+
+	printf("Item      Wanted      Placed      Size        Decision\n");
+	for (i = 0; i < BOOT_PLAN_COUNT; i++) {
+		e = &plan.item[i];
+		if (!e->note)
+			continue;
+		printf("%-9s 0x%08lx  0x%08lx  0x%08lx  %s\n", boot_plan_name[i],
+		       e->want, e->addr, e->size, e->note);
+	}
+
+	printf("\nReserved:\n");
+	for (i = 0; i < plan.lmb.reserved.cnt; i++) {
+		rgn = &plan.lmb.reserved.region[i];
+		printf("  0x%08lx - 0x%08lx\n", (ulong)rgn->base,
+		       (ulong)(rgn->base + rgn->size));
+	}
+}
@@ -11,14 +11,17 @@
  */
 
 #include <common.h>
+#include <initcall.h>
 #include <libfdt.h>
 #include <malloc.h>
+#include <dm/util.h>
 #include <linux/compiler.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_BOOTSTAGE_RECORD_COUNT,
+	SPAN_COUNT = CONFIG_BOOTSTAGE_SPAN_COUNT,
 };
 
 struct bootstage_record {
@@ -29,15 +32,37 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+/**
+ * struct bootstage_span - one bootstage_start()/bootstage_accum() pair
+ *
+ * Accumulator records only hold the total time, so each activity is also
+ * kept here, to show when it happened and what it was nested inside.
+ *
+ * @start_us: Time when bootstage_start() was called
+ * @duration_us: Time from then until bootstage_accum() was called
+ * @id: Bootstage id of the activity, whose record holds the name
+ * @depth: Number of other activities that were open at the time
+ */
+struct bootstage_span {
+	uint32_t start_us;
+	uint32_t duration_us;
+	uint16_t id;
+	uint16_t depth;
+};
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
+	uint span_count;	/* Number of spans, may exceed SPAN_COUNT */
+	uint depth;		/* Number of activities now open */
 	struct bootstage_record record[RECORD_COUNT];
+	struct bootstage_span span[SPAN_COUNT];
 };
 
 enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
+	BOOTSTAGE_SPAN_MAGIC	= 0xb0075a45,
 	BOOTSTAGE_DIGITS	= 9,
 };
 
@@ -48,6 +73,15 @@ struct bootstage_hdr {
 	uint32_t magic;		/* Unused */
 };
 
+/*
+ * Spans are stashed after the name strings, so that readers which only know
+ * about the records still work.
+ */
+struct bootstage_span_hdr {
+	uint32_t magic;		/* BOOTSTAGE_SPAN_MAGIC */
+	uint32_t count;		/* Number of spans */
+};
+
 int bootstage_relocate(void)
 {
 	struct bootstage_data *data = gd->bootstage;
@@ -178,20 +212,39 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name)
 		rec->start_us = start_us;
 		rec->name = name;
 	}
+	data->depth++;
 
 	return start_us;
 }
 
+static void add_span(struct bootstage_data *data, enum bootstage_id id,
+		     uint32_t start_us, uint32_t duration_us)
+{
+	struct bootstage_span *span;
+
+	if (data->span_count < SPAN_COUNT) {
+		span = &data->span[data->span_count];
+		span->start_us = start_us;
+		span->duration_us = duration_us;
+		span->id = id;
+		span->depth = data->depth;
+	}
+	data->span_count++;
+}
+
 uint32_t bootstage_accum(enum bootstage_id id)
 {
 	struct bootstage_data *data = gd->bootstage;
 	struct bootstage_record *rec = ensure_id(data, id);
 	uint32_t duration;
 
+	if (data->depth)
+		data->depth--;
 	if (!rec)
 		return 0;
 	duration = (uint32_t)timer_get_boot_us() - rec->start_us;
 	rec->time_us += duration;
+	add_span(data, id, rec->start_us, duration);
 
 	return duration;
 }
@@ -293,6 +346,11 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	if (dm_timing_add_fdt(blob, bootstage, i) < 0)
+		return -EINVAL;
+#endif
+
 	return 0;
 }
 
@@ -335,6 +393,167 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(rec, -1);
 	}
+	if (data->span_count > SPAN_COUNT)
+		printf("Only the first %d activities were recorded - please increase CONFIG_BOOTSTAGE_SPAN_COUNT\n",
+		       SPAN_COUNT);
+
+	initcall_report();
+}
+
+/**
+ * struct json_buf - Output buffer for bootstage_export_json()
+ *
+ * @ptr: Next position to write to
+ * @end: End of the buffer
+ * @len: Number of bytes output so far, including those that did not fit
+ * @events: Number of events output so far
+ */
+struct json_buf {
+	char *ptr;
+	char *end;
+	int len;
+	int events;
+};
+
+static void json_putc(struct json_buf *out, char ch)
+{
+	if (out->ptr < out->end)
+		*out->ptr++ = ch;
+	out->len++;
+}
+
+static void json_printf(struct json_buf *out, const char *fmt, ...)
+{
+	char buf[80];
+	va_list args;
+	int i, len;
+
+	va_start(args, fmt);
+	len = vscnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	for (i = 0; i < len; i++)
+		json_putc(out, buf[i]);
+}
+
+static void json_string(struct json_buf *out, const char *str)
+{
+	json_putc(out, '"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			json_putc(out, '\\');
+		if ((uchar)*str >= ' ')
+			json_putc(out, *str);
+	}
+	json_putc(out, '"');
+}
+
+/**
+ * json_event() - Start a trace event with the fields that all events have
+ *
+ * The caller adds any other fields and then closes the event with '}'.
+ *
+ * @out: Output buffer
+ * @name: Name of the event
+ * @cat: Category of the event
+ * @phase: Type of event, e.g. 'X' for one with a duration
+ * @tid: Thread to show the event in
+ * @time_us: Time of the event in microseconds
+ */
+static void json_event(struct json_buf *out, const char *name,
+		       const char *cat, char phase, int tid, ulong time_us)
+{
+	json_printf(out, "%s\n{\"name\":", out->events++ ? "," : "");
+	json_string(out, name);
+	json_printf(out, ",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%lu",
+		    cat, phase, tid, time_us);
+}
+
+static void json_thread_name(struct json_buf *out, int tid, const char *name)
+{
+	json_event(out, "thread_name", "__metadata", 'M', tid, 0);
+	json_printf(out, ",\"args\":{\"name\":");
+	json_string(out, name);
+	json_printf(out, "}}");
+}
+
+static void json_add_initcalls(struct json_buf *out)
+{
+#if CONFIG_IS_ENABLED(BOOTSTAGE_INITCALL)
+	struct initcall_record *rec;
+	__maybe_unused ulong base;
+	const char *name;
+	char buf[20];
+	uint count, i;
+
+	count = min_t(uint, gd->initcall_count,
+		      CONFIG_BOOTSTAGE_INITCALL_COUNT);
+	if (!count)
+		return;
+	json_thread_name(out, 2, "initcalls");
+	for (i = 0, rec = gd->initcall_rec; i < count; i++, rec++) {
+		name = NULL;
+#ifdef CONFIG_KALLSYMS
+		name = symbol_lookup(rec->func, &base);
+#endif
+		if (!name) {
+			snprintf(buf, sizeof(buf), "%08lx", rec->func);
+			name = buf;
+		}
+		json_event(out, name, "initcall", 'X', 2, rec->start_us);
+		json_printf(out, ",\"dur\":%u}", rec->duration_us);
+	}
+#endif
+}
+
+int bootstage_export_json(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	struct bootstage_span *span;
+	struct json_buf out;
+	const char *name;
+	char tmp[20];
+	uint count, i;
+
+	out.ptr = buf;
+	out.end = buf + size;
+	out.len = 0;
+	out.events = 0;
+	json_printf(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	json_event(&out, "process_name", "__metadata", 'M', 1, 0);
+	json_printf(&out, ",\"args\":{\"name\":\"U-Boot\"}}");
+	json_thread_name(&out, 1, "bootstage");
+
+	/* Marks are instants; accumulators are shown by their spans below */
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (rec->start_us)
+			continue;
+		json_event(&out, get_record_name(tmp, sizeof(tmp), rec), "mark",
+			   'i', 1, rec->time_us);
+		json_printf(&out, ",\"s\":\"p\"}");
+	}
+
+	/* The viewer nests spans according to their start and duration */
+	count = min_t(uint, data->span_count, SPAN_COUNT);
+	for (i = 0, span = data->span; i < count; i++, span++) {
+		rec = find_id(data, span->id);
+		if (rec) {
+			name = get_record_name(tmp, sizeof(tmp), rec);
+		} else {
+			snprintf(tmp, sizeof(tmp), "id=%d", span->id);
+			name = tmp;
+		}
+		json_event(&out, name, "accum", 'X', 1, span->start_us);
+		json_printf(&out, ",\"dur\":%u,\"args\":{\"depth\":%u}}",
+			    span->duration_us, span->depth);
+	}
+
+	json_add_initcalls(&out);
+	json_printf(&out, "\n]}\n");
+	if (out.ptr < out.end)
+		*out.ptr = '\0';
+
+	return out.len;
 }
 
 /**
@@ -364,9 +583,10 @@ int bootstage_stash(void *base, int size)
 	const struct bootstage_data *data = gd->bootstage;
 	struct bootstage_hdr *hdr = (struct bootstage_hdr *)base;
 	const struct bootstage_record *rec;
+	struct bootstage_span_hdr span_hdr;
+	const uint32_t zero = 0;
 	char buf[20];
 	char *ptr = base, *end = ptr + size;
-	uint32_t count;
 	int i;
 
 	if (hdr + 1 > (struct bootstage_hdr *)end) {
@@ -377,13 +597,11 @@ int bootstage_stash(void *base, int size)
 	/* Write an arbitrary version number */
 	hdr->version = BOOTSTAGE_VERSION;
 
-	/* Count the number of records, and write that value first */
-	for (rec = data->record, i = count = 0; i < data->rec_count;
-	     i++, rec++) {
-		if (rec->id != 0)
-			count++;
-	}
-	hdr->count = count;
+	/*
+	 * Write the number of records first. This includes the 'reset'
+	 * record (id 0), since all of them are written below.
+	 */
+	hdr->count = data->rec_count;
 	hdr->size = 0;
 	hdr->magic = BOOTSTAGE_MAGIC;
 	ptr += sizeof(*hdr);
@@ -401,6 +619,17 @@ int bootstage_stash(void *base, int size)
 		append_data(&ptr, end, name, strlen(name) + 1);
 	}
 
+	/* Write the spans, if any, aligned so that they can be read in place */
+	if (data->span_count) {
+		i = ptr - (char *)base;
+		append_data(&ptr, end, &zero, ALIGN(i, 4) - i);
+		span_hdr.magic = BOOTSTAGE_SPAN_MAGIC;
+		span_hdr.count = min_t(uint, data->span_count, SPAN_COUNT);
+		append_data(&ptr, end, &span_hdr, sizeof(span_hdr));
+		append_data(&ptr, end, data->span,
+			    span_hdr.count * sizeof(*data->span));
+	}
+
 	/* Check for buffer overflow */
 	if (ptr > end) {
 		debug("%s: Not enough space for bootstage stash\n", __func__);
@@ -414,13 +643,50 @@ int bootstage_stash(void *base, int size)
 	return 0;
 }
 
+/**
+ * Give unstashed records new ids where ours already use them
+ *
+ * Both the stashing phase and this one hand out ids from BOOTSTAGE_ID_USER,
+ * so an unstashed record may share its id with an unrelated record of ours.
+ * Spans only hold the id, so move such records, and their spans, to ids of
+ * their own. Fixed ids mean the same thing in every phase and are kept.
+ *
+ * @param data		Bootstage data
+ * @param first_rec	Index of the first unstashed record
+ * @param first_span	Index of the first unstashed span
+ */
+static void remap_ids(struct bootstage_data *data, uint first_rec,
+		      uint first_span)
+{
+	struct bootstage_record *rec;
+	struct bootstage_span *span;
+	uint span_count = min_t(uint, data->span_count, SPAN_COUNT);
+	uint i, j;
+
+	for (i = first_rec, rec = data->record + i; i < data->rec_count;
+	     i++, rec++) {
+		if (rec->id < BOOTSTAGE_ID_USER || find_id(data, rec->id) == rec)
+			continue;
+		if (data->next_id >= BOOTSTAGE_ID_USER +
+		    CONFIG_BOOTSTAGE_USER_COUNT)
+			break;
+		for (j = first_span, span = data->span + j; j < span_count;
+		     j++, span++) {
+			if (span->id == rec->id)
+				span->id = data->next_id;
+		}
+		rec->id = data->next_id++;
+	}
+}
+
 int bootstage_unstash(const void *base, int size)
 {
 	const struct bootstage_hdr *hdr = (struct bootstage_hdr *)base;
 	struct bootstage_data *data = gd->bootstage;
 	const char *ptr = base, *end = ptr + size;
+	const struct bootstage_span_hdr *span_hdr;
 	struct bootstage_record *rec;
-	uint rec_size;
+	uint rec_size, count, first_rec, first_span;
 	int i;
 
 	if (size == -1)
@@ -469,18 +735,48 @@ int bootstage_unstash(const void *base, int size)
 
 	/* Read the name strings */
 	ptr += rec_size;
-	for (rec = data->record + data->next_id, i = 0; i < hdr->count;
+	for (rec = data->record + data->rec_count, i = 0; i < hdr->count;
 	     i++, rec++) {
 		rec->name = ptr;
 
 		/* Assume no data corruption here */
 		ptr += strlen(ptr) + 1;
+
+		/* Don't hand out the ids which were allocated before */
+		if (rec->id >= data->next_id && rec->id < BOOTSTAGE_ID_USER +
+		    CONFIG_BOOTSTAGE_USER_COUNT)
+			data->next_id = rec->id + 1;
 	}
 
 	/* Mark the records as read */
+	first_rec = data->rec_count;
 	data->rec_count += hdr->count;
 	debug("Unstashed %d records\n", hdr->count);
 
+	/* Read the spans, which older stashes do not have */
+	first_span = data->span_count;
+	ptr = (const char *)base + ALIGN(ptr - (const char *)base, 4);
+	span_hdr = (const struct bootstage_span_hdr *)ptr;
+	if (ptr + sizeof(*span_hdr) <= (const char *)base + hdr->size &&
+	    span_hdr->magic == BOOTSTAGE_SPAN_MAGIC) {
+		ptr += sizeof(*span_hdr);
+		count = min_t(uint, span_hdr->count,
+			      SPAN_COUNT - min_t(uint, data->span_count,
+						 SPAN_COUNT));
+		if (ptr + count * sizeof(*data->span) >
+		    (const char *)base + hdr->size) {
+			debug("%s: Bootstage spans run past data end\n",
+			      __func__);
+			remap_ids(data, first_rec, first_span);
+			return -ENOSPC;
+		}
+		memcpy(data->span + data->span_count, ptr,
+		       count * sizeof(*data->span));
+		data->span_count += count;
+		debug("Unstashed %d spans\n", count);
+	}
+	remap_ids(data, first_rec, first_span);
+
 	return 0;
 }
 
@@ -499,10 +795,9 @@ int bootstage_init(bool first)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
-	if (first) {
-		data->next_id = BOOTSTAGE_ID_USER;
+	data->next_id = BOOTSTAGE_ID_USER;
+	if (first)
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
-	}
 
 	return 0;
 }
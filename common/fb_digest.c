@@ -0,0 +1,167 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Digest of flashed images, computed while they are written so that the
+ * host can check them without reading the partition back.
+ *
+ * With CRC32, fill chunks are accounted for in a handful of operations
+ * whatever their size, using crc32_combine(). SHA-256 has to hash the
+ * fill data, but this only costs CPU time, the data is never written.
+ */
+
+#include <common.h>
+#include <fb_digest.h>
+#include <fastboot.h>
+#include <watchdog.h>
+#include <u-boot/crc.h>
+#include <u-boot/sha256.h>
+
+/* Partitions for which a digest is kept */
+#define FB_DIGEST_PARTS		8
+#define FB_DIGEST_FILL_SIZE	4096
+
+struct fb_digest_result {
+	char name[32];
+	char value[FB_DIGEST_STR_LEN];
+};
+
+static struct fb_digest_result results[FB_DIGEST_PARTS];
+static unsigned int next_result;
+
+static struct {
+	bool active;
+	char name[32];
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+	sha256_context ctx;
+#else
+	uint32_t crc;
+#endif
+} cur;
+
+static struct fb_digest_result *fb_digest_find(const char *part_name)
+{
+	int i;
+
+	for (i = 0; i < FB_DIGEST_PARTS; i++) {
+		if (results[i].name[0] && !strcmp(results[i].name, part_name))
+			return &results[i];
+	}
+
+	return NULL;
+}
+
+void fb_digest_start(const char *part_name)
+{
+	struct fb_digest_result *res;
+
+	/* Whatever happens now, the old digest is stale */
+	res = fb_digest_find(part_name);
+	if (res)
+		res->name[0] = '\0';
+
+	strlcpy(cur.name, part_name, sizeof(cur.name));
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+	sha256_starts(&cur.ctx);
+#else
+	cur.crc = 0;
+#endif
+	cur.active = true;
+}
+
+void fb_digest_update(const void *buf, unsigned int len)
+{
+	if (!cur.active)
+		return;
+
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+	sha256_update(&cur.ctx, buf, len);
+#else
+	cur.crc = crc32(cur.crc, buf, len);
+#endif
+}
+
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+void fb_digest_fill(uint32_t val, uint64_t len)
+{
+	static uint32_t fill[FB_DIGEST_FILL_SIZE / sizeof(uint32_t)];
+	unsigned int n;
+	int i;
+
+	if (!cur.active)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(fill); i++)
+		fill[i] = val;
+	while (len) {
+		n = min_t(uint64_t, len, sizeof(fill));
+		sha256_update(&cur.ctx, (const uint8_t *)fill, n);
+		len -= n;
+		WATCHDOG_RESET();
+	}
+}
+#else
+void fb_digest_fill(uint32_t val, uint64_t len)
+{
+	uint64_t n = len / sizeof(val);
+	uint64_t part_len = sizeof(val);
+	uint32_t part, crc = 0;
+
+	if (!cur.active || !n)
+		return;
+
+	/*
+	 * part is the crc of the pattern repeated 1, 2, 4... times, crc
+	 * collects the parts for the bits set in n.
+	 */
+	part = crc32(0, (const unsigned char *)&val, sizeof(val));
+	while (n) {
+		if (n & 1)
+			crc = crc32_combine(crc, part, part_len);
+		n >>= 1;
+		if (n) {
+			part = crc32_combine(part, part, part_len);
+			part_len *= 2;
+		}
+	}
+	cur.crc = crc32_combine(cur.crc, crc, len);
+}
+#endif
+
+void fb_digest_finish(const char *response)
+{
+	struct fb_digest_result *res;
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+	uint8_t sum[SHA256_SUM_LEN];
+	int i;
+#endif
+
+	if (!cur.active)
+		return;
+	cur.active = false;
+	if (strncmp(response, "OKAY", 4))
+		return;
+
+	res = &results[next_result];
+	next_result = (next_result + 1) % FB_DIGEST_PARTS;
+	strlcpy(res->name, cur.name, sizeof(res->name));
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST_SHA256
+	sha256_finish(&cur.ctx, sum);
+	strcpy(res->value, "sha256:");
+	for (i = 0; i < SHA256_SUM_LEN; i++)
+		sprintf(res->value + 7 + i * 2, "%02x", sum[i]);
+#else
+	sprintf(res->value, "crc32:%08x", cur.crc);
+#endif
+	printf("........ %s digest %s\n", res->name, res->value);
+}
+
+const char *fb_digest_get(const char *part_name)
+{
+	struct fb_digest_result *res = fb_digest_find(part_name);
+
+	return res ? res->value : NULL;
+}
@@ -8,6 +8,7 @@
 #include <common.h>
 #include <blk.h>
 #include <fastboot.h>
+#include <fb_digest.h>
 #include <fb_mmc.h>
 #include <image-sparse.h>
 #include <part.h>
@@ -15,6 +16,7 @@
 #include <div64.h>
 #include <linux/compat.h>
 #include <android_image.h>
+#include <memalign.h>
 
 /*
  * FIXME: Ensure we always set these names via Kconfig once xxx_PARTITION is
@@ -98,6 +100,21 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_write_same(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt, uint32_t val)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+
+	/* Only zeroes can be had for free, from erased blocks */
+	if (val)
+		return 0;
+
+	timed_send_info(&timer, "erasing");
+
+	return mmc_bzero(dev_desc, blk, blkcnt);
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		unsigned int download_bytes, char *response)
@@ -367,6 +384,7 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 		return;
 	}
 
+	fb_digest_start(cmd);
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
 		struct sparse_storage sparse;
@@ -378,6 +396,7 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.write_same = fb_mmc_sparse_write_same;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
@@ -386,11 +405,234 @@ void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 		write_sparse_image(&sparse, cmd, download_buffer,
 				   download_bytes, response);
 	} else {
+		fb_digest_update(download_buffer, download_bytes);
 		write_raw_image(dev_desc, &info, cmd, download_buffer,
 				download_bytes, response);
 	}
+	fb_digest_finish(response);
 }
 
+#ifdef CONFIG_FASTBOOT_STREAM
+/*
+ * Streaming flash: the image is written in pieces as it is downloaded,
+ * see f_fastboot.c. The first piece tells whether it is a sparse image;
+ * raw images go out in whole blocks, with a block split across pieces
+ * kept in blk_buf and the last one padded with zeroes.
+ */
+struct fb_mmc_stream {
+	bool active;
+	bool started;
+	bool sparse;
+	char name[32];
+	unsigned int size;
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	struct fb_mmc_sparse sparse_priv;
+	struct sparse_storage storage;
+	struct sparse_stream ss;
+	lbaint_t blk;
+	void *blk_buf;
+	unsigned int blk_len;
+	const char *error;
+};
+
+static struct fb_mmc_stream stream;
+
+static void fb_mmc_stream_free(void)
+{
+	free(stream.blk_buf);
+	stream.blk_buf = NULL;
+	if (stream.started && stream.sparse) {
+		char response[FASTBOOT_RESPONSE_LEN];
+
+		sparse_stream_finish(&stream.ss, stream.name, response);
+	}
+	stream.active = false;
+}
+
+int fb_mmc_stream_start(const char *cmd, unsigned int size, char *response)
+{
+	if (stream.active)
+		fb_mmc_stream_free();
+
+	memset(&stream, 0, sizeof(stream));
+	stream.dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!stream.dev_desc || stream.dev_desc->type == DEV_TYPE_UNKNOWN) {
+		error("invalid mmc device\n");
+		fastboot_fail("invalid mmc device", response);
+		return -ENODEV;
+	}
+
+	/* These need the whole image at once */
+	if (!strcmp(cmd, CONFIG_FASTBOOT_GPT_NAME) ||
+	    !strcmp(cmd, CONFIG_FASTBOOT_MBR_NAME) ||
+	    !strncasecmp(cmd, "zimage", 6)) {
+		fastboot_fail("cannot stream to this partition", response);
+		return -EINVAL;
+	}
+
+	if (part_get_info_by_name_or_alias(stream.dev_desc, cmd,
+					   &stream.info) < 0) {
+		error("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition", response);
+		return -ENOENT;
+	}
+
+	stream.blk_buf = malloc_cache_aligned(stream.info.blksz);
+	if (!stream.blk_buf) {
+		fastboot_fail("out of memory", response);
+		return -ENOMEM;
+	}
+	strlcpy(stream.name, cmd, sizeof(stream.name));
+	stream.size = size;
+	stream.blk = stream.info.start;
+	stream.active = true;
+	fb_digest_start(cmd);
+
+	return 0;
+}
+
+static int fb_mmc_stream_begin(const void *buf, unsigned int len)
+{
+	disk_partition_t *info = &stream.info;
+
+	stream.started = true;
+	if (len >= sizeof(sparse_header_t) && is_sparse_image((void *)buf)) {
+		stream.sparse = true;
+		stream.sparse_priv.dev_desc = stream.dev_desc;
+		stream.storage.blksz = info->blksz;
+		stream.storage.start = info->start;
+		stream.storage.size = info->size;
+		stream.storage.write = fb_mmc_sparse_write;
+		stream.storage.reserve = fb_mmc_sparse_reserve;
+		stream.storage.write_same = fb_mmc_sparse_write_same;
+		stream.storage.priv = &stream.sparse_priv;
+
+		printf("Flashing sparse image at offset " LBAFU "\n",
+		       stream.storage.start);
+
+		return sparse_stream_init(&stream.ss, &stream.storage);
+	}
+
+	if (DIV_ROUND_UP(stream.size, info->blksz) > info->size) {
+		error("too large for partition: '%s'\n", stream.name);
+		stream.error = "too large for partition";
+		return -EFBIG;
+	}
+	puts("Flashing Raw Image\n");
+
+	return 0;
+}
+
+static int fb_mmc_stream_raw(const u8 *buf, unsigned int len)
+{
+	unsigned int blksz = stream.info.blksz;
+	lbaint_t blkcnt;
+	unsigned int n;
+
+	if (stream.blk_len) {
+		n = min(blksz - stream.blk_len, len);
+		memcpy(stream.blk_buf + stream.blk_len, buf, n);
+		stream.blk_len += n;
+		buf += n;
+		len -= n;
+		if (stream.blk_len < blksz)
+			return 0;
+		if (fb_mmc_blk_write(stream.dev_desc, stream.blk, 1,
+				     stream.blk_buf) != 1)
+			goto err;
+		stream.blk++;
+		stream.blk_len = 0;
+	}
+
+	blkcnt = len / blksz;
+	if (blkcnt) {
+		if (fb_mmc_blk_write(stream.dev_desc, stream.blk, blkcnt,
+				     buf) != blkcnt)
+			goto err;
+		stream.blk += blkcnt;
+		buf += blkcnt * blksz;
+		len -= blkcnt * blksz;
+	}
+
+	if (len) {
+		memcpy(stream.blk_buf, buf, len);
+		stream.blk_len = len;
+	}
+
+	return 0;
+
+err:
+	error("failed writing to device %d\n", stream.dev_desc->devnum);
+	stream.error = "failed writing to device";
+	return -EIO;
+}
+
+int fb_mmc_stream_write(const void *buf, unsigned int len)
+{
+	int ret;
+
+	if (!stream.active || stream.error)
+		return -EINVAL;
+
+	if (!stream.started) {
+		ret = fb_mmc_stream_begin(buf, len);
+		if (ret) {
+			if (!stream.error)
+				stream.error = stream.ss.error;
+			return ret;
+		}
+	}
+
+	if (stream.sparse) {
+		ret = sparse_stream_write(&stream.ss, buf, len);
+		if (ret)
+			stream.error = stream.ss.error;
+		return ret;
+	}
+
+	fb_digest_update(buf, len);
+
+	return fb_mmc_stream_raw(buf, len);
+}
+
+void fb_mmc_stream_finish(char *response)
+{
+	lbaint_t blkcnt;
+
+	if (!stream.active) {
+		fastboot_fail("no image streamed", response);
+		return;
+	}
+
+	if (stream.sparse) {
+		sparse_stream_finish(&stream.ss, stream.name, response);
+		stream.started = false;
+	} else if (stream.error) {
+		fastboot_fail(stream.error, response);
+	} else {
+		/* Pad the last block */
+		if (stream.blk_len) {
+			memset(stream.blk_buf + stream.blk_len, 0,
+			       stream.info.blksz - stream.blk_len);
+			stream.blk_len = 0;
+			fb_mmc_stream_raw(stream.blk_buf, stream.info.blksz);
+		}
+		blkcnt = stream.blk - stream.info.start;
+		if (stream.error) {
+			fastboot_fail(stream.error, response);
+		} else {
+			printf("........ wrote " LBAFU " bytes to '%s'\n",
+			       blkcnt * stream.info.blksz, stream.name);
+			fastboot_okay("", response);
+		}
+	}
+
+	fb_digest_finish(response);
+	fb_mmc_stream_free();
+}
+#endif
+
 void fb_mmc_erase(const char *cmd, char *response)
 {
 	int ret;
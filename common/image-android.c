@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <boot_plan.h>
 #include <image.h>
 #include <android_image.h>
 #include <malloc.h>
@@ -15,6 +16,24 @@
 
 static char andr_tmp_str[ANDR_BOOT_ARGS_SIZE + 1];
 
+/*
+ * Where android_image_load() put the kernel and ramdisk of the image it
+ * loaded last, so that bootm uses them from there. The header is kept to
+ * tell whether the image at @hdr is still that one.
+ */
+static struct {
+	const struct andr_img_hdr *hdr;
+	struct andr_img_hdr copy;
+	ulong kernel;
+	ulong ramdisk;
+} andr_layout;
+
+static bool android_image_is_loaded(const struct andr_img_hdr *hdr)
+{
+	return hdr == andr_layout.hdr &&
+	       !memcmp(hdr, &andr_layout.copy, sizeof(*hdr));
+}
+
 static ulong android_image_get_kernel_addr(const struct andr_img_hdr *hdr)
 {
 	/*
@@ -94,8 +113,12 @@ int android_image_get_kernel(const struct andr_img_hdr *hdr, int verify,
 	env_set("bootargs", newbootargs);
 
 	if (os_data) {
-		*os_data = (ulong)hdr;
-		*os_data += hdr->page_size;
+		if (android_image_is_loaded(hdr)) {
+			*os_data = andr_layout.kernel;
+		} else {
+			*os_data = (ulong)hdr;
+			*os_data += hdr->page_size;
+		}
 	}
 	if (os_len)
 		*os_len = hdr->kernel_size;
@@ -139,62 +162,146 @@ int android_image_get_ramdisk(const struct andr_img_hdr *hdr,
 	printf("RAM disk load addr 0x%08x size %u KiB\n",
 	       hdr->ramdisk_addr, DIV_ROUND_UP(hdr->ramdisk_size, 1024));
 
-	*rd_data = (unsigned long)hdr;
-	*rd_data += hdr->page_size;
-	*rd_data += ALIGN(hdr->kernel_size, hdr->page_size);
+	if (android_image_is_loaded(hdr)) {
+		*rd_data = andr_layout.ramdisk;
+	} else {
+		*rd_data = (unsigned long)hdr;
+		*rd_data += hdr->page_size;
+		*rd_data += ALIGN(hdr->kernel_size, hdr->page_size);
+	}
 
 	*rd_len = hdr->ramdisk_size;
 	return 0;
 }
 
+/* Read @size bytes from @offset, a multiple of the block size, to @dst */
+static long android_image_read(struct blk_desc *dev_desc,
+			       const disk_partition_t *part_info,
+			       ulong offset, ulong size, ulong dst)
+{
+	lbaint_t blk = part_info->start + offset / part_info->blksz;
+	lbaint_t cnt = DIV_ROUND_UP(size, part_info->blksz);
+	void *buf;
+	long ret;
+
+	if (!size)
+		return 0;
+	if (offset / part_info->blksz + cnt > part_info->size)
+		return -1;
+
+	buf = map_sysmem(dst, cnt * part_info->blksz);
+	ret = blk_dread(dev_desc, blk, cnt, buf);
+	unmap_sysmem(buf);
+	if (ret != cnt)
+		return -1;
+
+	return cnt * part_info->blksz;
+}
+
 long android_image_load(struct blk_desc *dev_desc,
 			const disk_partition_t *part_info,
 			unsigned long load_address,
 			unsigned long max_size) {
-	void *buf;
-	long blk_cnt, blk_read = 0;
+	ulong hdr_len = ALIGN(sizeof(struct andr_img_hdr), part_info->blksz);
+	ulong page, kernel_len, kernel_off, ramdisk_off;
+	ulong kernel_dest, ramdisk_dest, ramdisk_len, image_size;
+	struct andr_img_hdr *hdr;
+	long ret, total = 0;
 
-	if (max_size < part_info->blksz)
+	if (max_size < hdr_len)
 		return -1;
 
 	/* We don't know the size of the Android image before reading the header
 	 * so we don't limit the size of the mapped memory.
 	 */
-	buf = map_sysmem(load_address, 0 /* size */);
+	hdr = map_sysmem(load_address, 0 /* size */);
+	andr_layout.hdr = NULL;
 
-	/* Read the Android header first and then read the rest. */
-	if (blk_dread(dev_desc, part_info->start, 1, buf) != 1)
-		blk_read = -1;
+	/* The header, up to the end of the command lines */
+	ret = android_image_read(dev_desc, part_info, 0, hdr_len,
+				 load_address);
+	if (ret < 0)
+		goto out;
+	total += ret;
 
-	if (!blk_read && android_image_check_header(buf) != 0) {
+	ret = -1;
+	if (android_image_check_header(hdr) != 0) {
 		printf("** Invalid Android Image header **\n");
-		blk_read = -1;
+		goto out;
 	}
-	if (!blk_read) {
-		blk_cnt = (android_image_get_end(buf) - (ulong)buf +
-			   part_info->blksz - 1) / part_info->blksz;
-		if (blk_cnt * part_info->blksz > max_size) {
-			debug("Android Image too big (%lu bytes, max %lu)\n",
-			      android_image_get_end(buf) - (ulong)buf,
-			      max_size);
-			blk_read = -1;
-		} else {
-			debug("Loading Android Image (%lu blocks) to 0x%lx... ",
-			      blk_cnt, load_address);
-			blk_read = blk_dread(dev_desc, part_info->start,
-					     blk_cnt, buf);
-		}
+	page = hdr->page_size;
+	if (!page || page % part_info->blksz) {
+		printf("** Bad Android Image page size %lu **\n", page);
+		goto out;
 	}
 
-	unmap_sysmem(buf);
-	if (blk_read < 0)
-		return blk_read;
+	image_size = android_image_get_end(hdr) - (ulong)hdr;
+	image_size -= ALIGN(hdr->second_size, page);
+	if (image_size > max_size) {
+		debug("Android Image too big (%lu bytes, max %lu)\n",
+		      image_size, max_size);
+		goto out;
+	}
 
-	debug("%lu blocks read: %s\n",
-	      blk_read, (blk_read == blk_cnt) ? "OK" : "ERROR");
-	if (blk_read != blk_cnt)
-		return -1;
-	return blk_read;
+	/*
+	 * Each section is read to its place with a single read. The
+	 * second stage is not used by anything here, so it is left out.
+	 */
+	kernel_off = page;
+	kernel_len = ALIGN(hdr->kernel_size, part_info->blksz);
+	ramdisk_off = kernel_off + ALIGN(hdr->kernel_size, page);
+	ramdisk_len = ALIGN(hdr->ramdisk_size, part_info->blksz);
+
+	/*
+	 * A kernel with a load address of its own is read straight there
+	 * when that memory is free; otherwise it stays in the image, and
+	 * bootm moves it if needed, as before. The ramdisk goes where bootm
+	 * would copy it to, if its place in the image does not suit.
+	 */
+	boot_plan_init();
+	boot_plan_reserve(load_address, page);
+	kernel_dest = 0;
+	if (hdr->kernel_addr != ANDROID_IMAGE_DEFAULT_KERNEL_ADDR)
+		kernel_dest = boot_plan_kernel(hdr->kernel_addr, NULL,
+					       kernel_len);
+	if (!kernel_dest) {
+		kernel_dest = load_address + kernel_off;
+		boot_plan_kernel(kernel_dest, NULL, kernel_len);
+	}
+	ramdisk_dest = 0;
+	if (hdr->ramdisk_size)
+		ramdisk_dest = boot_plan_ramdisk(load_address + ramdisk_off,
+						 ramdisk_len);
+	if (!ramdisk_dest)
+		ramdisk_dest = load_address + ramdisk_off;
+	/* Whatever stays in the image is used from there */
+	boot_plan_reserve(load_address, image_size);
+	debug("Loading Android Image kernel to 0x%lx, ramdisk to 0x%lx\n",
+	      kernel_dest, ramdisk_dest);
+
+	ret = android_image_read(dev_desc, part_info, kernel_off,
+				 hdr->kernel_size, kernel_dest);
+	if (ret < 0)
+		goto out;
+	total += ret;
+
+	ret = android_image_read(dev_desc, part_info, ramdisk_off,
+				 hdr->ramdisk_size, ramdisk_dest);
+	if (ret < 0)
+		goto out;
+	total += ret;
+
+	memcpy(&andr_layout.copy, hdr, sizeof(andr_layout.copy));
+	andr_layout.hdr = hdr;
+	andr_layout.kernel = kernel_dest;
+	andr_layout.ramdisk = ramdisk_dest;
+	ret = total;
+out:
+	unmap_sysmem(hdr);
+	if (ret < 0)
+		printf("Error reading Android Image\n");
+
+	return ret;
 }
 
 #if !defined(CONFIG_SPL_BUILD)
@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <boot_plan.h>
 #include <fdt_support.h>
 #include <errno.h>
 #include <image.h>
@@ -17,10 +18,6 @@
 #include <mapmem.h>
 #include <asm/io.h>
 
-#ifndef CONFIG_SYS_FDT_PAD
-#define CONFIG_SYS_FDT_PAD 0x3000
-#endif
-
 DECLARE_GLOBAL_DATA_PTR;
 
 static void fdt_error(const char *msg)
@@ -133,7 +130,12 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size)
 
 	/* If fdt_high is set use it to select the relocation address */
 	fdt_high = env_get("fdt_high");
-	if (fdt_high) {
+	if (boot_plan_placed(BOOT_PLAN_FDT, map_to_sysmem(fdt_blob), of_len)) {
+		/* The loader left room for the padding after it */
+		of_start = fdt_blob;
+		lmb_reserve(lmb, (ulong)of_start, of_len);
+		disable_relocation = 1;
+	} else if (fdt_high) {
 		void *desired_addr = (void *)simple_strtoul(fdt_high, NULL, 16);
 
 		if (((ulong) desired_addr) == ~0UL) {
@@ -36,6 +36,7 @@
 
 #include <config.h>
 #include <common.h>
+#include <fb_digest.h>
 #include <image-sparse.h>
 #include <div64.h>
 #include <malloc.h>
@@ -49,40 +50,90 @@
 #define CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE (1024 * 512)
 #endif
 
-void write_sparse_image(
-		struct sparse_storage *info, const char *part_name,
-		void *data, unsigned sz, char *response)
+/*
+ * The image is parsed as a state machine, so it can be fed in pieces split
+ * at any point: headers and fill values that straddle two pieces are
+ * collected in the stream state, and raw data is written straight from the
+ * input except for a block split across pieces, which goes through blk_buf.
+ */
+
+static int sparse_fail(struct sparse_stream *ss, const char *reason, int ret)
 {
-	lbaint_t blk;
-	lbaint_t blkcnt;
-	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
+	ss->error = reason;
+	ss->state = SPARSE_STATE_ERROR;
 
-	fill_buf_num_blks = CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE / info->blksz;
+	return ret;
+}
 
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
+/*
+ * Collect a header of @size bytes into @hdr, possibly over several pieces.
+ * Returns true once it is complete.
+ */
+static bool sparse_collect(struct sparse_stream *ss, void *hdr,
+			   unsigned int size, const u8 **data,
+			   unsigned int *len)
+{
+	unsigned int n = min(size - ss->hdr_len, *len);
 
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+	memcpy((u8 *)hdr + ss->hdr_len, *data, n);
+	ss->hdr_len += n;
+	*data += n;
+	*len -= n;
+	if (ss->hdr_len < size)
+		return false;
+	ss->hdr_len = 0;
+
+	return true;
+}
+
+static int sparse_check_size(struct sparse_stream *ss, u64 blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t end = info->start + info->size;
+
+	/* Done in 64 bits: a chunk can describe more than 4GiB */
+	if (ss->blk > end || blkcnt > end - ss->blk) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return sparse_fail(ss, "Request would exceed partition size!",
+				   -EINVAL);
 	}
 
+	return 0;
+}
+
+static int sparse_write_blks(struct sparse_stream *ss, const void *buf,
+			     lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blks;
+
+	blks = info->write(info, ss->blk, blkcnt, buf);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n",
+		       __func__, "Write failed, block #", ss->blk, blks);
+		return sparse_fail(ss, "flash write failure", -EIO);
+	}
+	ss->blk += blks;
+
+	return 0;
+}
+
+static void sparse_end_chunk(struct sparse_stream *ss)
+{
+	ss->total_blocks += ss->chunk_header.chunk_sz;
+	if (ss->chunk < ss->header.total_chunks)
+		ss->state = SPARSE_STATE_CHUNK_HDR;
+	else
+		ss->state = SPARSE_STATE_DONE;
+}
+
+static int sparse_start_image(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->header;
+	struct sparse_storage *info = ss->info;
+	unsigned int offset;
+
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
 	debug("major_version: 0x%x\n", sparse_header->major_version);
@@ -93,172 +144,325 @@ void write_sparse_image(
 	debug("total_blks: %d\n", sparse_header->total_blks);
 	debug("total_chunks: %d\n", sparse_header->total_chunks);
 
+	if (!is_sparse_image(sparse_header) ||
+	    sparse_header->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse_header->chunk_hdr_sz < sizeof(chunk_header_t))
+		return sparse_fail(ss, "invalid sparse image header", -EINVAL);
+
 	/*
 	 * Verify that the sparse block size is a multiple of our
 	 * storage backend block size
 	 */
 	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
-	if (offset) {
+	if (offset || !sparse_header->blk_sz) {
 		printf("%s: Sparse image block size issue [%u]\n",
 		       __func__, sparse_header->blk_sz);
-		fastboot_fail("sparse image block size issue", response);
-		return;
+		return sparse_fail(ss, "sparse image block size issue",
+				   -EINVAL);
 	}
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
+	/* Skip the remaining bytes in a header that is longer than we expect */
+	ss->skip = sparse_header->file_hdr_sz - sizeof(sparse_header_t);
+	ss->blk = info->start;
+	if (sparse_header->total_chunks)
+		ss->state = SPARSE_STATE_CHUNK_HDR;
+	else
+		ss->state = SPARSE_STATE_DONE;
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
-		}
+	return 0;
+}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Raw", response);
-				return;
-			}
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!", response);
-				return;
-			}
-
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				fastboot_fail(
-					      "flash write failure", response);
-				return;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
-			break;
+static int sparse_start_chunk(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->header;
+	chunk_header_t *chunk_header = &ss->chunk_header;
+	struct sparse_storage *info = ss->info;
+	u64 chunk_data_sz;
+	u64 blkcnt;
+	int ret;
+
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
+
+	ss->chunk++;
+	/* Skip the remaining bytes in a header that is longer than we expect */
+	ss->skip = sparse_header->chunk_hdr_sz - sizeof(chunk_header_t);
+
+	chunk_data_sz = (u64)sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = lldiv(chunk_data_sz, info->blksz);
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    (u64)sparse_header->chunk_hdr_sz + chunk_data_sz)
+			return sparse_fail(ss,
+					   "Bogus chunk size for chunk type Raw",
+					   -EINVAL);
+		ret = sparse_check_size(ss, blkcnt);
+		if (ret)
+			return ret;
+		ss->remain = chunk_data_sz;
+		ss->state = SPARSE_STATE_RAW;
+		if (!chunk_data_sz)
+			sparse_end_chunk(ss);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t)))
+			return sparse_fail(ss,
+					   "Bogus chunk size for chunk type FILL",
+					   -EINVAL);
+		ret = sparse_check_size(ss, blkcnt);
+		if (ret)
+			return ret;
+		ss->state = SPARSE_STATE_FILL;
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		ret = sparse_check_size(ss, blkcnt);
+		if (ret)
+			return ret;
+		fb_digest_fill(0, chunk_data_sz);
+		ss->blk += info->reserve(info, ss->blk, blkcnt);
+		sparse_end_chunk(ss);
+		break;
 
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type FILL", response);
-				return;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz)
+			return sparse_fail(ss,
+					   "Bogus chunk size for chunk type CRC32",
+					   -EINVAL);
+		/* The checksum is not verified, just skip it */
+		ss->skip += chunk_header->total_sz - sparse_header->chunk_hdr_sz;
+		sparse_end_chunk(ss);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		return sparse_fail(ss, "Unknown chunk type", -EINVAL);
+	}
+
+	return 0;
+}
+
+static int sparse_raw_data(struct sparse_stream *ss, const u8 **data,
+			   unsigned int *len)
+{
+	unsigned int blksz = ss->info->blksz;
+	lbaint_t blkcnt;
+	unsigned int n;
+	int ret;
+
+	/* All of the data in this piece is used up below */
+	fb_digest_update(*data, min(*len, ss->remain));
+
+	/* Complete a block started by the previous piece */
+	if (ss->blk_len) {
+		n = min(blksz - ss->blk_len, *len);
+		memcpy(ss->blk_buf + ss->blk_len, *data, n);
+		ss->blk_len += n;
+		ss->remain -= n;
+		*data += n;
+		*len -= n;
+		if (ss->blk_len < blksz)
+			return 0;
+		ss->blk_len = 0;
+		ret = sparse_write_blks(ss, ss->blk_buf, 1);
+		if (ret)
+			return ret;
+	}
+
+	/* Whole blocks are written from the input directly */
+	blkcnt = min(*len, ss->remain) / blksz;
+	if (blkcnt) {
+		ret = sparse_write_blks(ss, *data, blkcnt);
+		if (ret)
+			return ret;
+		n = blkcnt * blksz;
+		ss->remain -= n;
+		*data += n;
+		*len -= n;
+	}
+
+	/* Keep the start of a block which continues in the next piece */
+	n = min(*len, ss->remain);
+	if (n) {
+		memcpy(ss->blk_buf, *data, n);
+		ss->blk_len = n;
+		ss->remain -= n;
+		*data += n;
+		*len -= n;
+	}
+
+	if (!ss->remain && !ss->blk_len) {
+		ss->bytes_written += (u64)ss->header.blk_sz *
+				     ss->chunk_header.chunk_sz;
+		sparse_end_chunk(ss);
+	}
+
+	return 0;
+}
+
+static int sparse_fill(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t fill_buf_num_blks;
+	lbaint_t blkcnt, i, j;
+	int ret;
+
+	fill_buf_num_blks = CONFIG_FASTBOOT_FLASH_FILLBUF_SIZE / info->blksz;
+	/* Checked against the partition size in sparse_start_chunk() */
+	blkcnt = lldiv((u64)ss->header.blk_sz * ss->chunk_header.chunk_sz,
+		       info->blksz);
+	fb_digest_fill(ss->fill_val, (uint64_t)blkcnt * info->blksz);
+
+	if (info->write_same &&
+	    info->write_same(info, ss->blk, blkcnt, ss->fill_val) == blkcnt) {
+		ss->blk += blkcnt;
+		goto done;
+	}
+
+	if (!ss->fill_buf) {
+		ss->fill_buf = (uint32_t *)
+			       memalign(ARCH_DMA_MINALIGN,
+					ROUNDUP(info->blksz * fill_buf_num_blks,
 						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				fastboot_fail(
-					"Malloc failed for: CHUNK_TYPE_FILL", response);
-				return;
-			}
-
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				fastboot_fail(
-				    "Request would exceed partition size!", response);
-				return;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					fastboot_fail(
-						      "flash write failure", response);
-					free(fill_buf);
-					return;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
-			break;
+		if (!ss->fill_buf)
+			return sparse_fail(ss,
+					   "Malloc failed for: CHUNK_TYPE_FILL",
+					   -ENOMEM);
+	}
 
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
-			break;
+	/* Images tend to use the same value over and over */
+	if (!ss->fill_buf_ready || ss->fill_buf[0] != ss->fill_val) {
+		for (i = 0;
+		     i < (info->blksz * fill_buf_num_blks /
+			  sizeof(ss->fill_val));
+		     i++)
+			ss->fill_buf[i] = ss->fill_val;
+		ss->fill_buf_ready = true;
+	}
+
+	for (i = 0; i < blkcnt; i += j) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		ret = sparse_write_blks(ss, ss->fill_buf, j);
+		if (ret)
+			return ret;
+	}
+
+done:
+	ss->bytes_written += (u64)blkcnt * info->blksz;
+	sparse_end_chunk(ss);
 
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				fastboot_fail(
-					"Bogus chunk size for chunk type Dont Care", response);
-				return;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+	return 0;
+}
+
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info)
+{
+	memset(ss, 0, sizeof(*ss));
+	ss->info = info;
+	ss->state = SPARSE_STATE_FILE_HDR;
+	ss->blk_buf = memalign(ARCH_DMA_MINALIGN,
+			       ROUNDUP(info->blksz, ARCH_DMA_MINALIGN));
+	if (!ss->blk_buf)
+		return sparse_fail(ss, "Malloc failed for sparse image",
+				   -ENOMEM);
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len)
+{
+	const u8 *p = data;
+	unsigned int n;
+	int ret = 0;
+
+	while (len && !ret) {
+		if (ss->skip) {
+			n = min(ss->skip, len);
+			ss->skip -= n;
+			p += n;
+			len -= n;
+			continue;
+		}
+
+		switch (ss->state) {
+		case SPARSE_STATE_FILE_HDR:
+			if (sparse_collect(ss, &ss->header,
+					   sizeof(sparse_header_t), &p, &len))
+				ret = sparse_start_image(ss);
+			break;
+		case SPARSE_STATE_CHUNK_HDR:
+			if (sparse_collect(ss, &ss->chunk_header,
+					   sizeof(chunk_header_t), &p, &len))
+				ret = sparse_start_chunk(ss);
 			break;
+		case SPARSE_STATE_RAW:
+			ret = sparse_raw_data(ss, &p, &len);
+			break;
+		case SPARSE_STATE_FILL:
+			if (sparse_collect(ss, &ss->fill_val,
+					   sizeof(ss->fill_val), &p, &len))
+				ret = sparse_fill(ss);
+			break;
+		case SPARSE_STATE_DONE:
+			return 0;
+		case SPARSE_STATE_ERROR:
+			return -EINVAL;
+		}
+	}
+
+	return ret;
+}
 
-		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			fastboot_fail("Unknown chunk type", response);
-			return;
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response)
+{
+	int ret = 0;
+
+	if (ss->state == SPARSE_STATE_ERROR) {
+		fastboot_fail(ss->error, response);
+		ret = -EINVAL;
+	} else {
+		debug("Wrote %d blocks, expected to write %d blocks\n",
+		      ss->total_blocks, ss->header.total_blks);
+		printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+		       part_name);
+
+		if (ss->state != SPARSE_STATE_DONE ||
+		    ss->total_blocks != ss->header.total_blks) {
+			fastboot_fail("sparse image write failure", response);
+			ret = -EIO;
+		} else {
+			fastboot_okay("", response);
 		}
 	}
 
-	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	free(ss->blk_buf);
+	free(ss->fill_buf);
+	ss->blk_buf = NULL;
+	ss->fill_buf = NULL;
 
-	if (total_blocks != sparse_header->total_blks)
-		fastboot_fail("sparse image write failure", response);
-	else
-		fastboot_okay("", response);
+	return ret;
+}
+
+void write_sparse_image(
+		struct sparse_storage *info, const char *part_name,
+		void *data, unsigned sz, char *response)
+{
+	struct sparse_stream ss;
 
-	return;
+	if (!sparse_stream_init(&ss, info))
+		sparse_stream_write(&ss, data, sz);
+	sparse_stream_finish(&ss, part_name, response);
 }
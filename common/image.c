@@ -25,6 +25,7 @@
 
 #include <rtc.h>
 
+#include <boot_plan.h>
 #include <environment.h>
 #include <image.h>
 #include <mapmem.h>
@@ -178,6 +179,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -1247,7 +1249,9 @@ int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 			initrd_high, initrd_copy_to_ram);
 
 	if (rd_data) {
-		if (!initrd_copy_to_ram) {	/* zero-copy ramdisk support */
+		/* zero-copy ramdisk support, also when a loader planned it */
+		if (!initrd_copy_to_ram ||
+		    boot_plan_placed(BOOT_PLAN_RAMDISK, rd_data, rd_len)) {
 			debug("   in-place initrd\n");
 			*initrd_start = rd_data;
 			*initrd_end = rd_data + rd_len;
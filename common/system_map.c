@@ -5,4 +5,7 @@
  * Licensed under the GPL-2 or later.
  */
 
-const char const system_map[] = SYSTEM_MAP;
+/* The address and name of each function, generated when linking U-Boot */
+const char system_map[] =
+#include "system_map.inc"
+	;
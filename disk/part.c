@@ -12,6 +12,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <ubifs_uboot.h>
+#include <linux/list.h>
 
 #undef	PART_DEBUG
 
@@ -134,6 +135,7 @@ void dev_print (struct blk_desc *dev_desc)
 	case IF_TYPE_USB:
 	case IF_TYPE_NVME:
 	case IF_TYPE_RKNAND:
+	case IF_TYPE_SPINOR:
 		printf ("Vendor: %s Rev: %s Prod: %s\n",
 			dev_desc->vendor,
 			dev_desc->revision,
@@ -220,6 +222,7 @@ void part_init(struct blk_desc *dev_desc)
 	struct part_driver *entry;
 
 	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	part_cache_invalidate(dev_desc);
 
 	dev_desc->part_type = PART_TYPE_UNKNOWN;
 	for (entry = drv; entry != drv + n_ents; entry++) {
@@ -273,6 +276,9 @@ static void print_part_header(const char *type, struct blk_desc *dev_desc)
 	case IF_TYPE_RKNAND:
 		puts("RKNAND");
 		break;
+	case IF_TYPE_SPINOR:
+		puts("SPINOR");
+		break;
 	default:
 		puts ("UNKNOWN");
 		break;
@@ -623,6 +629,203 @@ cleanup:
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+/*
+ * Partition table cache, so that looking a partition up by name does not
+ * go through the partition driver (and the device) each time. Tables are
+ * kept per device and hardware partition, like the block cache, and
+ * entries are chained in a small hash table by name.
+ */
+#define PART_CACHE_HASH_SIZE	32	/* must be a power of two */
+#define PART_CACHE_GROW		16
+
+/*
+ * Writes to these blocks at either end of a device may change its
+ * partition table: MBR and primary GPT, backup GPT.
+ */
+#define PART_CACHE_HEAD_BLKS	34
+#define PART_CACHE_TAIL_BLKS	33
+
+struct part_cache_entry {
+	disk_partition_t info;
+	int part;
+	int next;		/* next entry in the same hash chain, or -1 */
+};
+
+struct part_cache {
+	struct list_head list;
+	int if_type;
+	int devnum;
+	unsigned char hwpart;
+	lbaint_t lba;
+	int count;
+	int max;
+	struct part_cache_entry *entries;
+	int hash[PART_CACHE_HASH_SIZE];
+};
+
+static LIST_HEAD(part_caches);
+static unsigned int part_cache_gen = 1;
+
+static uint32_t part_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash & (PART_CACHE_HASH_SIZE - 1);
+}
+
+static struct part_cache_entry *part_cache_lookup(struct part_cache *pc,
+						  const char *name)
+{
+	struct part_cache_entry *entry;
+	int i;
+
+	for (i = pc->hash[part_name_hash(name)]; i >= 0; i = entry->next) {
+		entry = &pc->entries[i];
+		if (!strcmp(name, (const char *)entry->info.name))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static int part_cache_add(struct part_cache *pc, int part,
+			  disk_partition_t *info)
+{
+	struct part_cache_entry *entry;
+	uint32_t hash;
+
+	/* The first partition with a name wins, as in a plain search */
+	if (part_cache_lookup(pc, (const char *)info->name))
+		return 0;
+
+	if (pc->count == pc->max) {
+		entry = realloc(pc->entries, (pc->max + PART_CACHE_GROW) *
+				sizeof(*entry));
+		if (!entry)
+			return -ENOMEM;
+		pc->entries = entry;
+		pc->max += PART_CACHE_GROW;
+	}
+
+	hash = part_name_hash((const char *)info->name);
+	entry = &pc->entries[pc->count];
+	entry->info = *info;
+	entry->part = part;
+	entry->next = pc->hash[hash];
+	pc->hash[hash] = pc->count++;
+
+	return 0;
+}
+
+static void part_cache_free(struct part_cache *pc)
+{
+	list_del(&pc->list);
+	free(pc->entries);
+	free(pc);
+}
+
+static struct part_cache *part_cache_fill(struct blk_desc *dev_desc)
+{
+	struct part_driver *first_drv =
+		ll_entry_start(struct part_driver, part_driver);
+	const int n_drvs = ll_entry_count(struct part_driver, part_driver);
+	struct part_driver *part_drv;
+	disk_partition_t info;
+	struct part_cache *pc;
+	int i;
+
+	pc = calloc(1, sizeof(*pc));
+	if (!pc)
+		return NULL;
+	pc->if_type = dev_desc->if_type;
+	pc->devnum = dev_desc->devnum;
+	pc->hwpart = dev_desc->hwpart;
+	pc->lba = dev_desc->lba;
+	memset(pc->hash, 0xff, sizeof(pc->hash));
+	list_add(&pc->list, &part_caches);
+
+	for (part_drv = first_drv; part_drv != first_drv + n_drvs; part_drv++) {
+		for (i = 1; i < part_drv->max_entries; i++) {
+			if (part_drv->get_info(dev_desc, i, &info))
+				break;
+			if (part_cache_add(pc, i, &info)) {
+				part_cache_free(pc);
+				return NULL;
+			}
+		}
+	}
+
+	return pc;
+}
+
+static struct part_cache *part_cache_get(struct blk_desc *dev_desc)
+{
+	struct part_cache *pc;
+
+	list_for_each_entry(pc, &part_caches, list) {
+		if (pc->if_type == dev_desc->if_type &&
+		    pc->devnum == dev_desc->devnum &&
+		    pc->hwpart == dev_desc->hwpart) {
+			/* Another medium in the same slot */
+			if (pc->lba != dev_desc->lba) {
+				part_cache_invalidate(dev_desc);
+				break;
+			}
+			return pc;
+		}
+	}
+
+	return part_cache_fill(dev_desc);
+}
+
+void part_cache_invalidate(struct blk_desc *dev_desc)
+{
+	struct part_cache *pc, *next;
+
+	list_for_each_entry_safe(pc, next, &part_caches, list) {
+		if (pc->if_type == dev_desc->if_type &&
+		    pc->devnum == dev_desc->devnum)
+			part_cache_free(pc);
+	}
+	part_cache_gen++;
+}
+
+void part_cache_check_write(struct blk_desc *dev_desc, lbaint_t start,
+			    lbaint_t blkcnt)
+{
+	struct part_driver *first_drv =
+		ll_entry_start(struct part_driver, part_driver);
+	const int n_drvs = ll_entry_count(struct part_driver, part_driver);
+	struct part_driver *part_drv;
+
+	if (start < PART_CACHE_HEAD_BLKS ||
+	    start + blkcnt + PART_CACHE_TAIL_BLKS > dev_desc->lba) {
+		part_cache_invalidate(dev_desc);
+		return;
+	}
+
+	for (part_drv = first_drv; part_drv != first_drv + n_drvs; part_drv++) {
+		if (part_drv->table_blks &&
+		    start < part_drv->table_start + part_drv->table_blks &&
+		    start + blkcnt > part_drv->table_start) {
+			part_cache_invalidate(dev_desc);
+			return;
+		}
+	}
+}
+
+unsigned int part_cache_generation(void)
+{
+	return part_cache_gen;
+}
+#endif
+
 int part_get_info_by_name(struct blk_desc *dev_desc, const char *name,
 	disk_partition_t *info)
 {
@@ -630,6 +833,20 @@ int part_get_info_by_name(struct blk_desc *dev_desc, const char *name,
 		ll_entry_start(struct part_driver, part_driver);
 	const int n_drvs = ll_entry_count(struct part_driver, part_driver);
 	struct part_driver *part_drv;
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	struct part_cache_entry *entry;
+	struct part_cache *pc;
+
+	pc = part_cache_get(dev_desc);
+	if (pc) {
+		entry = part_cache_lookup(pc, name);
+		if (!entry)
+			return -1;
+		*info = entry->info;
+		return entry->part;
+	}
+	/* Out of memory, search the hard way */
+#endif
 
 	for (part_drv = first_drv; part_drv != first_drv + n_drvs; part_drv++) {
 		int ret;
@@ -287,6 +287,7 @@ int write_mbr_partition(struct blk_desc *dev_desc, void *buf)
 		       __func__, "MBR");
 		return 1;
 	}
+	part_cache_invalidate(dev_desc);
 
 	return 0;
 }
@@ -420,6 +420,7 @@ int write_gpt_table(struct blk_desc *dev_desc,
 		       gpt_h) != 1)
 		goto err;
 
+	part_cache_invalidate(dev_desc);
 	debug("GPT successfully written to block device!\n");
 	return 0;
 
@@ -872,6 +873,7 @@ int write_mbr_and_gpt_partitions(struct blk_desc *dev_desc, void *buf)
 		       __func__, "Backup GPT Header", cnt, lba);
 		return 1;
 	}
+	part_cache_invalidate(dev_desc);
 
 	return 0;
 }
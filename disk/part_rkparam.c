@@ -0,0 +1,312 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Rockchip parameter partition table.
+ *
+ * The table is a text blob stored at RKPARAM_OFFSET on the boot device:
+ *
+ *	"PARM" | length (le32) | text (length bytes) | crc32 (le32)
+ *
+ * The partitions are listed in the mtdparts= argument of the CMDLINE: line
+ * of the text, as size@offset(name) in hex sectors, '-' meaning the rest of
+ * the device. The crc32 is the rockchip one, see lib/crc32_rk.c.
+ *
+ * The table is read and parsed once per device and then served from RAM,
+ * with a name hash for part_rkparam_get_info_by_name(). It is read again
+ * once the partition cache generation moves on, i.e. after a write to the
+ * table area or a part_init() of the device.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <part.h>
+#include <asm/unaligned.h>
+#include <u-boot/crc.h>
+
+#ifdef HAVE_BLOCK_DEVICE
+
+#define RKPARAM_OFFSET		0x2000
+#define RKPARAM_TAG		0x4D524150	/* "PARM" */
+#define RKPARAM_HDR_SIZE	8
+#define RKPARAM_MAX_SIZE	(64 * 1024)
+/* Blocks the table may cover, whatever the block size */
+#define RKPARAM_MAX_BLKS	(RKPARAM_MAX_SIZE / 512)
+#define RKPARAM_HASH_SIZE	32
+
+struct rkparam_part {
+	char name[PART_NAME_LEN];
+	lbaint_t start;
+	lbaint_t size;
+	int next;		/* next index in the same hash chain, or -1 */
+};
+
+/*
+ * One table per device that has been looked at; devices without a valid
+ * parameter keep an empty table with num < 0 so they are not read again.
+ */
+struct rkparam_table {
+	struct list_head link;
+	struct blk_desc *dev_desc;
+	unsigned int gen;	/* part_cache_generation() when read */
+	int num;
+	char *cmdline;
+	int hash[RKPARAM_HASH_SIZE];
+	struct rkparam_part parts[RKPARAM_ENTRY_NUMBERS];
+};
+
+static LIST_HEAD(rkparam_tables);
+
+static uint rkparam_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash % RKPARAM_HASH_SIZE;
+}
+
+static void rkparam_add(struct rkparam_table *table, const char *name,
+			int len, lbaint_t start, lbaint_t size)
+{
+	struct rkparam_part *part = &table->parts[table->num];
+	uint hash;
+
+	len = min_t(int, len, PART_NAME_LEN - 1);
+	memcpy(part->name, name, len);
+	part->name[len] = '\0';
+	part->start = start;
+	part->size = size;
+
+	hash = rkparam_name_hash(part->name);
+	part->next = table->hash[hash];
+	table->hash[hash] = table->num++;
+	debug("0x%lx@0x%lx(%s)\n", (ulong)size, (ulong)start, part->name);
+}
+
+static int rkparam_parse(struct blk_desc *dev_desc,
+			 struct rkparam_table *table, char *param)
+{
+	char *cmdline = strstr(param, "CMDLINE:");
+	char *next, *pend;
+	lbaint_t size, start;
+
+	if (!cmdline)
+		return -EINVAL;
+	cmdline += strlen("CMDLINE:");
+	next = strchr(cmdline, '\n');
+	if (next)
+		*next = '\0';
+	table->cmdline = strdup(cmdline);
+
+	next = strstr(cmdline, "mtdparts");
+	if (next)
+		next = strchr(next, ':');
+	if (!next)
+		return -EINVAL;
+	next++;
+
+	while (*next && table->num < RKPARAM_ENTRY_NUMBERS) {
+		if (*next == '-') {
+			size = 0;
+			next++;
+		} else {
+			size = simple_strtoul(next, &next, 16);
+		}
+		next++;
+		start = simple_strtoul(next, &next, 16);
+		next++;
+		pend = strchr(next, ')');
+		if (!pend)
+			break;
+		if (!size)
+			size = start < dev_desc->lba ? dev_desc->lba - start : 0;
+		rkparam_add(table, next, pend - next, start, size);
+		next = strchr(pend, ',');
+		if (!next)
+			break;
+		next++;
+	}
+
+	return 0;
+}
+
+/*
+ * Read the table from the device: the first block gives the length of the
+ * text, so only the blocks it really covers are read after that.
+ */
+static int rkparam_read(struct blk_desc *dev_desc, struct rkparam_table *table)
+{
+	lbaint_t blks;
+	u32 length, crc;
+	char *param;
+	int ret = -EINVAL;
+
+	param = malloc_cache_aligned(dev_desc->blksz);
+	if (!param)
+		return -ENOMEM;
+	if (blk_dread(dev_desc, RKPARAM_OFFSET, 1, param) != 1 ||
+	    get_unaligned_le32(param) != RKPARAM_TAG)
+		goto out;
+
+	length = get_unaligned_le32(param + 4);
+	if (length > RKPARAM_MAX_SIZE - RKPARAM_HDR_SIZE - 4)
+		goto out;
+	blks = DIV_ROUND_UP(RKPARAM_HDR_SIZE + length + 4, dev_desc->blksz);
+	if (blks > 1) {
+		free(param);
+		param = malloc_cache_aligned(blks * dev_desc->blksz);
+		if (!param)
+			return -ENOMEM;
+		if (blk_dread(dev_desc, RKPARAM_OFFSET, blks, param) != blks)
+			goto out;
+	}
+
+	crc = get_unaligned_le32(param + RKPARAM_HDR_SIZE + length);
+	if (crc32_rk(0, (uchar *)param + RKPARAM_HDR_SIZE, length) != crc) {
+		printf("%s: bad parameter crc32\n", __func__);
+		goto out;
+	}
+	param[RKPARAM_HDR_SIZE + length] = '\0';
+
+	ret = rkparam_parse(dev_desc, table, param + RKPARAM_HDR_SIZE);
+	if (ret)
+		printf("%s: invalid parameter\n", __func__);
+
+out:
+	free(param);
+	return ret;
+}
+
+static struct rkparam_table *rkparam_get(struct blk_desc *dev_desc)
+{
+	struct rkparam_table *table;
+
+	list_for_each_entry(table, &rkparam_tables, link) {
+		if (table->dev_desc != dev_desc)
+			continue;
+		if (table->gen == part_cache_generation())
+			return table->num < 0 ? NULL : table;
+		/* The table may have been rewritten */
+		list_del(&table->link);
+		free(table->cmdline);
+		free(table);
+		break;
+	}
+
+	table = calloc(1, sizeof(*table));
+	if (!table)
+		return NULL;
+	memset(table->hash, -1, sizeof(table->hash));
+	table->dev_desc = dev_desc;
+	table->gen = part_cache_generation();
+	if (rkparam_read(dev_desc, table)) {
+		free(table->cmdline);
+		table->cmdline = NULL;
+		table->num = -1;
+	}
+	list_add(&table->link, &rkparam_tables);
+
+	return table->num < 0 ? NULL : table;
+}
+
+static void rkparam_fill_info(struct blk_desc *dev_desc,
+			      struct rkparam_part *part, disk_partition_t *info)
+{
+	info->start = part->start;
+	info->size = part->size;
+	info->blksz = dev_desc->blksz;
+	strcpy((char *)info->name, part->name);
+	strcpy((char *)info->type, "U-Boot");
+	info->bootable = 0;
+#if CONFIG_IS_ENABLED(PARTITION_UUIDS)
+	info->uuid[0] = '\0';
+#endif
+#ifdef CONFIG_PARTITION_TYPE_GUID
+	info->type_guid[0] = '\0';
+#endif
+}
+
+int part_rkparam_get_info_by_name(struct blk_desc *dev_desc,
+				  const char *name, disk_partition_t *info)
+{
+	struct rkparam_table *table = rkparam_get(dev_desc);
+	int i;
+
+	if (!table)
+		return -ENODEV;
+
+	for (i = table->hash[rkparam_name_hash(name)]; i >= 0;
+	     i = table->parts[i].next) {
+		if (!strcmp(table->parts[i].name, name)) {
+			rkparam_fill_info(dev_desc, &table->parts[i], info);
+			return i + 1;
+		}
+	}
+
+	return -ENOENT;
+}
+
+const char *part_rkparam_get_cmdline(struct blk_desc *dev_desc)
+{
+	struct rkparam_table *table = rkparam_get(dev_desc);
+
+	return table ? table->cmdline : NULL;
+}
+
+static int part_get_info_rkparam(struct blk_desc *dev_desc, int part,
+				 disk_partition_t *info)
+{
+	struct rkparam_table *table = rkparam_get(dev_desc);
+
+	if (!table || part < 1 || part > table->num)
+		return -1;
+
+	rkparam_fill_info(dev_desc, &table->parts[part - 1], info);
+
+	return 0;
+}
+
+static void part_print_rkparam(struct blk_desc *dev_desc)
+{
+	struct rkparam_table *table = rkparam_get(dev_desc);
+	struct rkparam_part *part;
+	int i;
+
+	if (!table) {
+		printf("## Unknown partition table type %x\n",
+		       PART_TYPE_RKPARAM);
+		return;
+	}
+
+	printf("Part\tStart LBA\tEnd LBA\t\tName\n");
+	for (i = 0; i < table->num; i++) {
+		part = &table->parts[i];
+		printf("%3d\t" LBAF "\t" LBAF "\t%s\n", i + 1, part->start,
+		       part->start + part->size - 1, part->name);
+	}
+}
+
+static int part_test_rkparam(struct blk_desc *dev_desc)
+{
+	return rkparam_get(dev_desc) ? 0 : -1;
+}
+
+U_BOOT_PART_TYPE(rkparam) = {
+	.name		= "RKPARAM",
+	.part_type	= PART_TYPE_RKPARAM,
+	.max_entries	= RKPARAM_ENTRY_NUMBERS,
+	.get_info	= part_get_info_ptr(part_get_info_rkparam),
+	.print		= part_print_ptr(part_print_rkparam),
+	.test		= part_test_rkparam,
+	.table_start	= RKPARAM_OFFSET,
+	.table_blks	= RKPARAM_MAX_BLKS,
+};
+#endif
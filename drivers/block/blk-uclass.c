@@ -24,6 +24,7 @@ static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_SYSTEMACE]	= "ace",
 	[IF_TYPE_NVME]		= "nvme",
 	[IF_TYPE_RKNAND]	= "rknand",
+	[IF_TYPE_SPINOR]	= "spinor",
 };
 
 static enum uclass_id if_type_uclass_id[IF_TYPE_COUNT] = {
@@ -38,6 +39,7 @@ static enum uclass_id if_type_uclass_id[IF_TYPE_COUNT] = {
 	[IF_TYPE_HOST]		= UCLASS_ROOT,
 	[IF_TYPE_NVME]		= UCLASS_NVME,
 	[IF_TYPE_RKNAND]	= UCLASS_RKNAND,
+	[IF_TYPE_SPINOR]	= UCLASS_SPI_FLASH,
 	[IF_TYPE_SYSTEMACE]	= UCLASS_INVALID,
 };
 
@@ -437,6 +439,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	part_cache_check_write(block_dev, start, blkcnt);
+	block_dev->write_gen++;
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -450,6 +454,8 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	part_cache_check_write(block_dev, start, blkcnt);
+	block_dev->write_gen++;
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -626,8 +632,21 @@ int blk_unbind_all(int if_type)
 	return 0;
 }
 
+/*
+ * The device may come back as another medium (or not come back at all),
+ * so forget its partitions. This is done on removal since the descriptor
+ * is gone by the time the uclass sees an unbind.
+ */
+static int blk_pre_remove(struct udevice *dev)
+{
+	part_cache_invalidate(dev_get_uclass_platdata(dev));
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
+	.pre_remove	= blk_pre_remove,
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
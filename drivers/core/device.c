@@ -28,10 +28,40 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
-static int device_bind_common(struct udevice *parent, const struct driver *drv,
-			      const char *name, void *platdata,
-			      ulong driver_data, ofnode node,
-			      uint of_platdata_size, struct udevice **devp)
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/*
+ * Time spent binding and probing other devices from within the current
+ * bind or probe, which is not charged to the current device. This is in
+ * .data since devices are bound and probed before BSS is available.
+ */
+static ulong dm_timing_nested __attribute__((section(".data")));
+
+static ulong dm_timing_enter(ulong *outerp)
+{
+	*outerp = dm_timing_nested;
+	dm_timing_nested = 0;
+
+	return timer_get_boot_us();
+}
+
+/* Returns the time charged to this device and sets *totalp to the total */
+static ulong dm_timing_leave(ulong start, ulong outer, ulong *totalp)
+{
+	ulong total = timer_get_boot_us() - start;
+	ulong self = total - dm_timing_nested;
+
+	dm_timing_nested = outer + total;
+	if (totalp)
+		*totalp = total;
+
+	return self;
+}
+#endif
+
+static int device_do_bind(struct udevice *parent, const struct driver *drv,
+			  const char *name, void *platdata, ulong driver_data,
+			  ofnode node, uint of_platdata_size,
+			  struct udevice **devp)
 {
 	struct udevice *dev;
 	struct uclass *uc;
@@ -212,6 +242,32 @@ fail_alloc1:
 	return ret;
 }
 
+static int device_bind_common(struct udevice *parent, const struct driver *drv,
+			      const char *name, void *platdata,
+			      ulong driver_data, ofnode node,
+			      uint of_platdata_size, struct udevice **devp)
+{
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	struct udevice *dev;
+	ulong start, outer, self;
+	int ret;
+
+	start = dm_timing_enter(&outer);
+	ret = device_do_bind(parent, drv, name, platdata, driver_data, node,
+			     of_platdata_size, &dev);
+	self = dm_timing_leave(start, outer, NULL);
+	if (!ret)
+		dev->timing.bind_us = self;
+	if (devp)
+		*devp = dev;
+
+	return ret;
+#else
+	return device_do_bind(parent, drv, name, platdata, driver_data, node,
+			      of_platdata_size, devp);
+#endif
+}
+
 int device_bind_with_driver_data(struct udevice *parent,
 				 const struct driver *drv, const char *name,
 				 ulong driver_data, ofnode node,
@@ -292,7 +348,24 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_ofdata_to_platdata(struct udevice *dev)
+{
+	const struct driver *drv = dev->driver;
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	ulong start, outer;
+	int ret;
+
+	start = dm_timing_enter(&outer);
+	ret = drv->ofdata_to_platdata(dev);
+	dev->timing.ofdata_us += dm_timing_leave(start, outer, NULL);
+
+	return ret;
+#else
+	return drv->ofdata_to_platdata(dev);
+#endif
+}
+
+static int device_do_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
@@ -384,7 +457,7 @@ int device_probe(struct udevice *dev)
 	}
 
 	if (drv->ofdata_to_platdata && dev_has_of_node(dev)) {
-		ret = drv->ofdata_to_platdata(dev);
+		ret = device_ofdata_to_platdata(dev);
 		if (ret)
 			goto fail;
 	}
@@ -419,6 +492,34 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	ulong start, outer, self, total;
+	uint count;
+	int ret;
+
+	if (!dev || (dev->flags & DM_FLAG_ACTIVATED))
+		return device_do_probe(dev);
+
+	count = dev->timing.probe_count;
+	start = dm_timing_enter(&outer);
+	ret = device_do_probe(dev);
+	self = dm_timing_leave(start, outer, &total);
+
+	/* Probing a parent may already have probed (and counted) the device */
+	if (!ret && dev->timing.probe_count == count) {
+		dev->timing.probe_us += self;
+		dev->timing.probe_total_us += total;
+		dev->timing.probe_count++;
+	}
+
+	return ret;
+#else
+	return device_do_probe(dev);
+#endif
+}
+
 void *dev_get_platdata(struct udevice *dev)
 {
 	if (!dev) {
@@ -16,8 +16,11 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -123,10 +126,117 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/*
+ * Index of the compatible strings in every driver's of_match table, so that
+ * binding a node need not search each driver. This is an open-addressing
+ * hash table built on first use after relocation: before that the malloc()
+ * area is small and only a few nodes are bound.
+ */
+struct compat_entry {
+	const char *compat;
+	struct driver *drv;
+	const struct udevice_id *id;
+};
+
+static struct compat_entry *compat_index;
+static uint compat_index_mask;
+
+/* FNV-1a */
+static uint compat_hash(const char *compat)
+{
+	uint hash = 2166136261U;
+
+	while (*compat)
+		hash = (hash ^ (u8)*compat++) * 16777619U;
+
+	return hash;
+}
+
+/* Returns the slot holding @compat, or the empty slot where it would go */
+static struct compat_entry *compat_index_find(const char *compat)
+{
+	struct compat_entry *ent;
+	uint i;
+
+	for (i = compat_hash(compat); ; i++) {
+		ent = &compat_index[i & compat_index_mask];
+		if (!ent->compat || !strcmp(ent->compat, compat))
+			return ent;
+	}
+}
+
+static int compat_index_build(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_entry *ent;
+	struct driver *entry;
+	uint count = 0, size;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	/* Keep the table no more than half full */
+	for (size = 16; size < count * 2; size <<= 1)
+		;
+	compat_index = calloc(size, sizeof(*compat_index));
+	if (!compat_index)
+		return -ENOMEM;
+	compat_index_mask = size - 1;
+
+	/* As with a linear search, the first driver listed for a string wins */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			ent = compat_index_find(id->compatible);
+			if (ent->compat)
+				continue;
+			ent->compat = id->compatible;
+			ent->drv = entry;
+			ent->id = id;
+		}
+	}
+	dm_dbg("compatible index: %u strings, %u slots\n", count, size);
+
+	return 0;
+}
+#endif
+
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	if ((gd->flags & GD_FLG_RELOC) &&
+	    (compat_index || !compat_index_build())) {
+		struct compat_entry *ent = compat_index_find(compat);
+
+		if (!ent->compat)
+			return -ENOENT;
+		*drvp = ent->drv;
+		*idp = ent->id;
+
+		return 0;
+	}
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat)) {
+			*drvp = entry;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -162,13 +272,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp)
 		dm_dbg("   - attempt to match compatible string '%s'\n",
 		       compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		ret = lists_driver_lookup_compat(compat, &entry, &id);
+		if (ret)
 			continue;
 
 		dm_dbg("   - found match at '%s'\n", entry->name);
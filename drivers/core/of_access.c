@@ -377,6 +377,41 @@ struct device_node *of_find_compatible_node(struct device_node *from,
 	return np;
 }
 
+/*
+ * Nodes of the tree at of_phandle_root indexed by phandle, so that lookups
+ * do not have to walk the whole tree. Phandles above OF_PHANDLE_CACHE_MAX
+ * are always searched.
+ */
+#define OF_PHANDLE_CACHE_MAX	8192
+
+static struct device_node **of_phandle_cache;
+static const struct device_node *of_phandle_root;
+static phandle of_phandle_count;
+
+static void of_phandle_cache_build(void)
+{
+	struct device_node *np;
+	phandle max = 0;
+
+	free(of_phandle_cache);
+	of_phandle_count = 0;
+	of_phandle_root = gd->of_root;
+
+	for_each_of_allnodes(np)
+		max = max(max, np->phandle);
+	max = min_t(phandle, max, OF_PHANDLE_CACHE_MAX);
+	of_phandle_cache = calloc(max + 1, sizeof(*of_phandle_cache));
+	if (!of_phandle_cache)
+		return;
+	of_phandle_count = max + 1;
+
+	for_each_of_allnodes(np) {
+		if (np->phandle && np->phandle < of_phandle_count &&
+		    !of_phandle_cache[np->phandle])
+			of_phandle_cache[np->phandle] = np;
+	}
+}
+
 struct device_node *of_find_node_by_phandle(phandle handle)
 {
 	struct device_node *np;
@@ -384,6 +419,14 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 	if (!handle)
 		return NULL;
 
+	if (of_phandle_root != gd->of_root)
+		of_phandle_cache_build();
+	if (handle < of_phandle_count) {
+		np = of_phandle_cache[handle];
+		if (np && np->phandle == handle)
+			return of_node_get(np);
+	}
+
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
@@ -0,0 +1,163 @@
+/*
+ * Reporting of the time spent binding and probing devices
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <libfdt.h>
+#include <malloc.h>
+#include <dm/root.h>
+#include <dm/util.h>
+
+/* Time charged to a device itself, see struct dm_timing */
+static ulong dm_timing_cost(const struct udevice *dev)
+{
+	const struct dm_timing *t = &dev->timing;
+
+	return t->bind_us + t->ofdata_us + t->probe_us;
+}
+
+static int dm_timing_count(struct udevice *dev)
+{
+	struct udevice *child;
+	int count = 1;
+
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		count += dm_timing_count(child);
+
+	return count;
+}
+
+static struct udevice **dm_timing_fill(struct udevice *dev,
+				       struct udevice **devs)
+{
+	struct udevice *child;
+
+	*devs++ = dev;
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		devs = dm_timing_fill(child, devs);
+
+	return devs;
+}
+
+static int dm_timing_compare(const void *d1, const void *d2)
+{
+	ulong cost1 = dm_timing_cost(*(struct udevice **)d1);
+	ulong cost2 = dm_timing_cost(*(struct udevice **)d2);
+
+	if (cost1 == cost2)
+		return 0;
+
+	return cost1 < cost2 ? 1 : -1;
+}
+
+/**
+ * dm_timing_get_devices() - Get a list of all devices, most costly first
+ *
+ * @devsp: Returns a list of devices, which the caller must free
+ * @return number of devices, or -ve on error
+ */
+static int dm_timing_get_devices(struct udevice ***devsp)
+{
+	struct udevice *root = dm_root();
+	struct udevice **devs;
+	int count;
+
+	if (!root)
+		return -ENODEV;
+	count = dm_timing_count(root);
+	devs = malloc(count * sizeof(*devs));
+	if (!devs)
+		return -ENOMEM;
+	dm_timing_fill(root, devs);
+	qsort(devs, count, sizeof(*devs), dm_timing_compare);
+	*devsp = devs;
+
+	return count;
+}
+
+void dm_dump_timing(void)
+{
+	ulong bind_us = 0, ofdata_us = 0, probe_us = 0;
+	struct udevice **devs;
+	int count, i;
+
+	count = dm_timing_get_devices(&devs);
+	if (count < 0) {
+		printf("Cannot list devices (err=%d)\n", count);
+		return;
+	}
+
+	printf("Time in microseconds, most costly devices first\n");
+	printf("%9s%9s%9s%9s%6s  %-20s %s\n", "Bind", "Ofdata", "Probe",
+	       "Total", "Count", "Name", "Driver");
+	for (i = 0; i < count; i++) {
+		const struct udevice *dev = devs[i];
+		const struct dm_timing *t = &dev->timing;
+
+		printf("%9lu%9lu%9lu%9lu%6u  %-20s %s\n", t->bind_us,
+		       t->ofdata_us, t->probe_us, t->probe_total_us,
+		       t->probe_count, dev->name, dev->driver->name);
+		bind_us += t->bind_us;
+		ofdata_us += t->ofdata_us;
+		probe_us += t->probe_us;
+	}
+	printf("%9lu%9lu%9lu%9s%6s  %d devices\n", bind_us, ofdata_us,
+	       probe_us, "", "", count);
+	free(devs);
+}
+
+static int dm_timing_add_node(void *blob, int node,
+			      const struct udevice *dev)
+{
+	const struct dm_timing *t = &dev->timing;
+	char name[40];
+
+	/* Use the same form as bootstage's accumulated-time records */
+	snprintf(name, sizeof(name), "dm:%s", dev->name);
+	if (fdt_setprop_string(blob, node, "name", name) ||
+	    fdt_setprop_cell(blob, node, "accum", dm_timing_cost(dev)) ||
+	    fdt_setprop_string(blob, node, "driver", dev->driver->name) ||
+	    fdt_setprop_cell(blob, node, "bind-us", t->bind_us) ||
+	    fdt_setprop_cell(blob, node, "ofdata-us", t->ofdata_us) ||
+	    fdt_setprop_cell(blob, node, "probe-us", t->probe_us) ||
+	    fdt_setprop_cell(blob, node, "probe-total-us",
+			     t->probe_total_us) ||
+	    fdt_setprop_cell(blob, node, "probe-count", t->probe_count))
+		return -EINVAL;
+
+	return 0;
+}
+
+int dm_timing_add_fdt(void *blob, int bootstage, int index)
+{
+	struct udevice **devs;
+	int count, node, i;
+	int ret = 0;
+
+	count = dm_timing_get_devices(&devs);
+	if (count < 0)
+		return count;
+
+	/*
+	 * Only the most costly devices go in, as the blob has little room
+	 * to spare. Devices that took no time are left out.
+	 */
+	count = min(count, CONFIG_DM_TIMING_FDT_COUNT);
+	for (i = 0; i < count && dm_timing_cost(devs[i]); i++) {
+		node = fdt_add_subnode(blob, bootstage, simple_itoa(index));
+		if (node < 0) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = dm_timing_add_node(blob, node, devs[i]);
+		if (ret)
+			break;
+		index++;
+	}
+	free(devs);
+
+	return ret ? ret : index;
+}
@@ -1818,6 +1818,9 @@ static int mmc_startup(struct mmc *mmc)
 			* ext_csd[EXT_CSD_HC_WP_GRP_SIZE];
 
 		mmc->wr_rel_set = ext_csd[EXT_CSD_WR_REL_SET];
+		mmc->erased_mem_cont = ext_csd[EXT_CSD_ERASED_MEM_CONT];
+		mmc->sec_feature_support = ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT];
+		mmc->trim_mult = ext_csd[EXT_CSD_TRIM_MULT];
 	}
 
 	err = mmc_set_capacity(mmc, mmc_get_blk_desc(mmc)->hwpart);
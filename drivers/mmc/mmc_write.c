@@ -15,7 +15,11 @@
 #include <linux/math64.h>
 #include "mmc_private.h"
 
-static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
+/* Groups handled by one mmc_bzero() command, to bound its busy time */
+#define MMC_BZERO_MAX_GRPS	64
+
+static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt,
+			 u32 arg)
 {
 	struct mmc_cmd cmd;
 	ulong end;
@@ -52,7 +56,7 @@ static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
 		goto err_out;
 
 	cmd.cmdidx = MMC_CMD_ERASE;
-	cmd.cmdarg = MMC_ERASE_ARG;
+	cmd.cmdarg = arg;
 	cmd.resp_type = MMC_RSP_R1b;
 
 	err = mmc_send_cmd(mmc, &cmd, NULL);
@@ -113,7 +117,7 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 			blk_r = ((blkcnt - blk) > mmc->erase_grp_size) ?
 				mmc->erase_grp_size : (blkcnt - blk);
 		}
-		err = mmc_erase_t(mmc, start + blk, blk_r);
+		err = mmc_erase_t(mmc, start + blk, blk_r, MMC_ERASE_ARG);
 		if (err)
 			break;
 
@@ -127,6 +131,64 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	return blk;
 }
 
+/*
+ * Erased eMMC blocks read back as ERASED_MEM_CONT, so when that is zero
+ * a range can be cleared without sending any data. TRIM works on single
+ * blocks; without it only whole erase groups can be erased. Returns
+ * blkcnt, or 0 if the range cannot be cleared this way.
+ */
+ulong mmc_bzero(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
+{
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	u32 start_rem, blkcnt_rem;
+	lbaint_t blk = 0, blk_r;
+	int timeout;
+	u32 arg;
+
+	if (!mmc || IS_SD(mmc) || mmc->version < MMC_VERSION_4_41 ||
+	    mmc->erased_mem_cont)
+		return 0;
+
+	if (blk_select_hwpart_devnum(IF_TYPE_MMC, block_dev->devnum,
+				     block_dev->hwpart) < 0)
+		return 0;
+
+	if (mmc->sec_feature_support & EXT_CSD_SEC_GB_CL_EN) {
+		arg = MMC_TRIM_ARG;
+		timeout = 300 * max_t(int, mmc->trim_mult, 1) *
+			  MMC_BZERO_MAX_GRPS;
+	} else {
+		div_u64_rem(start, mmc->erase_grp_size, &start_rem);
+		div_u64_rem(blkcnt, mmc->erase_grp_size, &blkcnt_rem);
+		if (start_rem || blkcnt_rem)
+			return 0;
+		arg = MMC_ERASE_ARG;
+		timeout = 1000 * MMC_BZERO_MAX_GRPS;
+	}
+
+	/* This bypasses the block layer, so drop what it would drop */
+	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	part_cache_check_write(block_dev, start, blkcnt);
+#ifdef CONFIG_BLK
+	block_dev->write_gen++;
+#endif
+
+	while (blk < blkcnt) {
+		blk_r = min_t(lbaint_t, blkcnt - blk,
+			      (lbaint_t)mmc->erase_grp_size *
+			      MMC_BZERO_MAX_GRPS);
+		if (mmc_erase_t(mmc, start + blk, blk_r, arg))
+			return 0;
+		blk += blk_r;
+
+		/* Waiting for the ready status */
+		if (mmc_send_status(mmc, timeout))
+			return 0;
+	}
+
+	return blkcnt;
+}
+
 static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		lbaint_t blkcnt, const void *src)
 {
@@ -95,9 +95,30 @@ static int spi_flash_post_bind(struct udevice *dev)
 	return 0;
 }
 
+#if defined(CONFIG_SPI_FLASH_BLK) && !defined(CONFIG_SPL_BUILD)
+/*
+ * The block device is only added once the flash is probed, so that flash
+ * nobody uses does not show up as a disk and its size is known.
+ */
+static int spi_flash_post_probe(struct udevice *dev)
+{
+	struct udevice *blk;
+
+	/* Children stay bound when the flash is removed and probed again */
+	device_find_first_child(dev, &blk);
+	if (blk)
+		return 0;
+
+	return spi_flash_blk_bind(dev);
+}
+#endif
+
 UCLASS_DRIVER(spi_flash) = {
 	.id		= UCLASS_SPI_FLASH,
 	.name		= "spi_flash",
 	.post_bind	= spi_flash_post_bind,
+#if defined(CONFIG_SPI_FLASH_BLK) && !defined(CONFIG_SPL_BUILD)
+	.post_probe	= spi_flash_post_probe,
+#endif
 	.per_device_auto_alloc_size = sizeof(struct spi_flash),
 };
@@ -0,0 +1,147 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Block device on top of a SPI flash, so that NOR boot media can be used
+ * through blk_dread() and the partition code like any other disk.
+ *
+ * NOR can only clear bits when programming, so writes erase the sectors
+ * they touch first, keeping the rest of a partly written sector.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <spi_flash.h>
+
+#define SF_BLK_SIZE	512
+#define SF_BLK_SHIFT	9
+
+static ulong spi_flash_blk_read(struct udevice *dev, lbaint_t start,
+				lbaint_t blkcnt, void *dst)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	if (start + blkcnt > desc->lba)
+		return 0;
+	if (spi_flash_read_dm(dev->parent, start << SF_BLK_SHIFT,
+			      blkcnt << SF_BLK_SHIFT, dst))
+		return 0;
+
+	return blkcnt;
+}
+
+static ulong spi_flash_blk_write(struct udevice *dev, lbaint_t start,
+				 lbaint_t blkcnt, const void *src)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct spi_flash *flash = dev_get_uclass_priv(dev->parent);
+	u32 offset = start << SF_BLK_SHIFT;
+	u32 end = (start + blkcnt) << SF_BLK_SHIFT;
+	u32 sector, pos, len;
+	u8 *buf = NULL;
+	int ret;
+
+	if (start + blkcnt > desc->lba)
+		return 0;
+
+	while (offset < end) {
+		sector = offset - offset % flash->erase_size;
+		pos = offset - sector;
+		len = min(end - offset, flash->erase_size - pos);
+
+		if (len == flash->erase_size) {
+			ret = spi_flash_erase_dm(dev->parent, sector, len);
+			if (!ret)
+				ret = spi_flash_write_dm(dev->parent, sector,
+							 len, src);
+		} else {
+			/* Keep the part of the sector we do not write */
+			if (!buf) {
+				buf = malloc(flash->erase_size);
+				if (!buf)
+					return 0;
+			}
+			ret = spi_flash_read_dm(dev->parent, sector,
+						flash->erase_size, buf);
+			if (!ret) {
+				memcpy(buf + pos, src, len);
+				ret = spi_flash_erase_dm(dev->parent, sector,
+							 flash->erase_size);
+			}
+			if (!ret)
+				ret = spi_flash_write_dm(dev->parent, sector,
+							 flash->erase_size,
+							 buf);
+		}
+		if (ret) {
+			debug("%s: error %d at 0x%x\n", __func__, ret, offset);
+			free(buf);
+			return 0;
+		}
+		offset += len;
+		src += len;
+	}
+	free(buf);
+
+	return blkcnt;
+}
+
+static ulong spi_flash_blk_erase(struct udevice *dev, lbaint_t start,
+				 lbaint_t blkcnt)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct spi_flash *flash = dev_get_uclass_priv(dev->parent);
+	u32 offset = start << SF_BLK_SHIFT;
+	u32 len = blkcnt << SF_BLK_SHIFT;
+
+	if (start + blkcnt > desc->lba)
+		return 0;
+	/* Only whole sectors can be erased */
+	if (offset % flash->erase_size || len % flash->erase_size)
+		return 0;
+	if (spi_flash_erase_dm(dev->parent, offset, len))
+		return 0;
+
+	return blkcnt;
+}
+
+static int spi_flash_blk_probe(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct spi_flash *flash = dev_get_uclass_priv(dev->parent);
+
+	/* The size is only known once the flash itself has been probed */
+	desc->lba = flash->size >> SF_BLK_SHIFT;
+	desc->log2blksz = SF_BLK_SHIFT;
+	snprintf(desc->product, sizeof(desc->product), "%s",
+		 flash->name ? flash->name : "spi-flash");
+	part_init(desc);
+
+	return 0;
+}
+
+int spi_flash_blk_bind(struct udevice *dev)
+{
+	struct udevice *bdev;
+
+	return blk_create_devicef(dev, "spi_flash_blk", "blk", IF_TYPE_SPINOR,
+				  -1, SF_BLK_SIZE, 0, &bdev);
+}
+
+static const struct blk_ops spi_flash_blk_ops = {
+	.read	= spi_flash_blk_read,
+	.write	= spi_flash_blk_write,
+	.erase	= spi_flash_blk_erase,
+};
+
+U_BOOT_DRIVER(spi_flash_blk) = {
+	.name		= "spi_flash_blk",
+	.id		= UCLASS_BLK,
+	.ops		= &spi_flash_blk_ops,
+	.probe		= spi_flash_blk_probe,
+};
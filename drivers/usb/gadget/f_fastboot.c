@@ -23,6 +23,7 @@
 #include <g_dnl.h>
 #include <android_avb/avb_ops_user.h>
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
+#include <fb_digest.h>
 #include <fb_mmc.h>
 #endif
 #ifdef CONFIG_FASTBOOT_FLASH_NAND_DEV
@@ -49,12 +50,18 @@
  * that expect bulk OUT requests to be divisible by maxpacket size.
  */
 
+#if CONFIG_FASTBOOT_USB_REQ_SIZE % EP_BUFFER_SIZE
+#error "FASTBOOT_USB_REQ_SIZE must be a multiple of 4KB"
+#endif
+
 struct f_fastboot {
 	struct usb_function usb_function;
 
 	/* IN/OUT EP's and corresponding requests */
 	struct usb_ep *in_ep, *out_ep;
 	struct usb_request *in_req, *out_req;
+	/* Download requests, their buffers point into the fastboot buffer */
+	struct usb_request *dl_req[CONFIG_FASTBOOT_USB_REQ_NUM];
 };
 
 static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
@@ -69,6 +76,32 @@ static unsigned int upload_size;
 static unsigned int upload_bytes;
 static bool start_upload;
 
+#ifdef CONFIG_FASTBOOT_STREAM
+/*
+ * Streamed download, see "oem stream": data goes through a ring of slots
+ * at the start of the fastboot buffer and each full slot is written out
+ * by fastboot_poll() while the next USB transfer is already queued.
+ */
+#define STREAM_RING_SIZE	(CONFIG_FASTBOOT_STREAM_SLOT_SIZE * \
+				 CONFIG_FASTBOOT_STREAM_SLOTS)
+#define STREAM_MAX_DOWNLOAD	0xfffff000
+
+#if STREAM_RING_SIZE > CONFIG_FASTBOOT_BUF_SIZE
+#error "FASTBOOT_STREAM ring does not fit in FASTBOOT_BUF_SIZE"
+#endif
+#if CONFIG_FASTBOOT_STREAM_SLOT_SIZE % EP_BUFFER_SIZE
+#error "FASTBOOT_STREAM_SLOT_SIZE must be a multiple of 4KB"
+#endif
+
+static bool stream_armed;	/* next download is streamed */
+static bool stream_active;	/* current download is streamed */
+static bool stream_received;	/* all of it is in the ring */
+static bool stream_done;	/* stream_response holds the result */
+static unsigned int stream_drained;
+static char stream_part[32];
+static char stream_response[FASTBOOT_RESPONSE_LEN];
+#endif
+
 static struct usb_endpoint_descriptor fs_ep_in = {
 	.bLength            = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType    = USB_DT_ENDPOINT,
@@ -216,13 +249,44 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 	memset(fastboot_func, 0, sizeof(*fastboot_func));
 }
 
+#ifdef CONFIG_FASTBOOT_STREAM
+/* Drop a streamed download that will not complete, and its result */
+static void stream_reset(void)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+
+	if (stream_active)
+		fb_mmc_stream_finish(response);
+	stream_active = false;
+	stream_received = false;
+	stream_done = false;
+	stream_drained = 0;
+}
+#endif
+
 static void fastboot_disable(struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
+	int i;
+
+	/* Requests given back while disabling are for a dropped download */
+	download_size = 0;
+#ifdef CONFIG_FASTBOOT_STREAM
+	/* The next session starts over, e.g. after a disconnect mid-stream */
+	stream_reset();
+	stream_armed = false;
+#endif
 
 	usb_ep_disable(f_fb->out_ep);
 	usb_ep_disable(f_fb->in_ep);
 
+	for (i = 0; i < CONFIG_FASTBOOT_USB_REQ_NUM; i++) {
+		if (f_fb->dl_req[i]) {
+			usb_ep_free_request(f_fb->out_ep, f_fb->dl_req[i]);
+			f_fb->dl_req[i] = NULL;
+		}
+	}
+
 	if (f_fb->out_req) {
 		free(f_fb->out_req->buf);
 		usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
@@ -262,6 +326,7 @@ static int fastboot_set_alt(struct usb_function *f,
 	struct usb_gadget *gadget = cdev->gadget;
 	struct f_fastboot *f_fb = func_to_fastboot(f);
 	const struct usb_endpoint_descriptor *d;
+	int i;
 
 	debug("%s: func: %s intf: %d alt: %d\n",
 	      __func__, f->name, interface, alt);
@@ -281,6 +346,15 @@ static int fastboot_set_alt(struct usb_function *f,
 	}
 	f_fb->out_req->complete = rx_handler_command;
 
+	for (i = 0; i < CONFIG_FASTBOOT_USB_REQ_NUM; i++) {
+		f_fb->dl_req[i] = usb_ep_alloc_request(f_fb->out_ep, 0);
+		if (!f_fb->dl_req[i]) {
+			puts("failed to alloc download req\n");
+			ret = -ENOMEM;
+			goto err;
+		}
+	}
+
 	d = fb_ep_desc(gadget, &fs_ep_in, &hs_ep_in);
 	ret = usb_ep_enable(f_fb->in_ep, d);
 	if (ret) {
@@ -430,6 +504,10 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 		char str_num[12];
 
 		sprintf(str_num, "0x%08x", CONFIG_FASTBOOT_BUF_SIZE);
+#ifdef CONFIG_FASTBOOT_STREAM
+		if (stream_armed)
+			sprintf(str_num, "0x%08x", STREAM_MAX_DOWNLOAD);
+#endif
 		strncat(response, str_num, chars_left);
 	} else if (!strcmp_l1("serialno", cmd)) {
 		s = env_get("serial#");
@@ -583,6 +661,16 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 #else
 		fastboot_tx_write_str("FAILnot implemented");
 		return;
+#endif
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST
+	} else if (!strncmp("partition-digest:", cmd, 17)) {
+		const char *digest = fb_digest_get(cmd + 17);
+
+		/* A SHA-256 digest is cut short to fit */
+		if (digest)
+			strncat(response, digest, chars_left);
+		else
+			strcpy(response, "FAILno digest for partition");
 #endif
 	} else if (!strncmp("partition-type", cmd, 14) ||
 		   !strncmp("partition-size", cmd, 14)) {
@@ -626,16 +714,31 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 	fastboot_tx_write_str(response);
 }
 
-static unsigned int rx_bytes_expected(struct usb_ep *ep)
+/*
+ * Downloads are received straight into the fastboot buffer: up to
+ * CONFIG_FASTBOOT_USB_REQ_NUM requests of CONFIG_FASTBOOT_USB_REQ_SIZE
+ * bytes are kept queued, each pointing at its own slice of the buffer,
+ * so the controller always has somewhere to put the next data and
+ * nothing is copied. Requests complete in the order they were queued.
+ */
+static unsigned int dl_queued;		/* bytes covered by queued requests */
+static unsigned int dl_head;		/* next request to queue */
+static unsigned int dl_inflight;	/* requests queued */
+
+static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req);
+
+/* Length of the next request, at most @max bytes */
+static unsigned int rx_bytes_expected(struct usb_ep *ep, unsigned int max)
 {
-	int rx_remain = download_size - download_bytes;
+	unsigned int rx_remain;
 	unsigned int rem;
 	unsigned int maxpacket = ep->maxpacket;
 
-	if (rx_remain <= 0)
+	if (dl_queued >= download_size)
 		return 0;
-	else if (rx_remain > EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	rx_remain = download_size - dl_queued;
+	if (rx_remain >= max)
+		return max;
 
 	/*
 	 * Some controllers e.g. DWC3 don't like OUT transfers to be
@@ -650,33 +753,135 @@ static unsigned int rx_bytes_expected(struct usb_ep *ep)
 	return rx_remain;
 }
 
+#ifdef CONFIG_FASTBOOT_STREAM
+/* Write out full slots, or everything left when @all is set */
+static void stream_drain(bool all)
+{
+	unsigned int pos, len;
+
+	while (download_bytes > stream_drained) {
+		len = min(download_bytes - stream_drained,
+			  (unsigned int)CONFIG_FASTBOOT_STREAM_SLOT_SIZE);
+		if (len < CONFIG_FASTBOOT_STREAM_SLOT_SIZE && !all)
+			break;
+		/* Slots never wrap, they divide the ring evenly */
+		pos = stream_drained % STREAM_RING_SIZE;
+		fb_mmc_stream_write((void *)CONFIG_FASTBOOT_BUF_ADDR + pos, len);
+		stream_drained += len;
+	}
+}
+#endif
+
+/* Queue requests for the rest of the download, as far as buffers allow */
+static void rx_dl_fill(struct usb_ep *ep)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	struct usb_request *req;
+	unsigned int pos, len, max;
+
+	while (dl_inflight < CONFIG_FASTBOOT_USB_REQ_NUM) {
+		pos = dl_queued;
+		max = CONFIG_FASTBOOT_USB_REQ_SIZE;
+#ifdef CONFIG_FASTBOOT_STREAM
+		if (stream_active) {
+			/*
+			 * Stay within one slot of the ring, and off the
+			 * slots that have not been written out yet.
+			 */
+			pos = dl_queued % STREAM_RING_SIZE;
+			max = min(max, CONFIG_FASTBOOT_STREAM_SLOT_SIZE -
+				  pos % CONFIG_FASTBOOT_STREAM_SLOT_SIZE);
+			if (dl_queued + max > stream_drained + STREAM_RING_SIZE)
+				break;
+		}
+#endif
+		len = rx_bytes_expected(ep, max);
+		if (!len)
+			break;
+
+		req = f_fb->dl_req[dl_head];
+		req->buf = (void *)CONFIG_FASTBOOT_BUF_ADDR + pos;
+		req->length = len;
+		req->actual = 0;
+		req->complete = rx_handler_dl_image;
+		if (usb_ep_queue(ep, req, 0))
+			break;
+
+		dl_head = (dl_head + 1) % CONFIG_FASTBOOT_USB_REQ_NUM;
+		dl_inflight++;
+		dl_queued += min(len, download_size - dl_queued);
+	}
+}
+
+/*
+ * The command request stays off the endpoint during a download: a FIFO
+ * controller (DWC3) would hand it the download data otherwise.
+ */
+static void rx_command_queue(struct usb_ep *ep)
+{
+	struct usb_request *req = fastboot_func->out_req;
+
+	*(char *)req->buf = '\0';
+	req->actual = 0;
+	usb_ep_queue(ep, req, 0);
+}
+
+/* Give up on the current download, e.g. after the host stopped short */
+static void rx_dl_abort(struct usb_ep *ep, const char *reason)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	char response[FASTBOOT_RESPONSE_LEN];
+	unsigned int i;
+
+	download_size = 0;
+	download_bytes = 0;
+	for (i = 0; i < CONFIG_FASTBOOT_USB_REQ_NUM; i++)
+		usb_ep_dequeue(ep, f_fb->dl_req[i]);
+	dl_inflight = 0;
+
+#ifdef CONFIG_FASTBOOT_STREAM
+	stream_reset();
+#endif
+
+	printf("\ndownload failed: %s\n", reason);
+	rx_command_queue(ep);
+	fastboot_fail(reason, response);
+	fastboot_tx_write_str(response);
+}
+
 #define BYTES_PER_DOT	0x20000
 static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 {
 	char response[FASTBOOT_RESPONSE_LEN];
 	unsigned int transfer_size = download_size - download_bytes;
-	const unsigned char *buffer = req->buf;
-	unsigned int buffer_size = req->actual;
 	unsigned int pre_dot_num, now_dot_num;
 
+	/* Requests taken back by rx_dl_abort() end up here too */
+	if (!download_size || !dl_inflight)
+		return;
+	dl_inflight--;
+
 	if (req->status != 0) {
 		printf("Bad status: %d\n", req->status);
+		rx_dl_abort(ep, "bad transfer status");
 		return;
 	}
 
-	if (buffer_size < transfer_size)
-		transfer_size = buffer_size;
-
-	memcpy((void *)CONFIG_FASTBOOT_BUF_ADDR + download_bytes,
-	       buffer, transfer_size);
+	if (req->length < transfer_size)
+		transfer_size = req->length;
+	if (req->actual < transfer_size) {
+		/* Later requests would put the data in the wrong place */
+		rx_dl_abort(ep, "short data transfer");
+		return;
+	}
 
 	pre_dot_num = download_bytes / BYTES_PER_DOT;
 	download_bytes += transfer_size;
 	now_dot_num = download_bytes / BYTES_PER_DOT;
 
-	if (pre_dot_num != now_dot_num) {
+	while (pre_dot_num++ != now_dot_num) {
 		putc('.');
-		if (!(now_dot_num % 74))
+		if (!(pre_dot_num % 74))
 			putc('\n');
 	}
 
@@ -687,41 +892,97 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 		 * it will be used in the next possible flashing command
 		 */
 		download_size = 0;
-		req->complete = rx_handler_command;
-		req->length = EP_BUFFER_SIZE;
 
+		printf("\ndownloading of %u bytes finished\n", download_bytes);
+
+#ifdef CONFIG_FASTBOOT_STREAM
+		/* fastboot_poll() writes out the rest and says OKAY */
+		if (stream_active) {
+			stream_received = true;
+			return;
+		}
+#endif
+
+		rx_command_queue(ep);
 		strcpy(response, "OKAY");
 		fastboot_tx_write_str(response);
+		return;
+	}
 
-		printf("\ndownloading of %d bytes finished\n", download_bytes);
-	} else {
-		req->length = rx_bytes_expected(ep);
+	rx_dl_fill(ep);
+}
+
+void fastboot_poll(void)
+{
+#ifdef CONFIG_FASTBOOT_STREAM
+	struct usb_ep *ep;
+
+	if (!stream_active)
+		return;
+	ep = fastboot_func->out_ep;
+
+	/* Write to the device while the controller receives the next data */
+	stream_drain(stream_received);
+	if (!stream_received) {
+		rx_dl_fill(ep);
+		return;
 	}
 
-	req->actual = 0;
-	usb_ep_queue(ep, req, 0);
+	/*
+	 * The result goes to the flash command that follows.
+	 * Nothing is left in the buffer for other commands.
+	 */
+	fb_mmc_stream_finish(stream_response);
+	stream_active = false;
+	stream_received = false;
+	stream_done = true;
+	download_bytes = 0;
+
+	rx_command_queue(ep);
+	fastboot_tx_write_str("OKAY");
+#endif
 }
 
 static void cb_download(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmd = req->buf;
 	char response[FASTBOOT_RESPONSE_LEN];
+	unsigned int max_size = CONFIG_FASTBOOT_BUF_SIZE;
 
 	strsep(&cmd, ":");
 	download_size = simple_strtoul(cmd, NULL, 16);
 	download_bytes = 0;
-
-	printf("Starting download of %d bytes\n", download_size);
+	dl_queued = 0;
+	dl_head = 0;
+	dl_inflight = 0;
+
+	printf("Starting download of %u bytes\n", download_size);
+
+#ifdef CONFIG_FASTBOOT_STREAM
+	/* Nothing of an earlier stream carries over into this download */
+	stream_reset();
+	if (stream_armed && download_size) {
+		stream_armed = false;
+		if (fb_mmc_stream_start(stream_part, download_size, response)) {
+			download_size = 0;
+			fastboot_tx_write_str(response);
+			return;
+		}
+		stream_active = true;
+		max_size = STREAM_MAX_DOWNLOAD;
+		printf("Streaming to '%s'\n", stream_part);
+	}
+#endif
 
 	if (0 == download_size) {
 		strcpy(response, "FAILdata invalid size");
-	} else if (download_size > CONFIG_FASTBOOT_BUF_SIZE) {
+	} else if (download_size > max_size) {
 		download_size = 0;
 		strcpy(response, "FAILdata too large");
 	} else {
+		/* The command request is queued again once this is done */
 		sprintf(response, "DATA%08x", download_size);
-		req->complete = rx_handler_dl_image;
-		req->length = rx_bytes_expected(ep);
+		rx_dl_fill(ep);
 	}
 
 	fastboot_tx_write_str(response);
@@ -888,6 +1149,18 @@ static void cb_flash(struct usb_ep *ep, struct usb_request *req)
 		return;
 	}
 
+#ifdef CONFIG_FASTBOOT_STREAM
+	if (stream_done) {
+		/* The image has already been written while downloading */
+		stream_done = false;
+		if (strcmp(cmd, stream_part))
+			fastboot_tx_write_str("FAILimage was streamed to another partition");
+		else
+			fastboot_tx_write_str(stream_response);
+		return;
+	}
+#endif
+
 	fastboot_fail("no flash device defined", response);
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
 	fb_mmc_flash_write(cmd, (void *)CONFIG_FASTBOOT_BUF_ADDR,
@@ -958,6 +1231,39 @@ static void cb_oem(struct usb_ep *ep, struct usb_request *req)
                 else
 			fastboot_tx_write_str("OKAY");
 	} else
+#endif
+#ifdef CONFIG_FASTBOOT_STREAM
+	if (strncmp("stream", cmd + 4, 6) == 0) {
+		/* oem stream <partition>: stream the next download there */
+		if (cmd[10] != ' ' || !cmd[11]) {
+			fastboot_tx_write_str("FAILmissing partition name");
+			return;
+		}
+		strlcpy(stream_part, cmd + 11, sizeof(stream_part));
+		stream_armed = true;
+		fastboot_tx_write_str("OKAY");
+	} else
+#endif
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST
+	if (strncmp("digest", cmd + 4, 6) == 0) {
+		/*
+		 * oem digest <partition>: the digest of the last image
+		 * flashed there, also staged in full for get_staged
+		 */
+		char response[FASTBOOT_RESPONSE_LEN];
+		const char *digest = NULL;
+
+		if (cmd[10] == ' ')
+			digest = fb_digest_get(cmd + 11);
+		if (!digest) {
+			fastboot_tx_write_str("FAILno digest for partition");
+			return;
+		}
+		upload_size = sprintf((char *)CONFIG_FASTBOOT_BUF_ADDR, "%s\n",
+				      digest);
+		fastboot_okay(digest, response);
+		fastboot_tx_write_str(response);
+	} else
 #endif
 	if (strncmp("unlock", cmd + 4, 8) == 0) {
 		fastboot_tx_write_str("FAILnot implemented");
@@ -1193,7 +1499,7 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 		}
 	}
 
-	*cmdbuf = '\0';
-	req->actual = 0;
-	usb_ep_queue(ep, req, 0);
+	/* A download queues it again when it is over */
+	if (!download_size)
+		rx_command_queue(ep);
 }
@@ -222,6 +222,25 @@ struct AvbOps {
 	AvbIOResult (*get_size_of_partition)(AvbOps* ops,
                                        	     const char* partition,
                                              uint64_t* out_size_num_bytes);
+
+	/* Gets the buffer the image in the partition with name in
+	 * |partition| (NUL-terminated UTF-8 string) should be loaded to,
+	 * e.g. the address it is going to be used at, so that it does not
+	 * have to be copied there after verification. The buffer must be
+	 * at least |num_bytes| long. Its address is returned in
+	 * |out_pointer|, or NULL to let avb_slot_verify() allocate one.
+	 *
+	 * Images loaded this way are marked |preloaded| in the
+	 * AvbPartitionData and are not freed by avb_slot_verify_data_free().
+	 *
+	 * This operation is optional and may be NULL.
+	 *
+	 * Returns AVB_IO_RESULT_OK on success, otherwise an error code.
+	 */
+	AvbIOResult (*get_load_buffer)(AvbOps* ops,
+                                       const char* partition,
+                                       size_t num_bytes,
+                                       uint8_t** out_pointer);
 };
 
 #ifdef __cplusplus
@@ -63,6 +63,28 @@ AvbOps* avb_ops_user_new(void);
 /* Frees an AvbOps instance previously allocated with avb_ops_device_new(). */
 void avb_ops_user_free(AvbOps* ops);
 
+/**
+ * Get the block device holding the partitions. The default is mmc 0,
+ * boards override this with the device they booted from.
+ *
+ * @return block device, or NULL if not found
+ */
+struct blk_desc *avb_ops_user_get_blk(void);
+
+/**
+ * Have the image of a partition verified in place, at the address it is
+ * going to be used at, instead of in a buffer it is then copied from.
+ * Only the first slot of @partition loaded gets @buf, it is marked
+ * preloaded in the slot data.
+ *
+ * @param ops        AvbOps from avb_ops_user_new()
+ * @param partition  Partition name, without slot suffix
+ * @param buf        Load buffer, or NULL to stop using one
+ * @param size       Size of @buf, larger images are loaded elsewhere
+ */
+void avb_ops_user_set_load_buffer(AvbOps *ops, const char *partition,
+				  void *buf, size_t size);
+
 /**
  * Provided to fastboot to read how many slot in this system.
  *
@@ -119,6 +119,16 @@ void avb_free(void* ptr);
 /* Returns the lenght of |str|, excluding the terminating NUL-byte. */
 size_t avb_strlen(const char* str) AVB_ATTR_WARN_UNUSED_RESULT;
 
+/* Hashes |num_blocks| 64-byte SHA-256 blocks from |data| into |state|
+ * using a platform accelerator.
+ *
+ * Returns false if no accelerator is available, in which case |state|
+ * is unchanged and the portable implementation is used.
+ */
+bool avb_sha256_transform_hw(uint32_t state[8],
+                             const uint8_t* data,
+                             size_t num_blocks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
  */
 
 #ifndef __ASSEMBLY__
+#include <initcall.h>
 #include <membuff.h>
 #include <linux/list.h>
 
@@ -120,6 +121,10 @@ typedef struct global_data {
 #ifdef CONFIG_BOOTSTAGE
 	struct bootstage_data *bootstage;	/* Bootstage information */
 	struct bootstage_data *new_bootstage;	/* Relocated bootstage info */
+#endif
+#if CONFIG_IS_ENABLED(BOOTSTAGE_INITCALL)
+	uint initcall_count;		/* Number of initcalls run */
+	struct initcall_record initcall_rec[CONFIG_BOOTSTAGE_INITCALL_COUNT];
 #endif
 	phys_addr_t pm_ctx_phys;
 } gd_t;
@@ -33,6 +33,7 @@ enum if_type {
 	IF_TYPE_SYSTEMACE,
 	IF_TYPE_NVME,
 	IF_TYPE_RKNAND,
+	IF_TYPE_SPINOR,
 
 	IF_TYPE_COUNT,			/* Number of interface types */
 };
@@ -75,6 +76,11 @@ struct blk_desc {
 	 * device. Once these functions are removed we can drop this field.
 	 */
 	struct udevice *bdev;
+	/*
+	 * Bumped by blk_dwrite() and blk_derase(), so that data cached
+	 * outside the block layer can tell when it may be stale.
+	 */
+	ulong		write_gen;
 #else
 	unsigned long	(*block_read)(struct blk_desc *block_dev,
 				      lbaint_t start,
@@ -0,0 +1,129 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __BOOT_PLAN_H
+#define __BOOT_PLAN_H
+
+/*
+ * Boot artifact placement.
+ *
+ * At the end of boot, booti moves the kernel Image to match its
+ * text_offset, boot_relocate_fdt() copies the FDT to make room for fixups
+ * and boot_ramdisk_high() copies the initrd below initrd_high. Loaders
+ * that know what they load can ask here where to put each piece, before
+ * reading it, so that it lands where these steps want it and they use it
+ * in place.
+ */
+
+enum boot_plan_item {
+	BOOT_PLAN_KERNEL,
+	BOOT_PLAN_RAMDISK,
+	BOOT_PLAN_FDT,
+
+	BOOT_PLAN_COUNT,
+};
+
+#if CONFIG_IS_ENABLED(BOOT_PLAN)
+/**
+ * boot_plan_init() - Start a new plan
+ *
+ * Forgets the previous plan and sets up the free memory as bootm sees it.
+ */
+void boot_plan_init(void);
+
+/**
+ * boot_plan_reserve() - Keep a region out of the plan
+ *
+ * @addr:	Start of the region, e.g. an image being loaded
+ * @size:	Size of the region in bytes
+ */
+void boot_plan_reserve(ulong addr, ulong size);
+
+/**
+ * boot_plan_kernel() - Place the kernel
+ *
+ * If @hdr is an arm64 Image header, the kernel is placed where booti
+ * would move it to when started at @want. Anything else is placed at
+ * @want.
+ *
+ * @want:	Address the loader would use
+ * @hdr:	Start of the kernel image, or NULL if not known
+ * @size:	Size of the kernel image in bytes
+ * @return address to load the kernel to, or 0 if there is no address
+ * where it can be used in place; the loader then uses @want as before,
+ * and @size bytes at @want are reserved
+ */
+ulong boot_plan_kernel(ulong want, const void *hdr, ulong size);
+
+/**
+ * boot_plan_ramdisk() - Place the ramdisk
+ *
+ * The ramdisk stays at @want if that is free and below initrd_high,
+ * otherwise it goes to the place boot_ramdisk_high() would copy it to.
+ *
+ * @want:	Address the loader would use
+ * @size:	Size of the ramdisk in bytes
+ * @return address to load the ramdisk to, or 0 if no room was found; the
+ * loader then uses @want, which is reserved
+ */
+ulong boot_plan_ramdisk(ulong want, ulong size);
+
+/**
+ * boot_plan_fdt() - Place the device tree
+ *
+ * Room for CONFIG_SYS_FDT_PAD more bytes is kept after the FDT, so that
+ * boot_relocate_fdt() can grow it in place. fdt_high is honoured like
+ * boot_relocate_fdt() does.
+ *
+ * @want:	Address the loader would use
+ * @size:	Size of the FDT in bytes
+ * @return address to load the FDT to, or 0 if no room was found; the
+ * loader then uses @want, which is reserved
+ */
+ulong boot_plan_fdt(ulong want, ulong size);
+
+/**
+ * boot_plan_placed() - Check whether data is where the plan put it
+ *
+ * @item:	Item to check
+ * @addr:	Address of the data
+ * @size:	Size of the data in bytes, including any room it needs after
+ * @return true if the plan placed @item at @addr with room for @size bytes
+ */
+bool boot_plan_placed(enum boot_plan_item item, ulong addr, ulong size);
+
+/**
+ * boot_plan_print() - Show the decisions of the current plan
+ */
+void boot_plan_print(void);
+#else
+static inline void boot_plan_init(void) {}
+static inline void boot_plan_reserve(ulong addr, ulong size) {}
+
+static inline ulong boot_plan_kernel(ulong want, const void *hdr,
+				     ulong size)
+{
+	return 0;
+}
+
+static inline ulong boot_plan_ramdisk(ulong want, ulong size)
+{
+	return 0;
+}
+
+static inline ulong boot_plan_fdt(ulong want, ulong size)
+{
+	return 0;
+}
+
+static inline bool boot_plan_placed(enum boot_plan_item item, ulong addr,
+				    ulong size)
+{
+	return false;
+}
+#endif
+
+#endif /* __BOOT_PLAN_H */
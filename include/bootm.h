@@ -51,6 +51,17 @@ ulong bootm_disable_interrupts(void);
 /* This is a special function used by booti/bootz */
 int bootm_find_images(int flag, int argc, char * const argv[]);
 
+/**
+ * booti_image_dest() - Get where booti runs an arm64 Image from
+ *
+ * @ep:		Address the Image is booted at
+ * @hdr:	Image header
+ * @dst:	Returns the address booti moves the Image to
+ * @size:	Returns the effective size of the Image, in bytes
+ * @return 0 if OK, -EINVAL if @hdr is not an arm64 Image header
+ */
+int booti_image_dest(ulong ep, const void *hdr, ulong *dst, ulong *size);
+
 int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		    int states, bootm_headers_t *images, int boot_progress);
 
@@ -314,6 +314,23 @@ uint32_t bootstage_accum(enum bootstage_id id);
 /* Print a report about boot time */
 void bootstage_report(void);
 
+/**
+ * bootstage_export_json() - Write the boot timings as a trace file
+ *
+ * This produces the Chrome trace-event JSON format, which can be loaded into
+ * chrome://tracing or the Perfetto UI. Marks are shown as instants, each
+ * bootstage_start()/bootstage_accum() pair as a span nested within any
+ * others that were open at the time, and initcalls (if recorded) as spans
+ * in a separate thread. All times are in microseconds since reset.
+ *
+ * @buf:	Buffer to write to
+ * @size:	Size of buffer in bytes
+ * @return number of bytes needed for the output, not including the nul
+ *	terminator. If this is less than @size, the output was written in full
+ *	and terminated; otherwise it was truncated.
+ */
+int bootstage_export_json(char *buf, int size);
+
 /**
  * Add bootstage information to the device tree
  *
@@ -324,6 +341,10 @@ int bootstage_fdt_add_report(void);
 /**
  * Stash bootstage data into memory
  *
+ * The records are followed by the start time and duration of each activity
+ * (see bootstage_start()), so that bootstage_export_json() in a later stage
+ * can show activities from an earlier one.
+ *
  * @param base	Base address of memory buffer
  * @param size	Size of memory buffer
  * @return 0 if stashed ok, -1 if out of space
@@ -675,7 +675,9 @@ void gzwrite_progress_finish(int retcode,
  * @param	src		compressed image address
  * @param	len		compressed image length in bytes
  * @param	dev		block device descriptor
- * @param	szwritebuf	bytes per write (pad to erase size)
+ * @param	szwritebuf	bytes per write (pad to erase size); output
+ *				is batched into writes of a whole
+ *				number of these, about 4MiB each
  * @param	startoffs	offset in bytes of first write
  * @param	szexpected	expected uncompressed length
  *				may be zero to use gzip trailer
@@ -0,0 +1,100 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __DECOMP_STREAM_H
+#define __DECOMP_STREAM_H
+
+#include <linux/xxhash.h>
+#include <u-boot/lz4.h>
+
+/*
+ * Streaming decompression.
+ *
+ * The compressed image is fed in pieces of any size, split anywhere, as
+ * they are read from storage, and comes out straight at its final place.
+ * No buffer for the whole compressed image is needed, and each piece is
+ * decompressed while it is still in the cache.
+ *
+ * Supported are gzip, the LZ4 frame format and lzop, as far as each is
+ * enabled, and uncompressed data.
+ */
+
+/* Longest header kept: gzip file name and comment, lzop file name */
+#define DECOMP_STREAM_HDR_MAX	512
+
+struct decomp_stream {
+	int comp;		/* IH_COMP_... */
+	int state;
+	u8 *dst;
+	ulong dst_len;
+	ulong out;		/* bytes written to dst */
+
+	u8 hdr[DECOMP_STREAM_HDR_MAX];	/* header being collected */
+	uint hdr_len;
+
+	u8 *stage;		/* block split across pieces */
+	ulong stage_size;
+	ulong stage_len;
+
+	ulong blk_in;		/* compressed size of current block */
+	ulong blk_out;		/* its size once decompressed */
+	ulong blk_max;		/* largest block of the stream */
+	bool blk_raw;		/* block is stored as is */
+	ulong blk_start;	/* output offset of the current block */
+	u32 blk_hash;		/* checksum of the current block */
+	struct lz4_frame lz4;	/* LZ4 frame parameters */
+	struct xxh32_state xxh;	/* LZ4 checksum of the output so far */
+	void *zs;		/* inflate state */
+	int err;
+	const char *error;
+};
+
+/**
+ * decomp_stream_detect() - Find out how data is compressed
+ *
+ * @src:	Start of the data
+ * @len:	Number of bytes at @src
+ * @return IH_COMP_... of a supported format, IH_COMP_NONE otherwise
+ */
+int decomp_stream_detect(const void *src, ulong len);
+
+/**
+ * decomp_stream_init() - Start decompressing a stream
+ *
+ * @ds:		Stream state
+ * @comp:	Compression of the stream (IH_COMP_...)
+ * @dst:	Where the output goes
+ * @dst_len:	Room at @dst, in bytes
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, -ENOMEM
+ */
+int decomp_stream_init(struct decomp_stream *ds, int comp, void *dst,
+		       ulong dst_len);
+
+/**
+ * decomp_stream_write() - Decompress the next piece of a stream
+ *
+ * Data past the end of the stream is ignored. Once an error has been
+ * returned, the stream stays failed.
+ *
+ * @ds:		Stream state
+ * @src:	Compressed data
+ * @len:	Number of bytes at @src
+ * @return 0 if OK, -ENOBUFS if the output does not fit, other -ve value
+ * on error with ds->error set to the reason
+ */
+int decomp_stream_write(struct decomp_stream *ds, const void *src,
+			ulong len);
+
+/**
+ * decomp_stream_finish() - Finish a stream and free its buffers
+ *
+ * @ds:		Stream state
+ * @out_len:	Returns the number of bytes written to the output
+ * @return 0 if the whole stream was decompressed, -ve on error
+ */
+int decomp_stream_finish(struct decomp_stream *ds, ulong *out_len);
+
+#endif /* __DECOMP_STREAM_H */
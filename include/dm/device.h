@@ -82,6 +82,30 @@ enum {
 	DM_REMOVE_ACTIVE_ALL = DM_REMOVE_ACTIVE_DMA | DM_REMOVE_OS_PREPARE,
 };
 
+/**
+ * struct dm_timing - Time spent binding and probing a device
+ *
+ * This is recorded when CONFIG_DM_TIMING is enabled. Times are in
+ * microseconds. Time spent binding or probing other devices from within a
+ * device's own bind or probe, such as its parents or children, is not
+ * counted in @bind_us, @ofdata_us or @probe_us, so these can be added up
+ * across devices.
+ *
+ * @bind_us: Time taken to bind the device
+ * @ofdata_us: Time taken by the driver's ofdata_to_platdata() method
+ * @probe_us: Time taken to probe the device, other than the above
+ * @probe_total_us: Time taken by device_probe(), including everything it
+ *		had to bind and probe first, such as the device's parents
+ * @probe_count: Number of times the device has been probed
+ */
+struct dm_timing {
+	ulong bind_us;
+	ulong ofdata_us;
+	ulong probe_us;
+	ulong probe_total_us;
+	uint probe_count;
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -123,6 +147,7 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @timing: Time spent on this device, when CONFIG_DM_TIMING is enabled
  */
 struct udevice {
 	const struct driver *driver;
@@ -146,6 +171,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	struct dm_timing timing;
+#endif
 };
 
 /* Maximum sequence number supported */
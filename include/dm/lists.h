@@ -45,6 +45,22 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - find the driver for a compatible string
+ *
+ * This returns the first driver (in linker-list order) with @compat in its
+ * of_match table. After relocation this uses an index of all the drivers'
+ * compatible strings, built on the first call, if CONFIG_DM_COMPAT_INDEX is
+ * enabled. Otherwise each driver is searched in turn.
+ *
+ * @compat:	Compatible string to look up
+ * @drvp:	Returns the driver
+ * @idp:	Returns the matching of_match entry of the driver
+ * @return 0 if found, -ENOENT if no driver matches
+ */
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
@@ -48,6 +48,31 @@ static inline void dm_dump_devres(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/* Dump out the time spent on each device, most costly first */
+void dm_dump_timing(void);
+
+/**
+ * dm_timing_add_fdt() - Add the time spent on each device to bootstage
+ *
+ * This adds a numbered subnode to the bootstage node for each device that
+ * took any time to bind or probe, most costly first, up to
+ * CONFIG_DM_TIMING_FDT_COUNT devices. Each has the "name" and "accum"
+ * properties of a bootstage record, with the name prefixed by "dm:",
+ * along with the fields of struct dm_timing.
+ *
+ * @blob: Device tree to update
+ * @bootstage: Offset of the bootstage node
+ * @index: Number to use as the name of the first subnode
+ * @return number to use for the next subnode, or -ve on error
+ */
+int dm_timing_add_fdt(void *blob, int bootstage, int index);
+#else
+static inline void dm_dump_timing(void)
+{
+}
+#endif
+
 /**
  * Check if a dt node should be or was bound before relocation.
  *
@@ -32,4 +32,13 @@ void fastboot_okay(const char *reason, char *response);
  */
 void timed_send_info(ulong *start, const char *msg);
 
+/**
+ * fastboot_poll() - Do the USB fastboot work that is too slow for the
+ * USB completion handlers, e.g. writing out a streamed download
+ *
+ * Called from the fastboot command loop, after the USB interrupts have
+ * been handled.
+ */
+void fastboot_poll(void);
+
 #endif /* _FASTBOOT_H_ */
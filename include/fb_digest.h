@@ -0,0 +1,66 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _FB_DIGEST_H_
+#define _FB_DIGEST_H_
+
+/* "sha256:" and 64 hex digits, plus \0 */
+#define FB_DIGEST_STR_LEN	72
+
+#ifdef CONFIG_FASTBOOT_FLASH_DIGEST
+/**
+ * fb_digest_start() - Start the digest of an image being flashed
+ *
+ * The digest covers the image as the host has it, with sparse images
+ * expanded: fill chunks as their pattern and don't-care chunks as zeroes,
+ * which is what simg2img produces.
+ *
+ * @part_name:	Partition being flashed
+ */
+void fb_digest_start(const char *part_name);
+
+/**
+ * fb_digest_update() - Add image data to the digest
+ *
+ * @buf:	Image data
+ * @len:	Number of bytes in @buf
+ */
+void fb_digest_update(const void *buf, unsigned int len);
+
+/**
+ * fb_digest_fill() - Add data made of a repeated 32-bit pattern
+ *
+ * @val:	Pattern, as stored in memory
+ * @len:	Number of bytes, a multiple of 4
+ */
+void fb_digest_fill(uint32_t val, uint64_t len);
+
+/**
+ * fb_digest_finish() - Keep the digest if the image was flashed
+ *
+ * @response:	Fastboot response of the flash operation
+ */
+void fb_digest_finish(const char *response);
+
+/**
+ * fb_digest_get() - Get the digest of the last image flashed to a partition
+ *
+ * @part_name:	Partition name
+ * @return digest as "<algorithm>:<hex>", or NULL if there is none
+ */
+const char *fb_digest_get(const char *part_name);
+#else
+static inline void fb_digest_start(const char *part_name) {}
+static inline void fb_digest_update(const void *buf, unsigned int len) {}
+static inline void fb_digest_fill(uint32_t val, uint64_t len) {}
+static inline void fb_digest_finish(const char *response) {}
+static inline const char *fb_digest_get(const char *part_name)
+{
+	return NULL;
+}
+#endif
+
+#endif /* _FB_DIGEST_H_ */
@@ -7,3 +7,34 @@
 void fb_mmc_flash_write(const char *cmd, void *download_buffer,
 			unsigned int download_bytes, char *response);
 void fb_mmc_erase(const char *cmd, char *response);
+
+#ifdef CONFIG_FASTBOOT_STREAM
+/**
+ * fb_mmc_stream_start() - Get ready to write an image as it is downloaded
+ *
+ * @cmd:	Partition name
+ * @size:	Size of the image, in bytes
+ * @response:	Fastboot response, filled in on error
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_stream_start(const char *cmd, unsigned int size, char *response);
+
+/**
+ * fb_mmc_stream_write() - Write the next piece of a streamed image
+ *
+ * The pieces may be split anywhere. After an error the rest of the image
+ * is ignored and fb_mmc_stream_finish() reports the failure.
+ *
+ * @buf:	Image data
+ * @len:	Number of bytes in @buf
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_stream_write(const void *buf, unsigned int len);
+
+/**
+ * fb_mmc_stream_finish() - Complete a streamed image
+ *
+ * @response:	Fastboot response, OKAY or FAIL with the reason
+ */
+void fb_mmc_stream_finish(char *response);
+#endif
@@ -23,6 +23,49 @@ struct sparse_storage {
 	lbaint_t	(*reserve)(struct sparse_storage *info,
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
+
+	/*
+	 * Optional: fill blocks with a 32-bit pattern without sending it,
+	 * e.g. by erasing them. Returns blkcnt, or 0 if the storage cannot
+	 * do it for this range and the blocks must be written.
+	 */
+	lbaint_t	(*write_same)(struct sparse_storage *info,
+				      lbaint_t blk,
+				      lbaint_t blkcnt,
+				      uint32_t val);
+};
+
+enum sparse_stream_state {
+	SPARSE_STATE_FILE_HDR,
+	SPARSE_STATE_CHUNK_HDR,
+	SPARSE_STATE_RAW,
+	SPARSE_STATE_FILL,
+	SPARSE_STATE_DONE,
+	SPARSE_STATE_ERROR,
+};
+
+/*
+ * Incremental sparse image writer. The image can be fed in pieces of any
+ * size, split anywhere, e.g. as it comes in from the host.
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	enum sparse_stream_state state;
+	sparse_header_t		header;
+	chunk_header_t		chunk_header;
+	unsigned int		hdr_len;	/* header bytes collected */
+	unsigned int		skip;		/* input bytes to drop */
+	unsigned int		chunk;		/* chunks started */
+	unsigned int		remain;		/* raw data left in chunk */
+	lbaint_t		blk;		/* next block to write */
+	uint32_t		total_blocks;
+	u64			bytes_written;
+	uint32_t		fill_val;
+	void			*blk_buf;	/* partial block of raw data */
+	unsigned int		blk_len;
+	uint32_t		*fill_buf;
+	bool			fill_buf_ready;	/* fill_buf holds fill_val */
+	const char		*error;
 };
 
 static inline int is_sparse_image(void *buf)
@@ -36,5 +79,42 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/**
+ * sparse_stream_init() - Start writing a sparse image
+ *
+ * @ss:		Stream state
+ * @info:	Storage to write to
+ * @return 0 if OK, -ENOMEM on error
+ */
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info);
+
+/**
+ * sparse_stream_write() - Write the next piece of a sparse image
+ *
+ * Data past the last chunk is ignored. Once an error has been returned,
+ * the stream stays failed.
+ *
+ * @ss:		Stream state
+ * @data:	Image data
+ * @len:	Number of bytes in @data
+ * @return 0 if OK, -ve on error with ss->error set to the reason
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len);
+
+/**
+ * sparse_stream_finish() - Finish a sparse image and report the result
+ *
+ * Checks that the whole image has been written, frees the stream buffers
+ * and fills in the fastboot @response.
+ *
+ * @ss:		Stream state
+ * @part_name:	Partition name, for the messages
+ * @response:	Fastboot response buffer
+ * @return 0 if OK, -ve on error
+ */
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response);
+
 void write_sparse_image(struct sparse_storage *info, const char *part_name,
 			void *data, unsigned sz, char *response);
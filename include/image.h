@@ -287,6 +287,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -659,6 +660,11 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 int fit_get_node_from_config(bootm_headers_t *images, const char *prop_name,
 			ulong addr);
 
+/* Room added to the FDT when it is relocated, for the fixups */
+#ifndef CONFIG_SYS_FDT_PAD
+#define CONFIG_SYS_FDT_PAD 0x3000
+#endif
+
 int boot_get_fdt(int flag, int argc, char * const argv[], uint8_t arch,
 		 bootm_headers_t *images,
 		 char **of_flat_tree, ulong *of_size);
@@ -1246,6 +1252,11 @@ void android_print_contents(const struct andr_img_hdr *hdr);
  * image or if the image size needed to be read from disk is bigger than the
  * the passed |max_size| a negative number is returned.
  *
+ * Only the header, kernel and ramdisk are read, the second stage is not.
+ * When the kernel has its own load address and that memory is free, it is
+ * read straight there and android_image_get_kernel() reports it at that
+ * address; otherwise it is left in the image.
+ *
  * @dev_desc:		The device where to read the image from
  * @part_info:		The partition in |dev_desc| where to read the image from
  * @load_address:	The address where the image will be loaded
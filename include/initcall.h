@@ -11,4 +11,28 @@ typedef int (*init_fnc_t)(void);
 
 int initcall_run_list(const init_fnc_t init_sequence[]);
 
+/**
+ * struct initcall_record - Time taken by an initcall
+ *
+ * These are kept in global data when CONFIG_BOOTSTAGE_INITCALL is enabled.
+ *
+ * @func: Address of the initcall before relocation, to match System.map
+ * @start_us: Boot time when the initcall started, in microseconds
+ * @duration_us: Time taken by the initcall, in microseconds
+ */
+struct initcall_record {
+	ulong func;
+	u32 start_us;
+	u32 duration_us;
+};
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_INITCALL)
+/* Print the time taken by each initcall, as part of 'bootstage report' */
+void initcall_report(void);
+#else
+static inline void initcall_report(void)
+{
+}
+#endif
+
 #endif
@@ -29,6 +29,34 @@ typedef __be64 fdt64_t;
 #define strtoul(cp, endp, base)	simple_strtoul(cp, endp, base)
 #endif
 
+/*
+ * Lookup caches used by libfdt in U-Boot proper, see lib/fdt_cache.c. A
+ * negative return value from a lookup means that the caller must search the
+ * tree itself.
+ */
+#if defined(__UBOOT__) && !defined(USE_HOSTCC)
+#if CONFIG_IS_ENABLED(OF_LIBFDT_CACHE)
+#define FDT_CACHE
+#endif
+#endif
+
+#ifdef FDT_CACHE
+int fdt_cache_phandle(const void *fdt, uint32_t phandle);
+void fdt_cache_add_phandle(const void *fdt, uint32_t phandle, int offset);
+int fdt_cache_path(const void *fdt, const char *path, int namelen);
+void fdt_cache_add_path(const void *fdt, const char *path, int namelen,
+			int offset);
+void fdt_cache_invalidate(const void *fdt);
+/* Number of times the tree was walked to look up a phandle, for tests */
+uint fdt_cache_phandle_walks(void);
+#else
+#define fdt_cache_phandle(fdt, phandle)			(-1)
+#define fdt_cache_add_phandle(fdt, phandle, offset)	do {} while (0)
+#define fdt_cache_path(fdt, path, namelen)		(-1)
+#define fdt_cache_add_path(fdt, path, namelen, offset)	do {} while (0)
+#define fdt_cache_invalidate(fdt)			do {} while (0)
+#endif
+
 /* adding a ramdisk needs 0x44 bytes in version 2008.10 */
 #define FDT_RAMDISK_OVERHEAD	0x80
 
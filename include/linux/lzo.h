@@ -31,6 +31,13 @@ int lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
 int lzop_decompress(const unsigned char *src, size_t src_len,
 		    unsigned char *dst, size_t *dst_len);
 
+/*
+ * Get the length of the lzop header at src, given the len bytes there.
+ * While that is more than len, more bytes are needed to know it. Returns
+ * -1 if src is not an lzop header.
+ */
+int lzop_header_len(const unsigned char *src, size_t len);
+
 /*
  * Return values (< 0 = Error)
  */
@@ -0,0 +1,112 @@
+/*
+ * xxHash - Extremely Fast Hash algorithm
+ * Copyright (C) 2012-2016, Yann Collet.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+ BSD-2-Clause
+ */
+
+#ifndef __XXHASH_H
+#define __XXHASH_H
+
+#include <linux/types.h>
+
+/* State of an xxh32 hash being computed piece by piece */
+struct xxh32_state {
+	uint32_t total_len;
+	uint32_t large_len;
+	uint32_t v1;
+	uint32_t v2;
+	uint32_t v3;
+	uint32_t v4;
+	uint32_t mem32[4];
+	uint32_t memsize;
+};
+
+/* State of an xxh64 hash being computed piece by piece */
+struct xxh64_state {
+	uint64_t total_len;
+	uint64_t v1;
+	uint64_t v2;
+	uint64_t v3;
+	uint64_t v4;
+	uint64_t mem64[4];
+	uint32_t memsize;
+};
+
+/**
+ * xxh32() - Calculate the 32-bit hash of a buffer
+ *
+ * @input:	Data to hash
+ * @length:	Number of bytes at @input
+ * @seed:	Seed to start from, usually 0
+ * @return the hash
+ */
+uint32_t xxh32(const void *input, size_t length, uint32_t seed);
+
+/**
+ * xxh32_reset() - Start a new 32-bit hash
+ *
+ * @state:	State to set up
+ * @seed:	Seed to start from, usually 0
+ */
+void xxh32_reset(struct xxh32_state *state, uint32_t seed);
+
+/**
+ * xxh32_update() - Add data to a 32-bit hash
+ *
+ * @state:	Hash state
+ * @input:	Data to add
+ * @length:	Number of bytes at @input
+ */
+void xxh32_update(struct xxh32_state *state, const void *input,
+		  size_t length);
+
+/**
+ * xxh32_digest() - Get the 32-bit hash of all data added so far
+ *
+ * The state is not changed, so more data may be added afterwards.
+ *
+ * @state:	Hash state
+ * @return the hash
+ */
+uint32_t xxh32_digest(const struct xxh32_state *state);
+
+/**
+ * xxh64() - Calculate the 64-bit hash of a buffer
+ *
+ * @input:	Data to hash
+ * @length:	Number of bytes at @input
+ * @seed:	Seed to start from, usually 0
+ * @return the hash
+ */
+uint64_t xxh64(const void *input, size_t length, uint64_t seed);
+
+/**
+ * xxh64_reset() - Start a new hash
+ *
+ * @state:	State to set up
+ * @seed:	Seed to start from, usually 0
+ */
+void xxh64_reset(struct xxh64_state *state, uint64_t seed);
+
+/**
+ * xxh64_update() - Add data to a hash
+ *
+ * @state:	Hash state
+ * @input:	Data to add
+ * @length:	Number of bytes at @input
+ */
+void xxh64_update(struct xxh64_state *state, const void *input,
+		  size_t length);
+
+/**
+ * xxh64_digest() - Get the hash of all data added so far
+ *
+ * The state is not changed, so more data may be added afterwards.
+ *
+ * @state:	Hash state
+ * @return the hash
+ */
+uint64_t xxh64_digest(const struct xxh64_state *state);
+
+#endif /* __XXHASH_H */
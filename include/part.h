@@ -29,12 +29,14 @@ struct block_drvr {
 #define PART_TYPE_ISO		0x03
 #define PART_TYPE_AMIGA		0x04
 #define PART_TYPE_EFI		0x05
+#define PART_TYPE_RKPARAM	0x06
 
 /* maximum number of partition entries supported by search */
 #define DOS_ENTRY_NUMBERS	8
 #define ISO_ENTRY_NUMBERS	64
 #define MAC_ENTRY_NUMBERS	64
 #define AMIGA_ENTRY_NUMBERS	8
+#define RKPARAM_ENTRY_NUMBERS	64
 /*
  * Type string for U-Boot bootable partitions
  */
@@ -217,6 +219,49 @@ static inline int blk_get_device_part_str(const char *ifname,
 { *dev_desc = NULL; return -1; }
 #endif
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+/**
+ * part_cache_invalidate() - Forget the cached partition tables of a device
+ *
+ * Must be called when the partition table on the device changes.
+ *
+ * @dev_desc:	Block device, all its hardware partitions are dropped
+ */
+void part_cache_invalidate(struct blk_desc *dev_desc);
+
+/**
+ * part_cache_check_write() - Drop the cached tables a write may change
+ *
+ * Called by the block layer before each write or erase. The cached tables
+ * of the device are dropped if the blocks written overlap the ends of the
+ * device (MBR, GPT) or the table area of a partition driver.
+ *
+ * @dev_desc:	Block device
+ * @start:	First block written
+ * @blkcnt:	Number of blocks written
+ */
+void part_cache_check_write(struct blk_desc *dev_desc, lbaint_t start,
+			    lbaint_t blkcnt);
+
+/**
+ * part_cache_generation() - Get the partition cache generation
+ *
+ * The generation changes each time a cached table is dropped, so that
+ * partition information kept elsewhere can be checked for staleness.
+ *
+ * @return generation count
+ */
+unsigned int part_cache_generation(void);
+#else
+static inline void part_cache_invalidate(struct blk_desc *dev_desc) {}
+static inline void part_cache_check_write(struct blk_desc *dev_desc,
+					  lbaint_t start, lbaint_t blkcnt) {}
+static inline unsigned int part_cache_generation(void)
+{
+	return 0;
+}
+#endif
+
 /*
  * We don't support printing partition information in SPL and only support
  * getting partition information in a few cases.
@@ -265,12 +310,46 @@ struct part_driver {
 	 *	   type, -ve if not
 	 */
 	int (*test)(struct blk_desc *dev_desc);
+
+	/*
+	 * Blocks holding the table, if it is not at either end of the
+	 * device, so that writes to them drop the partition cache
+	 */
+	lbaint_t table_start;
+	lbaint_t table_blks;
 };
 
 /* Declare a new U-Boot partition 'driver' */
 #define U_BOOT_PART_TYPE(__name)					\
 	ll_entry_declare(struct part_driver, __name, part_driver)
 
+#if CONFIG_IS_ENABLED(RKPARAM_PARTITION)
+/* disk/part_rkparam.c */
+/**
+ * part_rkparam_get_info_by_name() - Find a partition in the rockchip
+ * parameter table by name, without any I/O once the table is cached
+ *
+ * @param dev_desc - block device descriptor
+ * @param name - the specified table entry name
+ * @param info - returns the disk partition info
+ *
+ * @return - the partition number on match (starting on 1), otherwise error
+ */
+int part_rkparam_get_info_by_name(struct blk_desc *dev_desc,
+				  const char *name, disk_partition_t *info);
+
+/**
+ * part_rkparam_get_cmdline() - Get the CMDLINE: line of the rockchip
+ * parameter table, including the mtdparts= argument
+ *
+ * @param dev_desc - block device descriptor
+ *
+ * @return - the command line, or NULL if there is no valid table. It is
+ * only valid until the table is read again, see part_cache_generation().
+ */
+const char *part_rkparam_get_cmdline(struct blk_desc *dev_desc);
+#endif
+
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
 #include <part_efi.h>
 /* disk/part_efi.c */
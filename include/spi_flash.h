@@ -158,6 +158,17 @@ int spi_flash_probe_bus_cs(unsigned int busnum, unsigned int cs,
 			   unsigned int max_hz, unsigned int spi_mode,
 			   struct udevice **devp);
 
+/**
+ * spi_flash_blk_bind() - Add a block device on top of a SPI flash
+ *
+ * The block device has 512-byte blocks and is of type IF_TYPE_SPINOR.
+ * Writes erase the flash sectors they cover first.
+ *
+ * @dev:	SPI flash device
+ * @return 0 if OK, -ve on error
+ */
+int spi_flash_blk_bind(struct udevice *dev);
+
 /* Compatibility function - this is the old U-Boot API */
 struct spi_flash *spi_flash_probe(unsigned int bus, unsigned int cs,
 				  unsigned int max_hz, unsigned int spi_mode);
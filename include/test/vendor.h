@@ -0,0 +1,15 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TEST_VENDOR_H__
+#define __TEST_VENDOR_H__
+
+#include <test/test.h>
+
+/* Declare a new vendor storage test */
+#define VENDOR_TEST(_name, _flags)	UNIT_TEST(_name, _flags, vendor_test)
+
+#endif /* __TEST_VENDOR_H__ */
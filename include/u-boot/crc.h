@@ -28,4 +28,41 @@ uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 void crc32_wd_buf(const unsigned char *input, uint ilen,
 		    unsigned char *output, uint chunk_sz);
 
+/**
+ * crc32_combine() - Combine the crc32 of two consecutive buffers
+ *
+ * @crc1:	crc32() of the first buffer
+ * @crc2:	crc32() of the second buffer
+ * @len2:	Length of the second buffer, in bytes
+ * @return crc32() of both buffers one after the other
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* arch/arm/cpu/armv8/crc32_armv8.c */
+
+/*
+ * Set to force the table-driven crc32, e.g. to compare it with the CRC32
+ * instructions in a test. This lives in .data so that it can be read
+ * before relocation.
+ */
+extern int crc32_armv8_disable;
+
+/**
+ * crc32_armv8() - update a crc32 using the ARMv8 CRC32 instructions
+ *
+ * This does the work of crc32_no_comp(). The CPU is checked
+ * (ID_AA64ISAR0_EL1) on each call so that this can be used before
+ * relocation.
+ *
+ * @crc:	crc to update, in place
+ * @buf:	input buffer
+ * @len:	length of @buf in bytes
+ * @return 0 if @crc was updated, -ENOSYS if the CPU has no CRC32
+ * instructions and the caller must fall back to the tables
+ */
+int crc32_armv8(uint32_t *crc, const unsigned char *buf, uint len);
+
+/* lib/crc32_rk.c */
+uint32_t crc32_rk(uint32_t crc, const unsigned char *buf, uint len);
+
 #endif /* _UBOOT_CRC_H */
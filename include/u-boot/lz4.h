@@ -0,0 +1,60 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __LZ4_H
+#define __LZ4_H
+
+#define LZ4F_MAGIC		0x184D2204
+#define LZ4F_SKIP_MAGIC		0x184D2A50	/* low four bits are free */
+#define LZ4F_SKIP_MASK		0xfffffff0
+#define LZ4F_HDR_LEN		7	/* magic, flags, descriptor, checksum */
+#define LZ4F_HDR_MAX		(LZ4F_HDR_LEN + 8)
+#define LZ4F_CONTENT_SIZE	0x08	/* in the flags byte, hdr[4] */
+#define LZ4F_BLOCK_RAW		0x80000000	/* in a block size */
+
+/* Parameters of an LZ4 frame, from its header */
+struct lz4_frame {
+	bool independent;	/* blocks do not refer to earlier blocks */
+	bool block_csum;	/* each block is followed by its xxh32 */
+	bool content_csum;	/* the end mark is followed by the xxh32 */
+	bool has_size;		/* content_size is valid */
+	u64 content_size;	/* bytes in the frame once decompressed */
+	ulong block_max;	/* largest block size */
+};
+
+/**
+ * ulz4_frame_header() - Check and decode an LZ4 frame header
+ *
+ * The header is LZ4F_HDR_LEN bytes long, or LZ4F_HDR_MAX if the
+ * LZ4F_CONTENT_SIZE flag is set.
+ *
+ * @src:	Start of the frame
+ * @srcn:	Number of bytes at @src
+ * @frame:	Returns the frame parameters
+ * @return length of the header if OK, -EINVAL if it is corrupt or longer
+ * than @srcn, -EPROTONOSUPPORT if it is not an LZ4 frame header
+ */
+int ulz4_frame_header(const void *src, size_t srcn, struct lz4_frame *frame);
+
+/**
+ * ulz4_decompress_block() - Decompress a single LZ4 block, without frame
+ *
+ * In a frame with linked blocks, a block may copy from up to 64KB of
+ * output of the blocks before it. These must be right before @dst, as
+ * when a frame is decompressed in one go, so no history buffer is needed.
+ *
+ * @src:	Compressed block
+ * @srcn:	Size of the compressed block
+ * @dst:	Where to put the output
+ * @dstn:	Room at @dst on entry, number of bytes written on return
+ * @prefix:	Start of the output that the block may copy from: @dst for
+ *		independent blocks, else the start of the frame output
+ * @return 0 if OK, -EPROTO if the block is corrupt or does not fit
+ */
+int ulz4_decompress_block(const void *src, size_t srcn, void *dst,
+			  size_t *dstn, const void *prefix);
+
+#endif /* __LZ4_H */
@@ -0,0 +1,44 @@
+/*
+ * SHA-1/SHA-256 using the ARMv8 Cryptography Extensions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _SHA_CE_H
+#define _SHA_CE_H
+
+/*
+ * Set to force the portable C implementations, e.g. to compare them with
+ * the Crypto Extensions in a test. This lives in .data so that it can be
+ * read before relocation.
+ */
+extern int sha_ce_disable;
+
+/**
+ * sha1_ce_blocks() - hash whole SHA-1 blocks using the Crypto Extensions
+ *
+ * The CPU is checked (ID_AA64ISAR0_EL1) on each call so that this can be
+ * used before relocation.
+ *
+ * @state:	SHA-1 state words, updated in place
+ * @data:	input, a multiple of 64 bytes
+ * @blocks:	number of 64-byte blocks in @data
+ * @return 0 if the blocks were hashed, -ENOSYS if the CPU has no SHA-1
+ * instructions and the caller must fall back to C
+ */
+int sha1_ce_blocks(uint32_t state[5], const uint8_t *data,
+		   unsigned int blocks);
+
+/**
+ * sha256_ce_blocks() - hash whole SHA-256 blocks using the Crypto Extensions
+ *
+ * @state:	SHA-256 state words, updated in place
+ * @data:	input, a multiple of 64 bytes
+ * @blocks:	number of 64-byte blocks in @data
+ * @return 0 if the blocks were hashed, -ENOSYS if the CPU has no SHA-256
+ * instructions and the caller must fall back to C
+ */
+int sha256_ce_blocks(uint32_t state[8], const uint8_t *data,
+		     unsigned int blocks);
+
+#endif /* _SHA_CE_H */
@@ -724,6 +724,11 @@ ZEXTERN int ZEXPORT inflateInit2_ OF((z_streamp strm, int  windowBits,
 extern void *gzalloc(void *, unsigned, unsigned);
 extern void gzfree(void *, void *, unsigned);
 
+#ifdef CONFIG_ZLIB_INFLATE_FAST64
+/* Set to use the standard inflate loop, for comparing speed in tests */
+extern int zlib_inflate_reference;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
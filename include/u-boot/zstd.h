@@ -0,0 +1,47 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ZSTD_H
+#define __ZSTD_H
+
+struct blk_desc;
+
+/**
+ * zstd_decompress() - Decompress a zstd image
+ *
+ * All frames of the image are decompressed, one after the other.
+ * Skippable frames are skipped. Frames that need a dictionary are not
+ * supported.
+ *
+ * @src:	Compressed image
+ * @srcn:	Size of the compressed image in bytes
+ * @dst:	Where to put the output
+ * @dstn:	Room at @dst on entry, number of bytes written on return
+ * @return 0 if OK, -ENOBUFS if the output does not fit, -EPROTONOSUPPORT
+ * if a frame needs a dictionary, -EINVAL if the image is corrupt
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * zstdwrite() - Decompress a zstd image from memory to a block device
+ *
+ * This works like gzwrite() and uses the same progress hooks. The output
+ * goes through a buffer of about twice the window size of the image, so
+ * the uncompressed image never needs to be held in memory.
+ *
+ * @src:	Compressed image
+ * @len:	Size of the compressed image in bytes
+ * @dev:	Block device to write to
+ * @szwritebuf:	Bytes per write (pad to erase size)
+ * @startoffs:	Offset in bytes of the first write
+ * @szexpected:	Expected uncompressed size of all frames, or 0 if not known.
+ *		Each frame is checked against the size in its header, if any
+ * @return 0 if OK, -1 on error
+ */
+int zstdwrite(unsigned char *src, int len, struct blk_desc *dev,
+	      unsigned long szwritebuf, u64 startoffs, u64 szexpected);
+
+#endif /* __ZSTD_H */
@@ -0,0 +1,79 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __VENDOR_JOURNAL_H
+#define __VENDOR_JOURNAL_H
+
+#define VENDOR_JOURNAL_BLK_SIZE		512
+
+/**
+ * struct vendor_journal - append-only log of vendor item updates
+ *
+ * The journal lives in a block-aligned area of storage behind a full copy
+ * of the vendor storage. Each record starts on a fresh block and carries
+ * the version of that copy, a sequence number and a crc32, so a record
+ * torn by a power cut, or left over from an older copy, ends the replay.
+ *
+ * @write: write @cnt blocks to block @blk of the journal area
+ * @priv: private data for @write
+ * @version: version of the copy the records apply to
+ * @blks: size of the journal area, in blocks; 0 when there is none
+ * @used: number of blocks holding valid records
+ * @seq: sequence number of the next record
+ */
+struct vendor_journal {
+	int (*write)(struct vendor_journal *vj, u32 blk, u32 cnt,
+		     const void *buf);
+	void *priv;
+	u32 version;
+	u32 blks;
+	u32 used;
+	u16 seq;
+};
+
+/**
+ * vendor_journal_reset() - Start an empty journal
+ *
+ * @vj: journal
+ * @version: version of the copy the journal is attached to
+ * @blks: size of the journal area, in blocks
+ */
+void vendor_journal_reset(struct vendor_journal *vj, u32 version, u32 blks);
+
+/**
+ * vendor_journal_replay() - Replay the records of a journal area
+ *
+ * Records are passed to @apply in the order they were appended. The replay
+ * stops at the first block that does not hold the next valid record, and
+ * the journal is set up so that the next append goes there.
+ *
+ * @vj: journal, reset to @version and @blks first
+ * @buf: contents of the journal area, @blks blocks
+ * @version: version of the copy the journal is attached to
+ * @blks: size of the journal area, in blocks
+ * @apply: called for each record, a non-zero return stops the replay
+ * @ctx: passed to @apply
+ * @return number of records replayed
+ */
+int vendor_journal_replay(struct vendor_journal *vj, const void *buf,
+			  u32 version, u32 blks,
+			  int (*apply)(void *ctx, u16 id, const void *data,
+				       u16 size),
+			  void *ctx);
+
+/**
+ * vendor_journal_append() - Append a record to the journal
+ *
+ * @vj: journal
+ * @id: vendor item id
+ * @data: item data
+ * @size: size of @data in bytes
+ * @return 0 if OK, -ENOSPC if the journal is full, other -ve on error
+ */
+int vendor_journal_append(struct vendor_journal *vj, u16 id,
+			  const void *data, u16 size);
+
+#endif /* __VENDOR_JOURNAL_H */
@@ -134,6 +134,10 @@ static void SHA256_transform(AvbSHA256Ctx* ctx,
   int j;
 #endif
 
+  if (block_nb && avb_sha256_transform_hw(ctx->h, message, block_nb)) {
+    return;
+  }
+
   for (i = 0; i < (int)block_nb; i++) {
     sub_block = message + (i << 6);
 
@@ -46,6 +46,11 @@
 /* Maximum size of a vbmeta image - 64 KiB. */
 #define VBMETA_MAX_SIZE (64 * 1024)
 
+/* Hash partitions are read and hashed in pieces of this size, so that
+ * each piece is hashed as soon as it has been read.
+ */
+#define HASH_PARTITION_CHUNK_SIZE (1024 * 1024)
+
 /* Helper function to see if we should continue with verification in
  * allow_verification_error=true mode if something goes wrong. See the
  * comments for the avb_slot_verify() function for more information.
@@ -86,11 +91,17 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
 	AvbSlotVerifyResult ret;
 	AvbIOResult io_ret;
 	uint8_t* image_buf = NULL;
+	bool image_preloaded = false;
 	size_t part_num_read;
 	uint8_t* digest;
 	size_t digest_len;
 	const char* found;
-	uint64_t image_size;
+	uint64_t image_size = 0;
+	uint64_t offset;
+	size_t chunk;
+	AvbSHA256Ctx sha256_ctx;
+	AvbSHA512Ctx sha512_ctx;
+	bool use_sha256;
 
 	if (!avb_hash_descriptor_validate_and_byteswap(
 		(const AvbHashDescriptor*)descriptor, &hash_desc)) {
@@ -155,47 +166,80 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
 			avb_debugv(part_name, ": Loading entire partition.\n", NULL);
 		}
 	}
-	image_buf = avb_malloc(image_size);
-	if (image_buf == NULL) {
-		ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
-		goto out;
-	}
-	io_ret = ops->read_from_partition(ops, part_name, 0 /* offset */, 
-					image_size, image_buf, &part_num_read);
-	if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
-		ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
-		goto out;
-	} else if (io_ret != AVB_IO_RESULT_OK) {
-		avb_errorv(part_name, ": Error loading data from partition.\n", NULL);
-		ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
-		goto out;
-	}
-	if (part_num_read != image_size) {
-		avb_errorv(part_name, ": Read fewer than requested bytes.\n", NULL);
-		ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
-		goto out;
-	}
-
 	if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha256") == 0) {
-		AvbSHA256Ctx sha256_ctx;
+		use_sha256 = true;
 		avb_sha256_init(&sha256_ctx);
 		avb_sha256_update(&sha256_ctx, desc_salt, hash_desc.salt_len);
-		avb_sha256_update(&sha256_ctx, image_buf, hash_desc.image_size);
-		digest = avb_sha256_final(&sha256_ctx);
-		digest_len = AVB_SHA256_DIGEST_SIZE;
 	} else if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha512") == 0) {
-		AvbSHA512Ctx sha512_ctx;
+		use_sha256 = false;
 		avb_sha512_init(&sha512_ctx);
 		avb_sha512_update(&sha512_ctx, desc_salt, hash_desc.salt_len);
-		avb_sha512_update(&sha512_ctx, image_buf, hash_desc.image_size);
-		digest = avb_sha512_final(&sha512_ctx);
-		digest_len = AVB_SHA512_DIGEST_SIZE;
 	} else {
 		avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
 		ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
 		goto out;
 	}
 
+	/* Load straight to where the image is wanted, if the platform says */
+	if (ops->get_load_buffer != NULL) {
+		io_ret = ops->get_load_buffer(ops, part_name, image_size, &image_buf);
+		if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+			goto out;
+		} else if (io_ret != AVB_IO_RESULT_OK) {
+			avb_errorv(part_name, ": Error getting load buffer.\n", NULL);
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+			goto out;
+		}
+		image_preloaded = image_buf != NULL;
+	}
+	if (image_buf == NULL) {
+		image_buf = avb_malloc(image_size);
+		if (image_buf == NULL) {
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+			goto out;
+		}
+	}
+
+	/* Hash each chunk right after reading it, instead of making a
+	 * second pass over the whole image.
+	 */
+	for (offset = 0; offset < image_size; offset += chunk) {
+		chunk = HASH_PARTITION_CHUNK_SIZE;
+		if (image_size - offset < chunk)
+			chunk = image_size - offset;
+
+		io_ret = ops->read_from_partition(ops, part_name, offset, chunk,
+						  image_buf + offset,
+						  &part_num_read);
+		if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+			goto out;
+		} else if (io_ret != AVB_IO_RESULT_OK) {
+			avb_errorv(part_name, ": Error loading data from partition.\n", NULL);
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+			goto out;
+		}
+		if (part_num_read != chunk) {
+			avb_errorv(part_name, ": Read fewer than requested bytes.\n", NULL);
+			ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+			goto out;
+		}
+
+		if (use_sha256)
+			avb_sha256_update(&sha256_ctx, image_buf + offset, chunk);
+		else
+			avb_sha512_update(&sha512_ctx, image_buf + offset, chunk);
+	}
+
+	if (use_sha256) {
+		digest = avb_sha256_final(&sha256_ctx);
+		digest_len = AVB_SHA256_DIGEST_SIZE;
+	} else {
+		digest = avb_sha512_final(&sha512_ctx);
+		digest_len = AVB_SHA512_DIGEST_SIZE;
+	}
+
 	if (digest_len != hash_desc.digest_len) {
 		avb_errorv(
 			part_name, ": Digest in descriptor not of expected size.\n", NULL);
@@ -227,11 +271,12 @@ out:
 		loaded_partition->partition_name = avb_strdup(found);
 		loaded_partition->data_size = image_size;
 		loaded_partition->data = image_buf;
+		loaded_partition->preloaded = image_preloaded;
 		image_buf = NULL;
 	}
 
 fail:
-	if (image_buf != NULL) {
+	if (image_buf != NULL && !image_preloaded) {
 		avb_free(image_buf);
 	}
 	return ret;
@@ -1412,7 +1457,8 @@ void avb_slot_verify_data_free(AvbSlotVerifyData* data)
 			if (loaded_partition->partition_name != NULL) {
 				avb_free(loaded_partition->partition_name);
 			}
-			if (loaded_partition->data != NULL) {
+			if (loaded_partition->data != NULL &&
+			    !loaded_partition->preloaded) {
 				avb_free(loaded_partition->data);
 			}
 		}
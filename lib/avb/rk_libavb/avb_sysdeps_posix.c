@@ -31,6 +31,7 @@
 #include <asm/io.h>
 
 #include <android_avb/avb_sysdeps.h>
+#include <u-boot/sha_ce.h>
 
 void abort(void);
 
@@ -80,3 +81,13 @@ void* avb_malloc_(size_t size) {
 void avb_free(void* ptr) {
   free(ptr);
 }
+
+bool avb_sha256_transform_hw(uint32_t state[8],
+                             const uint8_t* data,
+                             size_t num_blocks) {
+#ifdef CONFIG_SHA_ARMV8_CE
+  return !sha256_ce_blocks(state, data, num_blocks);
+#else
+  return false;
+#endif
+}
@@ -27,6 +27,7 @@
 #include <android_image.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <memalign.h>
 #include <errno.h>
 #include <command.h>
 #include <mmc.h>
@@ -37,33 +38,146 @@
 #include <android_avb/avb_atx_validate.h>
 #include <optee_include/OpteeClientInterface.h>
 
-static void byte_to_block(int64_t *offset,
-			  size_t *num_bytes,
-			  lbaint_t *offset_blk,
-			  lbaint_t *blkcnt)
+/*
+ * libavb reads a partition in many small pieces (footer, vbmeta header,
+ * descriptors...), so each session, from avb_ops_user_new() to
+ * avb_ops_user_free(), keeps the partitions it has looked up and the
+ * last blocks that pieces were cut from.
+ */
+#define AVB_PART_HANDLES	8
+#define AVB_CACHE_BLKS		16
+
+struct avb_part_handle {
+	char name[PART_NAME_LEN];
+	disk_partition_t info;
+};
+
+struct avb_ops_user_data {
+	struct blk_desc *dev_desc;
+	unsigned int part_gen;		/* partition table generation */
+	struct avb_part_handle part[AVB_PART_HANDLES];
+	int num_parts;
+	int next_part;			/* handle to replace next */
+	char *cache;			/* AVB_CACHE_BLKS blocks */
+	lbaint_t cache_blk[AVB_CACHE_BLKS];
+	bool cache_valid[AVB_CACHE_BLKS];
+	int next_cache;			/* cache block to replace next */
+	/* Where the caller wants a partition loaded */
+	const char *load_partition;
+	uint8_t *load_buf;
+	size_t load_size;
+};
+
+__weak struct blk_desc *avb_ops_user_get_blk(void)
 {
-	*offset_blk = (lbaint_t)(*offset / 512);
-	if (*num_bytes % 512 == 0) {
-		if (*offset % 512 == 0) {
-			*blkcnt = (lbaint_t)(*num_bytes / 512);
-		} else {
-			*blkcnt = (lbaint_t)(*num_bytes / 512) + 1;
+	return blk_get_dev("mmc", 0);
+}
+
+static struct avb_part_handle *avb_part_get(AvbOps *ops,
+					    const char *partition)
+{
+	struct avb_ops_user_data *priv = ops->user_data;
+	struct avb_part_handle *ph;
+	disk_partition_t info;
+	int i;
+
+	if (!priv->dev_desc) {
+		priv->dev_desc = avb_ops_user_get_blk();
+		if (!priv->dev_desc) {
+			printf("Could not find the boot device\n");
+			return NULL;
 		}
+	}
+
+	/* The partition table was rewritten under us */
+	if (priv->part_gen != part_cache_generation()) {
+		priv->part_gen = part_cache_generation();
+		priv->num_parts = 0;
+	}
+
+	for (i = 0; i < priv->num_parts; i++) {
+		if (!strcmp(priv->part[i].name, partition))
+			return &priv->part[i];
+	}
+
+	if (strlen(partition) >= sizeof(ph->name) ||
+	    part_get_info_by_name(priv->dev_desc, partition, &info) < 0) {
+		printf("Could not find \"%s\" partition\n", partition);
+		return NULL;
+	}
+
+	if (priv->num_parts < AVB_PART_HANDLES) {
+		ph = &priv->part[priv->num_parts++];
 	} else {
-		if (*offset % 512 == 0) {
-			*blkcnt = (lbaint_t)(*num_bytes / 512) + 1;
-		} else {
-			if ((*offset % 512) + (*num_bytes % 512) < 512 ||
-			    (*offset % 512) + (*num_bytes % 512) == 512) {
-				*blkcnt = (lbaint_t)(*num_bytes / 512) + 1;
-			} else {
-				*blkcnt = (lbaint_t)(*num_bytes / 512) + 2;
-			}
-			
-		}
+		ph = &priv->part[priv->next_part];
+		priv->next_part = (priv->next_part + 1) % AVB_PART_HANDLES;
+	}
+	strcpy(ph->name, partition);
+	ph->info = info;
+
+	return ph;
+}
+
+/* Get block @blk from the session cache, reading it in if needed */
+static char *avb_cache_get(struct avb_ops_user_data *priv, lbaint_t blk)
+{
+	unsigned long blksz = priv->dev_desc->blksz;
+	char *data;
+	int i;
+
+	if (!priv->cache) {
+		priv->cache = malloc_cache_aligned(AVB_CACHE_BLKS * blksz);
+		if (!priv->cache)
+			return NULL;
+	}
+
+	for (i = 0; i < AVB_CACHE_BLKS; i++) {
+		if (priv->cache_valid[i] && priv->cache_blk[i] == blk)
+			return priv->cache + i * blksz;
+	}
+
+	i = priv->next_cache;
+	priv->next_cache = (i + 1) % AVB_CACHE_BLKS;
+	data = priv->cache + i * blksz;
+	priv->cache_valid[i] = false;
+	if (blk_dread(priv->dev_desc, blk, 1, data) != 1)
+		return NULL;
+	priv->cache_blk[i] = blk;
+	priv->cache_valid[i] = true;
+
+	return data;
+}
+
+static void avb_cache_invalidate(struct avb_ops_user_data *priv,
+				 lbaint_t blk, lbaint_t cnt)
+{
+	int i;
+
+	for (i = 0; i < AVB_CACHE_BLKS; i++) {
+		if (priv->cache_blk[i] >= blk && priv->cache_blk[i] < blk + cnt)
+			priv->cache_valid[i] = false;
 	}
 }
 
+/*
+ * Check a request against the partition and turn a negative offset (from
+ * the end) into a positive one.
+ */
+static AvbIOResult avb_part_range(struct avb_part_handle *ph,
+				  unsigned long blksz, int64_t *offset,
+				  size_t num_bytes, size_t *out_num_bytes)
+{
+	uint64_t size = (uint64_t)ph->info.size * blksz;
+
+	if (*offset < 0)
+		*offset += size;
+	if (*offset < 0 || *offset > size)
+		return AVB_IO_RESULT_ERROR_RANGE_OUTSIDE_PARTITION;
+	*out_num_bytes = min_t(uint64_t, num_bytes, size - *offset);
+
+	return AVB_IO_RESULT_OK;
+}
+
 static AvbIOResult read_from_partition(AvbOps* ops,
                                        const char* partition,
                                        int64_t offset,
@@ -71,38 +185,46 @@ static AvbIOResult read_from_partition(AvbOps* ops,
                                        void* buffer,
                                        size_t* out_num_read)
 {
-	char *dev_iface = "mmc";
-	int dev_num = 0;
-	struct blk_desc *dev_desc;
-	lbaint_t offset_blk, blkcnt;
-	disk_partition_t part_info;
-
-	byte_to_block(&offset, &num_bytes, &offset_blk, &blkcnt);
-	dev_desc = blk_get_dev(dev_iface, dev_num);
-	if (!dev_desc) {
-		printf("Could not find %s %d\n", dev_iface, dev_num);
-		return -1;
-	}
-
-	if (part_get_info_by_name(dev_desc, partition, &part_info) < 0) {
-		printf("Could not find \"%s\" partition\n", partition);
-		return -1;
-	}
-
-	if((offset % 512 == 0) && (num_bytes % 512 == 0)) {
-		blk_dread(dev_desc, part_info.start + offset_blk, blkcnt, buffer);
-		*out_num_read = blkcnt * 512;
-	} else {
-		char *buffer_temp;
-		buffer_temp = malloc(512 * blkcnt);
-		if (buffer_temp == NULL) {
-			printf("malloc error!\n");
-			return -1;
+	struct avb_ops_user_data *priv = ops->user_data;
+	struct avb_part_handle *ph;
+	unsigned long blksz;
+	char *dst = buffer;
+	lbaint_t blk, cnt;
+	AvbIOResult ret;
+	size_t pos, n;
+	char *data;
+
+	ph = avb_part_get(ops, partition);
+	if (!ph)
+		return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
+	blksz = priv->dev_desc->blksz;
+	ret = avb_part_range(ph, blksz, &offset, num_bytes, &num_bytes);
+	if (ret != AVB_IO_RESULT_OK)
+		return ret;
+
+	*out_num_read = num_bytes;
+	blk = ph->info.start + offset / blksz;
+	pos = offset % blksz;
+	while (num_bytes) {
+		if (pos || num_bytes < blksz) {
+			/* Piece of a block */
+			data = avb_cache_get(priv, blk);
+			if (!data)
+				return AVB_IO_RESULT_ERROR_IO;
+			n = min_t(size_t, blksz - pos, num_bytes);
+			memcpy(dst, data + pos, n);
+			cnt = 1;
+		} else {
+			/* Whole blocks go straight to the caller */
+			cnt = num_bytes / blksz;
+			if (blk_dread(priv->dev_desc, blk, cnt, dst) != cnt)
+				return AVB_IO_RESULT_ERROR_IO;
+			n = cnt * blksz;
 		}
-		blk_dread(dev_desc, part_info.start + offset_blk, blkcnt, buffer_temp);
-		memcpy(buffer, buffer_temp + (offset % 512), num_bytes);
-		*out_num_read = num_bytes;
-		free(buffer_temp);
+		dst += n;
+		num_bytes -= n;
+		blk += cnt;
+		pos = 0;
 	}
 
 	return AVB_IO_RESULT_OK;
@@ -114,40 +236,58 @@ static AvbIOResult write_to_partition(AvbOps* ops,
                                       size_t num_bytes,
                                       const void* buffer)
 {
-	const char *dev_iface = "mmc";
-	int dev_num = 0;
-	struct blk_desc *dev_desc;
-	char *buffer_temp;
-	disk_partition_t part_info;
-	lbaint_t offset_blk, blkcnt;
-
-	byte_to_block(&offset, &num_bytes, &offset_blk, &blkcnt);
-	buffer_temp = malloc(512 * blkcnt);
-	if (buffer_temp == NULL) {
-		printf("malloc error!\n");
-		return -1;
-	}
-	memset(buffer_temp, 0, 512 * blkcnt);
-	dev_desc = blk_get_dev(dev_iface, dev_num);
-	if (!dev_desc) {
-		printf("Could not find %s %d\n", dev_iface, dev_num);
-		return -1;
-	}
-
-	if (part_get_info_by_name(dev_desc, partition, &part_info) < 0) {
-		printf("Could not find \"%s\" partition\n", partition);
-		return -1;
+	struct avb_ops_user_data *priv = ops->user_data;
+	struct avb_part_handle *ph;
+	unsigned long blksz;
+	lbaint_t blk, cnt;
+	AvbIOResult ret;
+	char *buf, *data;
+	size_t pos, len;
+
+	ph = avb_part_get(ops, partition);
+	if (!ph)
+		return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
+	blksz = priv->dev_desc->blksz;
+	ret = avb_part_range(ph, blksz, &offset, num_bytes, &len);
+	if (ret != AVB_IO_RESULT_OK)
+		return ret;
+	if (len != num_bytes)
+		return AVB_IO_RESULT_ERROR_RANGE_OUTSIDE_PARTITION;
+
+	blk = ph->info.start + offset / blksz;
+	pos = offset % blksz;
+	cnt = DIV_ROUND_UP(pos + num_bytes, blksz);
+
+	if (!pos && !(num_bytes % blksz)) {
+		avb_cache_invalidate(priv, blk, cnt);
+		if (blk_dwrite(priv->dev_desc, blk, cnt, buffer) != cnt)
+			return AVB_IO_RESULT_ERROR_IO;
+		return AVB_IO_RESULT_OK;
 	}
 
-	if ((offset % 512 != 0) && (num_bytes % 512) != 0) {
-		blk_dread(dev_desc, part_info.start + offset_blk, blkcnt, buffer_temp);
+	/* Keep the rest of the first and last blocks */
+	buf = malloc_cache_aligned(cnt * blksz);
+	if (!buf)
+		return AVB_IO_RESULT_ERROR_OOM;
+	ret = AVB_IO_RESULT_ERROR_IO;
+	data = avb_cache_get(priv, blk);
+	if (!data)
+		goto out;
+	memcpy(buf, data, blksz);
+	if (cnt > 1) {
+		data = avb_cache_get(priv, blk + cnt - 1);
+		if (!data)
+			goto out;
+		memcpy(buf + (cnt - 1) * blksz, data, blksz);
 	}
+	memcpy(buf + pos, buffer, num_bytes);
+	avb_cache_invalidate(priv, blk, cnt);
+	if (blk_dwrite(priv->dev_desc, blk, cnt, buf) == cnt)
+		ret = AVB_IO_RESULT_OK;
+out:
+	free(buf);
 
-	memcpy(buffer_temp, buffer + (offset % 512), num_bytes);
-	blk_dwrite(dev_desc, part_info.start + offset_blk, blkcnt, buffer);
-	free(buffer_temp);
-
-	return AVB_IO_RESULT_OK;
+	return ret;
 }
 
 static AvbIOResult validate_vbmeta_public_key(
@@ -222,22 +362,13 @@ static AvbIOResult get_size_of_partition(AvbOps *ops,
                                          const char *partition,
                                          uint64_t *out_size_in_bytes)
 {
-	const char *dev_iface = "mmc";
-	int dev_num = 0;
-	struct blk_desc *dev_desc;
-	disk_partition_t part_info;
+	struct avb_ops_user_data *priv = ops->user_data;
+	struct avb_part_handle *ph;
 
-	dev_desc = blk_get_dev(dev_iface, dev_num);
-	if (!dev_desc) {
-		printf("Could not find %s %d\n", dev_iface, dev_num);
-		return -1;
-	}
-
-	if (part_get_info_by_name(dev_desc, partition, &part_info) < 0) {
-		printf("Could not find \"%s\" partition\n", partition);
-		return -1;
-	}
-	*out_size_in_bytes = (part_info.size) * 512;
+	ph = avb_part_get(ops, partition);
+	if (!ph)
+		return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
+	*out_size_in_bytes = (uint64_t)ph->info.size * priv->dev_desc->blksz;
 	return AVB_IO_RESULT_OK;
 }
 
@@ -246,26 +377,52 @@ static AvbIOResult get_unique_guid_for_partition(AvbOps *ops,
                                                  char *guid_buf,
                                                  size_t guid_buf_size)
 {
-	const char *dev_iface = "mmc";
-	int dev_num = 0;
-	struct blk_desc *dev_desc;
-	disk_partition_t part_info;
-	dev_desc = blk_get_dev(dev_iface, dev_num);
-	if (!dev_desc) {
-		printf("Could not find %s %d\n", dev_iface, dev_num);
-		return -1;
-	}
+	struct avb_part_handle *ph;
 
-	if (part_get_info_by_name(dev_desc, partition, &part_info) < 0) {
-		printf("Could not find \"%s\" partition\n", partition);
-		return -1;
-	}
+	ph = avb_part_get(ops, partition);
+	if (!ph)
+		return AVB_IO_RESULT_ERROR_NO_SUCH_PARTITION;
 	if (guid_buf != NULL && guid_buf_size > 0) {
-		memcpy(guid_buf, part_info.uuid, guid_buf_size);
+		memcpy(guid_buf, ph->info.uuid, guid_buf_size);
 	}
 	return AVB_IO_RESULT_OK;
 }
 
+static AvbIOResult get_load_buffer(AvbOps *ops,
+				   const char *partition,
+				   size_t num_bytes,
+				   uint8_t **out_pointer)
+{
+	struct avb_ops_user_data *priv = ops->user_data;
+	size_t len;
+
+	*out_pointer = NULL;
+	if (!priv->load_buf || num_bytes > priv->load_size)
+		return AVB_IO_RESULT_OK;
+
+	/* The name may carry a slot suffix */
+	len = strlen(priv->load_partition);
+	if (strncmp(partition, priv->load_partition, len) ||
+	    (partition[len] && partition[len] != '_'))
+		return AVB_IO_RESULT_OK;
+
+	/* Only one image can be there, the first one asking gets it */
+	*out_pointer = priv->load_buf;
+	priv->load_buf = NULL;
+
+	return AVB_IO_RESULT_OK;
+}
+
+void avb_ops_user_set_load_buffer(AvbOps *ops, const char *partition,
+				  void *buf, size_t size)
+{
+	struct avb_ops_user_data *priv = ops->user_data;
+
+	priv->load_partition = partition;
+	priv->load_buf = buf;
+	priv->load_size = size;
+}
+
 AvbOps* avb_ops_user_new(void)
 {
 	AvbOps* ops;
@@ -289,6 +446,15 @@ AvbOps* avb_ops_user_new(void)
 		free(ops);
 		goto out;
 	}
+	ops->user_data = calloc(1, sizeof(struct avb_ops_user_data));
+	if (ops->user_data == NULL) {
+		avb_error("Error allocating memory for AvbOps.\n");
+		free(ops->atx_ops);
+		free(ops->ab_ops);
+		free(ops);
+		ops = NULL;
+		goto out;
+	}
 	ops->ab_ops->ops = ops;
 	ops->atx_ops->ops = ops;
 
@@ -301,6 +467,7 @@ AvbOps* avb_ops_user_new(void)
 	ops->write_is_device_unlocked = write_is_device_unlocked;
 	ops->get_unique_guid_for_partition = get_unique_guid_for_partition;
 	ops->get_size_of_partition = get_size_of_partition;
+	ops->get_load_buffer = get_load_buffer;
 	ops->ab_ops->read_ab_metadata = avb_ab_data_read;
 	ops->ab_ops->write_ab_metadata = avb_ab_data_write;
 	ops->ab_ops->init_ab_metadata = avb_ab_data_init;
@@ -312,6 +479,10 @@ out:
 
 void avb_ops_user_free(AvbOps *ops)
 {
+	struct avb_ops_user_data *priv = ops->user_data;
+
+	free(priv->cache);
+	free(priv);
 	free(ops->ab_ops);
 	free(ops->atx_ops);
 	free(ops);
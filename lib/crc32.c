@@ -26,7 +26,15 @@
 
 #define tole(x) cpu_to_le32(x)
 
-#ifdef DYNAMIC_CRC_TABLE
+#ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(CRC32_SLICE8)
+#define CRC32_SLICE8
+#endif
+#endif
+
+#ifdef CRC32_SLICE8
+#include "crc32table.h"
+#elif defined(DYNAMIC_CRC_TABLE)
 
 local int crc_table_empty = 1;
 local uint32_t crc_table[256];
@@ -164,6 +172,36 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+#ifdef CRC32_SLICE8
+/*
+ * Slice-by-8: fold eight bytes into the crc with eight independent table
+ * lookups, rather than eight lookups that each depend on the last. The
+ * crc is kept in CPU order and the data read as little-endian words.
+ */
+local uint32_t crc32_slice8(uint32_t crc, const uint8_t *p, uInt len)
+{
+	const uint32_t (*t)[256] = crc32_slice_table;
+	uint32_t lo, hi;
+
+	/* Keep the word loads aligned, as needed with the MMU off */
+	for (; len && ((uintptr_t)p & 3); len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	for (; len >= 8; len -= 8, p += 8) {
+		lo = crc ^ le32_to_cpu(*(const uint32_t *)p);
+		hi = le32_to_cpu(*(const uint32_t *)(p + 4));
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+		      t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+		      t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+	}
+
+	while (len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+#else
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -173,10 +211,7 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
- */
-uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+local uint32_t crc32_bytewise(uint32_t crc, const Bytef *buf, uInt len)
 {
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
@@ -217,6 +252,23 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     return le32_to_cpu(crc);
 }
 #undef DO_CRC
+#endif /* CRC32_SLICE8 */
+
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+#if defined(CONFIG_CRC32_ARMV8) && !defined(USE_HOSTCC)
+	if (!crc32_armv8(&crc, buf, len))
+		return crc;
+#endif
+#ifdef CRC32_SLICE8
+	return crc32_slice8(crc, buf, len);
+#else
+	return crc32_bytewise(crc, buf, len);
+#endif
+}
 
 uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
 {
@@ -261,3 +313,72 @@ void crc32_wd_buf(const unsigned char *input, unsigned int ilen,
 	crc = htonl(crc);
 	memcpy(output, &crc, sizeof(crc));
 }
+
+/*
+ * crc32_combine() is derived from zlib-1.2.11: appending len2 zero bytes
+ * to the first message is a linear operation on its crc, done here by
+ * repeatedly squaring the operator for one zero bit.
+ */
+#define GF2_DIM 32
+
+local uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	while (vec) {
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+
+	return sum;
+}
+
+local void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	int n;
+
+	for (n = 0; n < GF2_DIM; n++)
+		square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+uint32_t ZEXPORT crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+	uint32_t even[GF2_DIM];	/* even-power-of-two zeros operator */
+	uint32_t odd[GF2_DIM];	/* odd-power-of-two zeros operator */
+	uint32_t row;
+	int n;
+
+	if (!len2)
+		return crc1;
+
+	/* Operator for one zero bit in odd */
+	odd[0] = 0xedb88320;
+	row = 1;
+	for (n = 1; n < GF2_DIM; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	/* Two zero bits in even, then four zero bits in odd */
+	gf2_matrix_square(even, odd);
+	gf2_matrix_square(odd, even);
+
+	/* Apply len2 zero bytes to crc1, one bit of len2 at a time */
+	do {
+		gf2_matrix_square(even, odd);
+		if (len2 & 1)
+			crc1 = gf2_matrix_times(even, crc1);
+		len2 >>= 1;
+		if (!len2)
+			break;
+
+		gf2_matrix_square(odd, even);
+		if (len2 & 1)
+			crc1 = gf2_matrix_times(odd, crc1);
+		len2 >>= 1;
+	} while (len2);
+
+	return crc1 ^ crc2;
+}
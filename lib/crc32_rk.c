@@ -0,0 +1,40 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <u-boot/crc.h>
+
+/*
+ * Rockchip images (KRNL, PARM) are protected by a crc32 with polynomial
+ * 0x04c10db7, computed msb first with no inversion, as done by rkcrc.
+ */
+#define RKCRC_POLY	0x04c10db7
+
+static uint32_t crc32_rk_table[256];
+
+static void crc32_rk_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i << 24;
+		for (j = 0; j < 8; j++)
+			c = (c & 0x80000000) ? (c << 1) ^ RKCRC_POLY : c << 1;
+		crc32_rk_table[i] = c;
+	}
+}
+
+uint32_t crc32_rk(uint32_t crc, const unsigned char *buf, uint len)
+{
+	if (!crc32_rk_table[1])
+		crc32_rk_init();
+
+	while (len--)
+		crc = (crc << 8) ^ crc32_rk_table[(crc >> 24) ^ *buf++];
+
+	return crc;
+}
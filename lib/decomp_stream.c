@@ -0,0 +1,545 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <decomp_stream.h>
+#include <image.h>
+#include <malloc.h>
+#include <asm/unaligned.h>
+#include <linux/lzo.h>
+#include <linux/xxhash.h>
+#include <u-boot/lz4.h>
+#include <u-boot/zlib.h>
+
+enum {
+	DS_HEADER,
+	DS_BLOCK_HEADER,
+	DS_BLOCK,
+	DS_BLOCK_CSUM,
+	DS_INFLATE,
+	DS_TRAILER,
+	DS_DONE,
+	DS_ERROR,
+};
+
+#define GZ_MAGIC0		0x1f
+#define GZ_MAGIC1		0x8b
+#define GZ_DEFLATED		8
+#define GZ_HEAD_CRC		2
+#define GZ_EXTRA_FIELD		4
+#define GZ_ORIG_NAME		8
+#define GZ_COMMENT		0x10
+#define GZ_RESERVED		0xe0
+#define GZ_TRAILER_LEN		8	/* crc32, size */
+
+#define LZOP_BLOCK_HDR_LEN	12	/* dst size, src size, checksum */
+
+static int ds_fail(struct decomp_stream *ds, int err, const char *why)
+{
+	ds->state = DS_ERROR;
+	ds->err = err;
+	ds->error = why;
+
+	return err;
+}
+
+/* Collect input in ds->hdr until it holds @need bytes; true once it does */
+static bool ds_fill(struct decomp_stream *ds, const u8 **src, ulong *len,
+		    uint need)
+{
+	ulong n;
+
+	if (ds->hdr_len >= need)
+		return true;
+
+	n = min_t(ulong, need - ds->hdr_len, *len);
+	memcpy(ds->hdr + ds->hdr_len, *src, n);
+	ds->hdr_len += n;
+	*src += n;
+	*len -= n;
+
+	return ds->hdr_len == need;
+}
+
+/*
+ * Get the @need bytes of the current block in one piece: straight from
+ * the input when it has them all, else collected in ds->stage over as
+ * many pieces as it takes. Returns 1 with @blk set once they are there,
+ * 0 while more input is needed.
+ */
+static int ds_gather(struct decomp_stream *ds, const u8 **src, ulong *len,
+		     ulong need, const u8 **blk)
+{
+	ulong n;
+
+	if (!ds->stage_len && *len >= need) {
+		*blk = *src;
+		*src += need;
+		*len -= need;
+		return 1;
+	}
+
+	if (need > ds->stage_size) {
+		free(ds->stage);
+		ds->stage_size = max(need, ds->blk_max);
+		ds->stage = malloc(ds->stage_size);
+		if (!ds->stage) {
+			ds->stage_size = 0;
+			return ds_fail(ds, -ENOMEM, "out of memory");
+		}
+	}
+
+	n = min(need - ds->stage_len, *len);
+	memcpy(ds->stage + ds->stage_len, *src, n);
+	ds->stage_len += n;
+	*src += n;
+	*len -= n;
+	if (ds->stage_len < need)
+		return 0;
+
+	ds->stage_len = 0;
+	*blk = ds->stage;
+
+	return 1;
+}
+
+/* Copy a block stored as is; 1 once it is all there */
+static int ds_copy(struct decomp_stream *ds, const u8 **src, ulong *len)
+{
+	ulong n = min(ds->blk_in, *len);
+
+	if (n > ds->dst_len - ds->out)
+		return ds_fail(ds, -ENOBUFS, "output does not fit");
+	memcpy(ds->dst + ds->out, *src, n);
+	ds->out += n;
+	ds->blk_in -= n;
+	*src += n;
+	*len -= n;
+
+	return !ds->blk_in;
+}
+
+static int ds_none(struct decomp_stream *ds, const u8 *src, ulong len)
+{
+	int ret;
+
+	ds->blk_in = len;
+	ret = ds_copy(ds, &src, &len);
+
+	return ret < 0 ? ret : 0;
+}
+
+#ifdef CONFIG_GZIP
+/*
+ * Get the length of the gzip header in @h, given the @len bytes there.
+ * While that is more than @len, more bytes are needed to know it.
+ */
+static int gzip_header_len(const u8 *h, uint len)
+{
+	uint i = 10;
+
+	if (len < i)
+		return i;
+	if (h[0] != GZ_MAGIC0 || h[1] != GZ_MAGIC1 || h[2] != GZ_DEFLATED ||
+	    (h[3] & GZ_RESERVED))
+		return -1;
+	if (h[3] & GZ_EXTRA_FIELD) {
+		if (len < 12)
+			return 12;
+		i = 12 + h[10] + (h[11] << 8);
+	}
+	if (h[3] & GZ_ORIG_NAME) {
+		do {
+			if (len <= i)
+				return i + 1;
+		} while (h[i++]);
+	}
+	if (h[3] & GZ_COMMENT) {
+		do {
+			if (len <= i)
+				return i + 1;
+		} while (h[i++]);
+	}
+	if (h[3] & GZ_HEAD_CRC)
+		i += 2;
+
+	return i;
+}
+
+static int ds_gzip(struct decomp_stream *ds, const u8 *src, ulong len)
+{
+	z_stream *zs = ds->zs;
+	int need, r;
+
+	while (len && ds->state != DS_DONE) {
+		switch (ds->state) {
+		case DS_HEADER:
+			need = gzip_header_len(ds->hdr, ds->hdr_len);
+			if (need < 0)
+				return ds_fail(ds, -EINVAL, "bad gzip header");
+			if (need > DECOMP_STREAM_HDR_MAX)
+				return ds_fail(ds, -E2BIG,
+					       "gzip header too long");
+			if (need > ds->hdr_len) {
+				ds_fill(ds, &src, &len, need);
+				break;
+			}
+			ds->hdr_len = 0;
+			ds->state = DS_INFLATE;
+			break;
+		case DS_INFLATE:
+			zs->next_in = (u8 *)src;
+			zs->avail_in = len;
+			zs->next_out = ds->dst + ds->out;
+			zs->avail_out = ds->dst_len - ds->out;
+			r = inflate(zs, Z_NO_FLUSH);
+			ds->out = zs->next_out - ds->dst;
+			src = zs->next_in;
+			len = zs->avail_in;
+			if (r == Z_STREAM_END) {
+				ds->state = DS_TRAILER;
+			} else if (r == Z_BUF_ERROR && !zs->avail_out) {
+				return ds_fail(ds, -ENOBUFS,
+					       "output does not fit");
+			} else if (r != Z_OK) {
+				return ds_fail(ds, -EPROTO,
+					       "gzip data is corrupt");
+			}
+			break;
+		case DS_TRAILER:
+			if (!ds_fill(ds, &src, &len, GZ_TRAILER_LEN))
+				break;
+			if (get_unaligned_le32(ds->hdr + 4) != (u32)ds->out)
+				return ds_fail(ds, -EBADMSG,
+					       "gzip size mismatch");
+			ds->state = DS_DONE;
+			break;
+		}
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_LZ4
+static int ds_lz4_header(struct decomp_stream *ds)
+{
+	int ret;
+
+	ret = ulz4_frame_header(ds->hdr, ds->hdr_len, &ds->lz4);
+	if (ret == -EPROTONOSUPPORT)
+		return ds_fail(ds, ret, "not an lz4 frame");
+	if (ret < 0)
+		return ds_fail(ds, ret, "bad lz4 frame header");
+	ds->blk_max = ds->lz4.block_max;
+	xxh32_reset(&ds->xxh, 0);
+
+	return 0;
+}
+
+/*
+ * Decompress the current block; 1 once done, 0 while input is missing.
+ * Linked blocks copy from the output before them, which is all in place.
+ */
+static int ds_lz4_block(struct decomp_stream *ds, const u8 **src, ulong *len)
+{
+	u8 *out = ds->dst + ds->out;
+	const u8 *blk;
+	size_t n;
+	int ret;
+
+	if (ds->blk_raw) {
+		ret = ds_copy(ds, src, len);
+		if (ret > 0 && ds->lz4.block_csum)
+			ds->blk_hash = xxh32(ds->dst + ds->blk_start,
+					     ds->out - ds->blk_start, 0);
+		return ret;
+	}
+
+	ret = ds_gather(ds, src, len, ds->blk_in, &blk);
+	if (ret <= 0)
+		return ret;
+	if (ds->lz4.block_csum)
+		ds->blk_hash = xxh32(blk, ds->blk_in, 0);
+	n = ds->dst_len - ds->out;
+	if (ulz4_decompress_block(blk, ds->blk_in, out, &n,
+				  ds->lz4.independent ? out : ds->dst))
+		return ds_fail(ds, -EPROTO, "lz4 data is corrupt");
+	ds->out += n;
+
+	return 1;
+}
+
+static int ds_lz4(struct decomp_stream *ds, const u8 *src, ulong len)
+{
+	u32 raw;
+	uint need;
+	int ret;
+
+	while (len && ds->state != DS_DONE) {
+		switch (ds->state) {
+		case DS_HEADER:
+			if (!ds_fill(ds, &src, &len, LZ4F_HDR_LEN))
+				break;
+			need = LZ4F_HDR_LEN;
+			if (ds->hdr[4] & LZ4F_CONTENT_SIZE)
+				need = LZ4F_HDR_MAX;
+			if (!ds_fill(ds, &src, &len, need))
+				break;
+			ret = ds_lz4_header(ds);
+			if (ret)
+				return ret;
+			ds->hdr_len = 0;
+			ds->state = DS_BLOCK_HEADER;
+			break;
+		case DS_BLOCK_HEADER:
+			if (!ds_fill(ds, &src, &len, sizeof(u32)))
+				break;
+			raw = get_unaligned_le32(ds->hdr);
+			ds->hdr_len = 0;
+			if (!raw) {
+				if (ds->lz4.has_size &&
+				    ds->lz4.content_size != ds->out)
+					return ds_fail(ds, -EPROTO,
+						       "lz4 size is wrong");
+				ds->state = ds->lz4.content_csum ?
+					    DS_TRAILER : DS_DONE;
+				break;
+			}
+			ds->blk_raw = raw & LZ4F_BLOCK_RAW;
+			ds->blk_in = raw & ~LZ4F_BLOCK_RAW;
+			ds->blk_start = ds->out;
+			if (ds->blk_in > ds->blk_max)
+				return ds_fail(ds, -EINVAL, "bad lz4 block");
+			ds->state = DS_BLOCK;
+			break;
+		case DS_BLOCK:
+			ret = ds_lz4_block(ds, &src, &len);
+			if (ret < 0)
+				return ret;
+			if (!ret)
+				break;
+			if (ds->lz4.content_csum)
+				xxh32_update(&ds->xxh, ds->dst + ds->blk_start,
+					     ds->out - ds->blk_start);
+			ds->state = ds->lz4.block_csum ? DS_BLOCK_CSUM :
+				    DS_BLOCK_HEADER;
+			break;
+		case DS_BLOCK_CSUM:
+			if (!ds_fill(ds, &src, &len, sizeof(u32)))
+				break;
+			ds->hdr_len = 0;
+			if (get_unaligned_le32(ds->hdr) != ds->blk_hash)
+				return ds_fail(ds, -EPROTO,
+					       "lz4 block checksum mismatch");
+			ds->state = DS_BLOCK_HEADER;
+			break;
+		case DS_TRAILER:
+			if (!ds_fill(ds, &src, &len, sizeof(u32)))
+				break;
+			ds->hdr_len = 0;
+			if (get_unaligned_le32(ds->hdr) != xxh32_digest(&ds->xxh))
+				return ds_fail(ds, -EPROTO,
+					       "lz4 checksum mismatch");
+			ds->state = DS_DONE;
+			break;
+		}
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_LZO
+/* Decompress the current block; 1 once done, 0 while input is missing */
+static int ds_lzo_block(struct decomp_stream *ds, const u8 **src, ulong *len)
+{
+	const u8 *blk;
+	size_t n;
+	int ret;
+
+	if (ds->blk_raw)
+		return ds_copy(ds, src, len);
+
+	ret = ds_gather(ds, src, len, ds->blk_in, &blk);
+	if (ret <= 0)
+		return ret;
+	n = ds->blk_out;
+	ret = lzo1x_decompress_safe(blk, ds->blk_in, ds->dst + ds->out, &n);
+	if (ret != LZO_E_OK || n != ds->blk_out)
+		return ds_fail(ds, -EPROTO, "lzo data is corrupt");
+	ds->out += n;
+
+	return 1;
+}
+
+static int ds_lzo(struct decomp_stream *ds, const u8 *src, ulong len)
+{
+	int need;
+	int ret;
+
+	while (len && ds->state != DS_DONE) {
+		switch (ds->state) {
+		case DS_HEADER:
+			need = lzop_header_len(ds->hdr, ds->hdr_len);
+			if (need < 0)
+				return ds_fail(ds, -EINVAL, "bad lzop header");
+			if (need > DECOMP_STREAM_HDR_MAX)
+				return ds_fail(ds, -E2BIG,
+					       "lzop header too long");
+			if (need > ds->hdr_len) {
+				ds_fill(ds, &src, &len, need);
+				break;
+			}
+			ds->hdr_len = 0;
+			ds->state = DS_BLOCK_HEADER;
+			break;
+		case DS_BLOCK_HEADER:
+			if (!ds_fill(ds, &src, &len, sizeof(u32)))
+				break;
+			ds->blk_out = get_unaligned_be32(ds->hdr);
+			if (!ds->blk_out) {
+				ds->state = DS_DONE;
+				break;
+			}
+			if (!ds_fill(ds, &src, &len, LZOP_BLOCK_HDR_LEN))
+				break;
+			ds->blk_in = get_unaligned_be32(ds->hdr + 4);
+			ds->hdr_len = 0;
+			if (!ds->blk_in || ds->blk_in > ds->blk_out)
+				return ds_fail(ds, -EINVAL, "bad lzop block");
+			if (ds->blk_out > ds->dst_len - ds->out)
+				return ds_fail(ds, -ENOBUFS,
+					       "output does not fit");
+			/* lzo1x_decompress_safe() cannot take stored data */
+			ds->blk_raw = ds->blk_in == ds->blk_out;
+			ds->state = DS_BLOCK;
+			break;
+		case DS_BLOCK:
+			ret = ds_lzo_block(ds, &src, &len);
+			if (ret < 0)
+				return ret;
+			if (ret)
+				ds->state = DS_BLOCK_HEADER;
+			break;
+		}
+	}
+
+	return 0;
+}
+#endif
+
+int decomp_stream_detect(const void *src, ulong len)
+{
+	const u8 *p = src;
+
+#ifdef CONFIG_GZIP
+	if (len >= 2 && p[0] == GZ_MAGIC0 && p[1] == GZ_MAGIC1)
+		return IH_COMP_GZIP;
+#endif
+#ifdef CONFIG_LZ4
+	if (len >= 4 && get_unaligned_le32(p) == LZ4F_MAGIC)
+		return IH_COMP_LZ4;
+#endif
+#ifdef CONFIG_LZO
+	if (len >= 9 && lzop_header_len(p, 9) >= 0)
+		return IH_COMP_LZO;
+#endif
+
+	return IH_COMP_NONE;
+}
+
+int decomp_stream_init(struct decomp_stream *ds, int comp, void *dst,
+		       ulong dst_len)
+{
+#ifdef CONFIG_GZIP
+	z_stream *zs;
+#endif
+
+	memset(ds, 0, sizeof(*ds));
+	ds->comp = comp;
+	ds->dst = dst;
+	ds->dst_len = dst_len;
+	ds->state = DS_HEADER;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		return 0;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		zs = calloc(1, sizeof(*zs));
+		if (!zs)
+			return -ENOMEM;
+		zs->zalloc = gzalloc;
+		zs->zfree = gzfree;
+		if (inflateInit2(zs, -MAX_WBITS) != Z_OK) {
+			free(zs);
+			return -ENOMEM;
+		}
+		ds->zs = zs;
+		return 0;
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return 0;
+#endif
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+		return 0;
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+
+int decomp_stream_write(struct decomp_stream *ds, const void *src,
+			ulong len)
+{
+	if (ds->state == DS_ERROR)
+		return ds->err;
+
+	switch (ds->comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return ds_gzip(ds, src, len);
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return ds_lz4(ds, src, len);
+#endif
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+		return ds_lzo(ds, src, len);
+#endif
+	default:
+		return ds_none(ds, src, len);
+	}
+}
+
+int decomp_stream_finish(struct decomp_stream *ds, ulong *out_len)
+{
+	int ret = 0;
+
+	if (ds->state == DS_ERROR) {
+		ret = ds->err;
+	} else if (ds->comp != IH_COMP_NONE && ds->state != DS_DONE) {
+		ds->error = "stream is truncated";
+		ret = -EINVAL;
+	}
+	*out_len = ds->out;
+
+	free(ds->stage);
+	ds->stage = NULL;
+#ifdef CONFIG_GZIP
+	if (ds->zs) {
+		inflateEnd(ds->zs);
+		free(ds->zs);
+		ds->zs = NULL;
+	}
+#endif
+
+	return ret;
+}
@@ -0,0 +1,309 @@
+/*
+ * Phandle and path lookup caches for libfdt
+ *
+ * fdt_node_offset_by_phandle() and fdt_path_offset() walk the tree from the
+ * start on every call. Drivers resolve the same phandles and aliases over
+ * and over, so remember the answers here. libfdt drops the caches for a tree
+ * whenever it changes the tree's layout, and 'fdt addr' and fdt_open_into()
+ * drop them for a tree put where another one was. Code that overwrites a
+ * tree in any other way must call fdt_cache_invalidate().
+ *
+ * An entry is also checked against the tree before it is returned: a
+ * phandle must still be on its node, a path must still lead to a node of
+ * the same name, and an alias, which fdt_setprop_inplace() can change, must
+ * still point to the same place.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <libfdt.h>
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Phandles above this are not put in the table and are always searched */
+#define FDT_CACHE_MAX_PHANDLE	8192
+/* The table grows by this many phandles at a time */
+#define FDT_CACHE_PHANDLE_STEP	64
+
+/* Number of trees with a phandle table, e.g. the control and working FDT */
+#define FDT_CACHE_TREES		2
+
+#define FDT_CACHE_PATHS		8
+#define FDT_CACHE_PATH_LEN	48
+
+/**
+ * struct fdt_phandle_table - node offsets of one tree, indexed by phandle
+ *
+ * The first lookup in a generation fills the table with one walk of the
+ * tree. Dropping the table just starts a new generation, so a tree that is
+ * edited between lookups is only walked again when a phandle is next
+ * looked up. Phandles found by a search are added as well.
+ *
+ * @fdt: Tree that this table describes, NULL if the slot is unused
+ * @offset: Node offset for each phandle
+ * @gen: Generation that each entry of @offset was filled in
+ * @count: Number of entries in @offset and @gen
+ * @cur_gen: Current generation, entries of older ones are not set
+ * @filled_gen: Generation in which the tree was last walked
+ * @last_used: Value of fdt_cache_clock when the table was last used
+ */
+struct fdt_phandle_table {
+	const void *fdt;
+	int *offset;
+	uint *gen;
+	uint count;
+	uint cur_gen;
+	uint filled_gen;
+	uint last_used;
+};
+
+/**
+ * struct fdt_path_entry - a resolved path
+ *
+ * @fdt: Tree that the path was resolved in, NULL if the entry is unused
+ * @offset: Node offset that the path resolved to
+ * @name_hash: Hash of the node's name, to notice a rewritten tree
+ * @alias_hash: Hash of the alias that @path starts with, 0 if none
+ * @len: Length of @path
+ * @path: Path or alias as passed to fdt_path_offset_namelen()
+ */
+struct fdt_path_entry {
+	const void *fdt;
+	int offset;
+	u32 name_hash;
+	u32 alias_hash;
+	int len;
+	char path[FDT_CACHE_PATH_LEN];
+};
+
+static struct fdt_phandle_table phandle_tables[FDT_CACHE_TREES];
+static struct fdt_path_entry path_cache[FDT_CACHE_PATHS];
+static uint path_next;
+static uint fdt_cache_clock;
+static uint fdt_cache_walks;
+
+/* The caches live in BSS and use malloc(), so wait until both are usable */
+static bool fdt_cache_ready(void)
+{
+	return gd->flags & GD_FLG_FULL_MALLOC_INIT;
+}
+
+static void fdt_cache_drop_table(struct fdt_phandle_table *table)
+{
+	if (++table->cur_gen)
+		return;
+	/* Wrapped around, so old entries could look current */
+	if (table->gen)
+		memset(table->gen, '\0', table->count * sizeof(uint));
+	table->cur_gen = 1;
+	table->filled_gen = 0;
+}
+
+static struct fdt_phandle_table *fdt_cache_table(const void *fdt, bool add)
+{
+	struct fdt_phandle_table *table, *oldest = phandle_tables;
+	int i;
+
+	for (i = 0; i < FDT_CACHE_TREES; i++) {
+		table = &phandle_tables[i];
+		if (table->fdt == fdt)
+			goto found;
+		if (table->last_used < oldest->last_used)
+			oldest = table;
+	}
+	if (!add)
+		return NULL;
+	/* Keep the memory, the next tree is likely to need as much */
+	table = oldest;
+	fdt_cache_drop_table(table);
+	table->fdt = fdt;
+found:
+	table->last_used = ++fdt_cache_clock;
+
+	return table;
+}
+
+static int fdt_cache_grow(struct fdt_phandle_table *table, uint32_t phandle)
+{
+	uint count = min_t(uint, ALIGN(phandle + 1, FDT_CACHE_PHANDLE_STEP),
+			   FDT_CACHE_MAX_PHANDLE + 1);
+	int *offset;
+	uint *gen;
+
+	offset = realloc(table->offset, count * sizeof(int));
+	if (!offset)
+		return -FDT_ERR_NOSPACE;
+	table->offset = offset;
+	gen = realloc(table->gen, count * sizeof(uint));
+	if (!gen)
+		return -FDT_ERR_NOSPACE;
+	memset(gen + table->count, '\0', (count - table->count) * sizeof(uint));
+	table->gen = gen;
+	table->count = count;
+
+	return 0;
+}
+
+/* Put every phandle of the tree in the table, walking the tree once */
+static void fdt_cache_fill(struct fdt_phandle_table *table)
+{
+	const void *fdt = table->fdt;
+	uint32_t phandle;
+	int offset;
+
+	fdt_cache_walks++;
+	table->filled_gen = table->cur_gen;
+	for (offset = fdt_next_node(fdt, -1, NULL);
+	     offset >= 0;
+	     offset = fdt_next_node(fdt, offset, NULL)) {
+		phandle = fdt_get_phandle(fdt, offset);
+		if (!phandle || phandle > FDT_CACHE_MAX_PHANDLE)
+			continue;
+		if (phandle >= table->count && fdt_cache_grow(table, phandle))
+			return;
+		/* A search would find the first node with the phandle */
+		if (table->gen[phandle] == table->cur_gen)
+			continue;
+		table->offset[phandle] = offset;
+		table->gen[phandle] = table->cur_gen;
+	}
+}
+
+int fdt_cache_phandle(const void *fdt, uint32_t phandle)
+{
+	struct fdt_phandle_table *table;
+	int offset;
+
+	if (!fdt_cache_ready())
+		return -1;
+	table = fdt_cache_table(fdt, true);
+	if (table->filled_gen != table->cur_gen)
+		fdt_cache_fill(table);
+	if (phandle >= table->count ||
+	    table->gen[phandle] != table->cur_gen)
+		goto search;
+	offset = table->offset[phandle];
+	if (fdt_get_phandle(fdt, offset) != phandle)
+		goto search;
+
+	return offset;
+
+search:
+	/* The caller walks the tree instead */
+	fdt_cache_walks++;
+	return -1;
+}
+
+void fdt_cache_add_phandle(const void *fdt, uint32_t phandle, int offset)
+{
+	struct fdt_phandle_table *table;
+
+	if (!fdt_cache_ready() || phandle > FDT_CACHE_MAX_PHANDLE)
+		return;
+	table = fdt_cache_table(fdt, true);
+	if (phandle < table->count && table->gen[phandle] == table->cur_gen &&
+	    table->offset[phandle] != offset) {
+		/* The phandle moved: the tree changed behind libfdt's back */
+		fdt_cache_invalidate(fdt);
+	}
+	if (phandle >= table->count && fdt_cache_grow(table, phandle))
+		return;
+	table->offset[phandle] = offset;
+	table->gen[phandle] = table->cur_gen;
+}
+
+static u32 fdt_cache_hash(const char *str)
+{
+	u32 hash = 2166136261U;
+
+	if (!str)
+		return 0;
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619;
+
+	return hash;
+}
+
+/* Hash of the path that the alias at the start of @path points to */
+static u32 fdt_cache_alias_hash(const void *fdt, const char *path,
+				int namelen)
+{
+	int len;
+
+	if (*path == '/')
+		return 0;
+	for (len = 0; len < namelen; len++) {
+		if (path[len] == '/' || path[len] == ':')
+			break;
+	}
+
+	return fdt_cache_hash(fdt_get_alias_namelen(fdt, path, len));
+}
+
+int fdt_cache_path(const void *fdt, const char *path, int namelen)
+{
+	struct fdt_path_entry *entry;
+	int i;
+
+	if (!fdt_cache_ready() || namelen > FDT_CACHE_PATH_LEN)
+		return -1;
+	for (i = 0; i < FDT_CACHE_PATHS; i++) {
+		entry = &path_cache[i];
+		if (entry->fdt != fdt || entry->len != namelen ||
+		    memcmp(entry->path, path, namelen))
+			continue;
+		if (fdt_cache_hash(fdt_get_name(fdt, entry->offset, NULL)) !=
+		    entry->name_hash ||
+		    fdt_cache_alias_hash(fdt, path, namelen) !=
+		    entry->alias_hash) {
+			entry->fdt = NULL;
+			return -1;
+		}
+
+		return entry->offset;
+	}
+
+	return -1;
+}
+
+void fdt_cache_add_path(const void *fdt, const char *path, int namelen,
+			int offset)
+{
+	struct fdt_path_entry *entry;
+	u32 alias_hash;
+
+	if (!fdt_cache_ready() || namelen > FDT_CACHE_PATH_LEN)
+		return;
+	/* This looks up /aliases, so do it before taking an entry */
+	alias_hash = fdt_cache_alias_hash(fdt, path, namelen);
+	entry = &path_cache[path_next++ % FDT_CACHE_PATHS];
+	entry->fdt = fdt;
+	entry->offset = offset;
+	entry->name_hash = fdt_cache_hash(fdt_get_name(fdt, offset, NULL));
+	entry->alias_hash = alias_hash;
+	entry->len = namelen;
+	memcpy(entry->path, path, namelen);
+}
+
+uint fdt_cache_phandle_walks(void)
+{
+	return fdt_cache_walks;
+}
+
+void fdt_cache_invalidate(const void *fdt)
+{
+	int i;
+
+	if (!fdt_cache_ready())
+		return;
+	for (i = 0; i < FDT_CACHE_TREES; i++) {
+		if (phandle_tables[i].fdt == fdt)
+			fdt_cache_drop_table(&phandle_tables[i]);
+	}
+	for (i = 0; i < FDT_CACHE_PATHS; i++) {
+		if (path_cache[i].fdt == fdt)
+			path_cache[i].fdt = NULL;
+	}
+}
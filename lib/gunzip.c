@@ -25,6 +25,11 @@
 #define RESERVED		0xe0
 #define DEFLATED		8
 
+/* gzwrite() writes at least this much at a time, if memory allows */
+#define GZWRITE_BATCH_SIZE	(4 << 20)
+/* deflate never expands its input by more than this */
+#define DEFLATE_MAX_RATIO	1032
+
 void *gzalloc(void *x, unsigned items, unsigned size)
 {
 	void *p;
@@ -115,11 +120,13 @@ int gzwrite(unsigned char *src, int len,
 	z_stream s;
 	int r = 0;
 	unsigned char *writebuf;
+	unsigned long szbatch;
 	unsigned crc = 0;
 	u64 totalfilled = 0;
 	lbaint_t blksperbuf, outblock;
 	u32 expected_crc;
 	u32 payload_size;
+	bool size_known;
 	int iteration = 0;
 
 	if (!szwritebuf ||
@@ -136,7 +143,6 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
-	blksperbuf = szwritebuf / dev->blksz;
 	outblock = lldiv(startoffs, dev->blksz);
 
 	/* skip header */
@@ -168,6 +174,12 @@ int gzwrite(unsigned char *src, int len,
 	expected_crc = le32_to_cpu(expected_crc);
 	u32 szuncompressed;
 	memcpy(&szuncompressed, src + len - 4, sizeof(szuncompressed));
+	/*
+	 * The trailer only has the size modulo 4GiB. It is the real size
+	 * when there is too little data to inflate to 4GiB.
+	 */
+	size_known = szexpected ||
+		     payload_size < (1ULL << 32) / DEFLATE_MAX_RATIO;
 	if (szexpected == 0) {
 		szexpected = le32_to_cpu(szuncompressed);
 	} else if (szuncompressed != (u32)szexpected) {
@@ -194,7 +206,27 @@ int gzwrite(unsigned char *src, int len,
 
 	s.next_in = src + i;
 	s.avail_in = payload_size+8;
-	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
+
+	/*
+	 * Batch the output into large writes, a whole number of
+	 * szwritebuf each, so that the device is not written in small pieces.
+	 * Only a small image of known size gets a smaller batch.
+	 */
+	szbatch = roundup(GZWRITE_BATCH_SIZE, szwritebuf);
+	if (size_known && szexpected < szbatch)
+		szbatch = max(roundup((unsigned long)szexpected, szwritebuf),
+			      szwritebuf);
+	writebuf = (unsigned char *)malloc_cache_aligned(szbatch);
+	if (!writebuf && szbatch > szwritebuf) {
+		szbatch = szwritebuf;
+		writebuf = (unsigned char *)malloc_cache_aligned(szbatch);
+	}
+	if (!writebuf) {
+		printf("%s: cannot allocate %lu bytes\n", __func__, szbatch);
+		inflateEnd(&s);
+		return -1;
+	}
+	blksperbuf = szbatch / dev->blksz;
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -210,7 +242,7 @@ int gzwrite(unsigned char *src, int len,
 			int numfilled;
 			lbaint_t writeblocks;
 
-			s.avail_out = szwritebuf;
+			s.avail_out = szbatch;
 			s.next_out = writebuf;
 			r = inflate(&s, Z_SYNC_FLUSH);
 			if ((r != Z_OK) &&
@@ -218,10 +250,10 @@ int gzwrite(unsigned char *src, int len,
 				printf("Error: inflate() returned %d\n", r);
 				goto out;
 			}
-			numfilled = szwritebuf - s.avail_out;
+			numfilled = szbatch - s.avail_out;
 			crc = crc32(crc, writebuf, numfilled);
 			totalfilled += numfilled;
-			if (numfilled < szwritebuf) {
+			if (numfilled < szbatch) {
 				writeblocks = (numfilled+dev->blksz-1)
 						/ dev->blksz;
 				memset(writebuf+numfilled, 0,
@@ -10,25 +10,102 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if defined(CONFIG_SANDBOX) && defined(__pie__)
+extern char __executable_start[];
+#endif
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_INITCALL)
+static void initcall_add_record(gd_t *gdp, ulong func, ulong start_us,
+				ulong duration_us)
+{
+	struct initcall_record *rec;
+
+	if (gdp->initcall_count < CONFIG_BOOTSTAGE_INITCALL_COUNT) {
+		rec = &gdp->initcall_rec[gdp->initcall_count];
+		rec->func = func;
+		rec->start_us = start_us;
+		rec->duration_us = duration_us;
+	}
+	gdp->initcall_count++;
+}
+
+static void initcall_record(ulong func, ulong start_us)
+{
+	ulong duration_us = timer_get_boot_us() - start_us;
+
+	initcall_add_record(gd, func, start_us, duration_us);
+
+	/*
+	 * Global data is copied to its new location part-way through
+	 * init_sequence_f, so write the later records to the copy too
+	 */
+	if (!(gd->flags & GD_FLG_RELOC) && gd->new_gd && gd->new_gd != gd)
+		initcall_add_record(gd->new_gd, func, start_us, duration_us);
+}
+
+void initcall_report(void)
+{
+	struct initcall_record *rec;
+	ulong total_us = 0;
+	__maybe_unused ulong base;
+	const char *name = NULL;
+	uint count, i;
+
+	count = min_t(uint, gd->initcall_count,
+		      CONFIG_BOOTSTAGE_INITCALL_COUNT);
+	printf("\nInitcalls (%u):\n", gd->initcall_count);
+	printf("%11s%11s  %s\n", "Start", "Elapsed", "Function");
+	for (i = 0, rec = gd->initcall_rec; i < count; i++, rec++) {
+		print_grouped_ull(rec->start_us, 9);
+		print_grouped_ull(rec->duration_us, 9);
+#ifdef CONFIG_KALLSYMS
+		name = symbol_lookup(rec->func, &base);
+#endif
+		if (name)
+			printf("  %s\n", name);
+		else
+			printf("  %08lx\n", rec->func);
+		total_us += rec->duration_us;
+	}
+	printf("%11s", "");
+	print_grouped_ull(total_us, 9);
+	printf("  total\n");
+	if (gd->initcall_count > count)
+		printf("Only the first %u initcalls were recorded - please increase CONFIG_BOOTSTAGE_INITCALL_COUNT\n",
+		       count);
+}
+#endif
+
 int initcall_run_list(const init_fnc_t init_sequence[])
 {
 	const init_fnc_t *init_fnc_ptr;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		unsigned long reloc_ofs = 0;
+		__maybe_unused ulong start_us;
 		int ret;
 
 		if (gd->flags & GD_FLG_RELOC)
 			reloc_ofs = gd->reloc_off;
 #ifdef CONFIG_EFI_APP
 		reloc_ofs = (unsigned long)image_base;
+#endif
+#if defined(CONFIG_SANDBOX) && defined(__pie__)
+		/* A position-independent executable is linked at address 0 */
+		reloc_ofs = (unsigned long)__executable_start;
 #endif
 		debug("initcall: %p", (char *)*init_fnc_ptr - reloc_ofs);
 		if (gd->flags & GD_FLG_RELOC)
 			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
 		else
 			debug("\n");
+#if CONFIG_IS_ENABLED(BOOTSTAGE_INITCALL)
+		start_us = timer_get_boot_us();
 		ret = (*init_fnc_ptr)();
+		initcall_record((ulong)*init_fnc_ptr - reloc_ofs, start_us);
+#else
+		ret = (*init_fnc_ptr)();
+#endif
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
 			       init_sequence,
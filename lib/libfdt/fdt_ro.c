@@ -158,14 +158,13 @@ static const char *fdt_path_next_separator(const char *path, int len)
 		return sep2;
 }
 
-int fdt_path_offset_namelen(const void *fdt, const char *path, int namelen)
+static int _fdt_path_offset_namelen(const void *fdt, const char *path,
+				    int namelen)
 {
 	const char *end = path + namelen;
 	const char *p = path;
 	int offset = 0;
 
-	FDT_CHECK_HEADER(fdt);
-
 	/* see if we have an alias */
 	if (*path != '/') {
 		const char *q = fdt_path_next_separator(path, namelen);
@@ -204,6 +203,22 @@ int fdt_path_offset_namelen(const void *fdt, const char *path, int namelen)
 	return offset;
 }
 
+int fdt_path_offset_namelen(const void *fdt, const char *path, int namelen)
+{
+	int offset;
+
+	FDT_CHECK_HEADER(fdt);
+
+	offset = fdt_cache_path(fdt, path, namelen);
+	if (offset >= 0)
+		return offset;
+	offset = _fdt_path_offset_namelen(fdt, path, namelen);
+	if (offset >= 0)
+		fdt_cache_add_path(fdt, path, namelen, offset);
+
+	return offset;
+}
+
 int fdt_path_offset(const void *fdt, const char *path)
 {
 	return fdt_path_offset_namelen(fdt, path, strlen(path));
@@ -510,6 +525,10 @@ int fdt_node_offset_by_phandle(const void *fdt, uint32_t phandle)
 
 	FDT_CHECK_HEADER(fdt);
 
+	offset = fdt_cache_phandle(fdt, phandle);
+	if (offset >= 0)
+		return offset;
+
 	/* FIXME: The algorithm here is pretty horrible: we
 	 * potentially scan each property of a node in
 	 * fdt_get_phandle(), then if that didn't find what
@@ -519,8 +538,10 @@ int fdt_node_offset_by_phandle(const void *fdt, uint32_t phandle)
 	for (offset = fdt_next_node(fdt, -1, NULL);
 	     offset >= 0;
 	     offset = fdt_next_node(fdt, offset, NULL)) {
-		if (fdt_get_phandle(fdt, offset) == phandle)
+		if (fdt_get_phandle(fdt, offset) == phandle) {
+			fdt_cache_add_phandle(fdt, phandle, offset);
 			return offset;
+		}
 	}
 
 	return offset; /* error from fdt_next_node() */
@@ -64,6 +64,7 @@ static int _fdt_splice(void *fdt, void *splicepoint, int oldlen, int newlen)
 		return -FDT_ERR_BADOFFSET;
 	if ((end - oldlen + newlen) > ((char *)fdt + fdt_totalsize(fdt)))
 		return -FDT_ERR_NOSPACE;
+	fdt_cache_invalidate(fdt);
 	memmove(p + newlen, p + oldlen, end - p - oldlen);
 	return 0;
 }
@@ -395,6 +396,7 @@ int fdt_open_into(const void *fdt, void *buf, int bufsize)
 	char *tmp;
 
 	FDT_CHECK_HEADER(fdt);
+	fdt_cache_invalidate(buf);
 
 	mem_rsv_size = (fdt_num_mem_rsv(fdt)+1)
 		* sizeof(struct fdt_reserve_entry);
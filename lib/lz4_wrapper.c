@@ -6,8 +6,11 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
+#include <linux/xxhash.h>
+#include <u-boot/lz4.h>
 
 static u16 LZ4_readLE16(const void *src) { return le16_to_cpu(*(u16 *)src); }
 static void LZ4_copy4(void *dst, const void *src) { *(u32 *)dst = *(u32 *)src; }
@@ -24,116 +27,198 @@ typedef uint64_t U64;
 /* Unaltered (except removing unrelated code) from github.com/Cyan4973/lz4. */
 #include "lz4.c"	/* #include for inlining, do not link! */
 
-#define LZ4F_MAGIC 0x184D2204
-
-struct lz4_frame_header {
-	u32 magic;
-	union {
-		u8 flags;
-		struct {
-			u8 reserved0:2;
-			u8 has_content_checksum:1;
-			u8 has_content_size:1;
-			u8 has_block_checksum:1;
-			u8 independent_blocks:1;
-			u8 version:2;
-		};
-	};
-	union {
-		u8 block_descriptor;
-		struct {
-			u8 reserved1:4;
-			u8 max_block_size:3;
-			u8 reserved2:1;
-		};
-	};
-	/* + u64 content_size iff has_content_size is set */
-	/* + u8 header_checksum */
-} __packed;
-
-struct lz4_block_header {
-	union {
-		u32 raw;
-		struct {
-			u32 size:31;
-			u32 not_compressed:1;
-		};
-	};
-	/* + size bytes of data */
-	/* + u32 block_checksum iff has_block_checksum is set */
-} __packed;
+#define LZ4F_VERSION(flg)	((flg) >> 6)
+#define LZ4F_INDEPENDENT	0x20
+#define LZ4F_BLOCK_CSUM		0x10
+#define LZ4F_CONTENT_CSUM	0x04
+#define LZ4F_FLG_RESERVED	0x03
+#define LZ4F_BD_RESERVED	0x8f
+#define LZ4F_BLOCK_MAX(bd)	(1 << (8 + 2 * (((bd) >> 4) & 7)))
 
-int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+int ulz4_frame_header(const void *src, size_t srcn, struct lz4_frame *frame)
 {
+	const u8 *h = src;
+	size_t len = LZ4F_HDR_LEN;
+	u8 flg, bd;
+
+	if (srcn < sizeof(u32) || get_unaligned_le32(h) != LZ4F_MAGIC)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if (srcn < len)
+		return -EINVAL;			/* input overrun */
+
+	flg = h[4];
+	bd = h[5];
+	if (LZ4F_VERSION(flg) != 1)
+		return -EPROTONOSUPPORT;
+	if ((flg & LZ4F_FLG_RESERVED) || (bd & LZ4F_BD_RESERVED) ||
+	    ((bd >> 4) & 7) < 4)
+		return -EINVAL;			/* reserved must be zero */
+
+	frame->independent = flg & LZ4F_INDEPENDENT;
+	frame->block_csum = flg & LZ4F_BLOCK_CSUM;
+	frame->content_csum = flg & LZ4F_CONTENT_CSUM;
+	frame->has_size = flg & LZ4F_CONTENT_SIZE;
+	frame->content_size = 0;
+	frame->block_max = LZ4F_BLOCK_MAX(bd);
+	if (frame->has_size) {
+		len += sizeof(u64);
+		if (srcn < len)
+			return -EINVAL;
+		frame->content_size = get_unaligned_le64(h + 6);
+	}
+
+	/* the checksum covers the flags up to the checksum itself */
+	if (h[len - 1] != ((xxh32(h + 4, len - 5, 0) >> 8) & 0xff))
+		return -EINVAL;
+
+	return len;
+}
+
+int ulz4_decompress_block(const void *src, size_t srcn, void *dst,
+			  size_t *dstn, const void *prefix)
+{
+	int ret;
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(src, dst, srcn, *dstn, endOnInputSize,
+				     full, 0, noDict, prefix, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;	/* decompression error */
+	*dstn = ret;
+
+	return 0;
+}
+
+/*
+ * Decompress one frame. Blocks go straight to their place in the output,
+ * linked blocks included, since the output of the blocks before them is
+ * right there. *@srcn and *@dstn return the bytes used and written.
+ */
+static int ulz4_frame(const void *src, size_t *srcn, void *dst, size_t *dstn)
+{
+	const void *end_in = src + *srcn;
 	const void *end = dst + *dstn;
 	const void *in = src;
 	void *out = dst;
-	int has_block_checksum;
+	struct xxh32_state xxh;
+	struct lz4_frame f;
 	int ret;
-	*dstn = 0;
 
-	{ /* With in-place decompression the header may become invalid later. */
-		const struct lz4_frame_header *h = in;
-
-		if (srcn < sizeof(*h) + sizeof(u64) + sizeof(u8))
-			return -EINVAL;	/* input overrun */
-
-		/* We assume there's always only a single, standard frame. */
-		if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
-			return -EPROTONOSUPPORT;	/* unknown format */
-		if (h->reserved0 || h->reserved1 || h->reserved2)
-			return -EINVAL;	/* reserved must be zero */
-		if (!h->independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
-		has_block_checksum = h->has_block_checksum;
-
-		in += sizeof(*h);
-		if (h->has_content_size)
-			in += sizeof(u64);
-		in += sizeof(u8);
-	}
+	/* With in-place decompression the header may become invalid later. */
+	ret = ulz4_frame_header(in, *srcn, &f);
+	if (ret < 0)
+		return ret;
+	in += ret;
+	if (f.content_csum)
+		xxh32_reset(&xxh, 0);
 
 	while (1) {
-		struct lz4_block_header b;
-
-		b.raw = le32_to_cpu(*(u32 *)in);
-		in += sizeof(struct lz4_block_header);
+		u32 size, raw;
 
-		if (in - src + b.size > srcn) {
+		if (end_in - in < sizeof(u32)) {
 			ret = -EINVAL;		/* input overrun */
 			break;
 		}
+		raw = get_unaligned_le32(in);
+		in += sizeof(u32);
+		size = raw & ~LZ4F_BLOCK_RAW;
 
-		if (!b.size) {
-			ret = 0;	/* decompression successful */
+		if (!raw) {
+			ret = 0;	/* end mark */
+			break;
+		}
+		if (size > f.block_max) {
+			ret = -EINVAL;		/* bad block size */
+			break;
+		}
+		if (size + (f.block_csum ? sizeof(u32) : 0) > end_in - in) {
+			ret = -EINVAL;		/* input overrun */
+			break;
+		}
+		if (f.block_csum &&
+		    xxh32(in, size, 0) != get_unaligned_le32(in + size)) {
+			ret = -EPROTO;		/* block checksum mismatch */
 			break;
 		}
 
-		if (b.not_compressed) {
-			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
-			out += size;
-			if (size < b.size) {
+		if (raw & LZ4F_BLOCK_RAW) {
+			size_t n = min((ptrdiff_t)size, end - (const void *)out);
+
+			memmove(out, in, n);
+			if (f.content_csum)
+				xxh32_update(&xxh, out, n);
+			out += n;
+			if (n < size) {
 				ret = -ENOBUFS;	/* output overrun */
 				break;
 			}
 		} else {
-			/* constant folding essential, do not touch params! */
-			ret = LZ4_decompress_generic(in, out, b.size,
-					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
-			if (ret < 0) {
-				ret = -EPROTO;	/* decompression error */
+			size_t n = end - (const void *)out;
+
+			ret = ulz4_decompress_block(in, size, out, &n,
+						    f.independent ? out : dst);
+			if (ret)
 				break;
-			}
-			out += ret;
+			if (f.content_csum)
+				xxh32_update(&xxh, out, n);
+			out += n;
 		}
 
-		in += b.size;
-		if (has_block_checksum)
+		in += size;
+		if (f.block_csum)
 			in += sizeof(u32);
 	}
 
+	if (!ret && f.content_csum) {
+		if (end_in - in < sizeof(u32))
+			ret = -EINVAL;		/* input overrun */
+		else if (xxh32_digest(&xxh) != get_unaligned_le32(in))
+			ret = -EPROTO;		/* content checksum mismatch */
+		in += sizeof(u32);
+	}
+	if (!ret && f.has_size && f.content_size != out - dst)
+		ret = -EPROTO;			/* wrong content size */
+
+	*srcn = in - src;
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	const void *end_in = src + srcn;
+	const void *in = src;
+	void *out = dst;
+	size_t room = *dstn;
+	size_t in_len, out_len;
+	int ret;
+
+	*dstn = 0;
+	do {
+		/* Skippable frames hold metadata, not content */
+		if (end_in - in >= 2 * sizeof(u32) &&
+		    (get_unaligned_le32(in) & LZ4F_SKIP_MASK) ==
+		    LZ4F_SKIP_MAGIC) {
+			in_len = get_unaligned_le32(in + sizeof(u32));
+			if (in_len > end_in - in - 2 * sizeof(u32))
+				return -EINVAL;	/* input overrun */
+			in += 2 * sizeof(u32) + in_len;
+			continue;
+		}
+
+		in_len = end_in - in;
+		out_len = room - (out - dst);
+		ret = ulz4_frame(in, &in_len, out, &out_len);
+		*dstn += out_len;
+		if (ret)
+			return ret;
+		in += in_len;
+		out += out_len;
+
+		/* Anything but another frame is padding, which is ignored */
+	} while (end_in - in >= sizeof(u32) &&
+		 (get_unaligned_le32(in) == LZ4F_MAGIC ||
+		  (get_unaligned_le32(in) & LZ4F_SKIP_MASK) == LZ4F_SKIP_MAGIC));
+
+	return 0;
+}
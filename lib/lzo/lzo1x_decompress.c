@@ -62,6 +62,32 @@ static inline const unsigned char *parse_header(const unsigned char *src)
 	return src;
 }
 
+int lzop_header_len(const unsigned char *src, size_t len)
+{
+	size_t n = ARRAY_SIZE(lzop_magic) + 7;
+	u16 version;
+
+	/* the same fields as parse_header(), asking for more as it goes */
+	if (memcmp(src, lzop_magic, min(len, sizeof(lzop_magic))))
+		return -1;
+	if (len < n)
+		return n;
+	version = get_unaligned_be16(src + ARRAY_SIZE(lzop_magic));
+	if (version >= 0x0940)
+		n++;
+	if (len < n + 4)
+		return n + 4;
+	if (get_unaligned_be32(src + n) & HEADER_HAS_FILTER)
+		n += 4;
+	n += 12;
+	if (version >= 0x0940)
+		n += 4;
+	if (len < n + 1)
+		return n + 1;
+
+	return n + 1 + src[n] + 4;
+}
+
 int lzop_decompress(const unsigned char *src, size_t src_len,
 		    unsigned char *dst, size_t *dst_len)
 {
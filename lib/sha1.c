@@ -25,6 +25,9 @@
 #endif /* USE_HOSTCC */
 #include <watchdog.h>
 #include <u-boot/sha1.h>
+#if defined(CONFIG_SHA_ARMV8_CE) && !defined(USE_HOSTCC)
+#include <u-boot/sha_ce.h>
+#endif
 
 const uint8_t sha1_der_prefix[SHA1_DER_LEN] = {
 	0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e,
@@ -220,6 +223,29 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+#if defined(CONFIG_SHA_ARMV8_CE) && !defined(USE_HOSTCC)
+/*
+ * Hash whole blocks with the Crypto Extensions. The context keeps its
+ * state in unsigned longs, so go through a u32 copy.
+ */
+static int sha1_process_ce(sha1_context *ctx, const unsigned char *input,
+			   unsigned int blocks)
+{
+	uint32_t state[5];
+	int i, ret;
+
+	for (i = 0; i < 5; i++)
+		state[i] = ctx->state[i];
+	ret = sha1_ce_blocks(state, input, blocks);
+	if (ret)
+		return ret;
+	for (i = 0; i < 5; i++)
+		ctx->state[i] = state[i];
+
+	return 0;
+}
+#endif
+
 /*
  * SHA-1 process buffer
  */
@@ -249,6 +275,13 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 		left = 0;
 	}
 
+#if defined(CONFIG_SHA_ARMV8_CE) && !defined(USE_HOSTCC)
+	if (ilen >= 64 && !sha1_process_ce(ctx, input, ilen / 64)) {
+		input += ilen & ~63;
+		ilen &= 63;
+	}
+#endif
+
 	while (ilen >= 64) {
 		sha1_process (ctx, input);
 		input += 64;
@@ -14,6 +14,9 @@
 #endif /* USE_HOSTCC */
 #include <watchdog.h>
 #include <u-boot/sha256.h>
+#if defined(CONFIG_SHA_ARMV8_CE) && !defined(USE_HOSTCC)
+#include <u-boot/sha_ce.h>
+#endif
 
 const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 	0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
@@ -211,6 +214,13 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 		left = 0;
 	}
 
+#if defined(CONFIG_SHA_ARMV8_CE) && !defined(USE_HOSTCC)
+	if (length >= 64 && !sha256_ce_blocks(ctx->state, input, length / 64)) {
+		input += length & ~63;
+		length &= 63;
+	}
+#endif
+
 	while (length >= 64) {
 		sha256_process(ctx, input);
 		length -= 64;
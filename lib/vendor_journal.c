@@ -0,0 +1,114 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <vendor_journal.h>
+#include <u-boot/crc.h>
+
+#define VENDOR_JOURNAL_TAG	0x4A564B52	/* "RKVJ" */
+
+struct vendor_journal_rec {
+	u32 tag;
+	u32 version;
+	u16 seq;
+	u16 id;
+	u16 size;
+	u16 reserved;
+	u32 crc;	/* crc32 of the record with crc = 0, then the data */
+};
+
+static u32 vendor_journal_rec_blks(u16 size)
+{
+	return DIV_ROUND_UP(sizeof(struct vendor_journal_rec) + size,
+			    VENDOR_JOURNAL_BLK_SIZE);
+}
+
+static u32 vendor_journal_rec_crc(const struct vendor_journal_rec *rec)
+{
+	struct vendor_journal_rec hdr = *rec;
+
+	hdr.crc = 0;
+
+	return crc32(crc32(0, (const uchar *)&hdr, sizeof(hdr)),
+		     (const uchar *)(rec + 1), rec->size);
+}
+
+void vendor_journal_reset(struct vendor_journal *vj, u32 version, u32 blks)
+{
+	vj->version = version;
+	vj->blks = blks;
+	vj->used = 0;
+	vj->seq = 0;
+}
+
+int vendor_journal_replay(struct vendor_journal *vj, const void *buf,
+			  u32 version, u32 blks,
+			  int (*apply)(void *ctx, u16 id, const void *data,
+				       u16 size),
+			  void *ctx)
+{
+	const struct vendor_journal_rec *rec;
+	u32 cnt;
+	int num = 0;
+
+	vendor_journal_reset(vj, version, blks);
+
+	while (vj->used < vj->blks) {
+		rec = buf + vj->used * VENDOR_JOURNAL_BLK_SIZE;
+		if (rec->tag != VENDOR_JOURNAL_TAG ||
+		    rec->version != vj->version || rec->seq != vj->seq)
+			break;
+		cnt = vendor_journal_rec_blks(rec->size);
+		if (vj->used + cnt > vj->blks ||
+		    vendor_journal_rec_crc(rec) != rec->crc)
+			break;
+		if (apply(ctx, rec->id, rec + 1, rec->size))
+			break;
+
+		vj->used += cnt;
+		vj->seq++;
+		num++;
+	}
+	debug("%s: %d records, %u/%u blocks\n", __func__, num, vj->used,
+	      vj->blks);
+
+	return num;
+}
+
+int vendor_journal_append(struct vendor_journal *vj, u16 id,
+			  const void *data, u16 size)
+{
+	struct vendor_journal_rec *rec;
+	u32 cnt = vendor_journal_rec_blks(size);
+	int ret;
+
+	if (vj->used + cnt > vj->blks)
+		return -ENOSPC;
+
+	rec = malloc_cache_aligned(cnt * VENDOR_JOURNAL_BLK_SIZE);
+	if (!rec)
+		return -ENOMEM;
+	memset(rec, 0, cnt * VENDOR_JOURNAL_BLK_SIZE);
+	rec->tag = VENDOR_JOURNAL_TAG;
+	rec->version = vj->version;
+	rec->seq = vj->seq;
+	rec->id = id;
+	rec->size = size;
+	memcpy(rec + 1, data, size);
+	rec->crc = vendor_journal_rec_crc(rec);
+
+	ret = vj->write(vj, vj->used, cnt, rec);
+	free(rec);
+	if (ret)
+		return ret;
+
+	vj->used += cnt;
+	vj->seq++;
+
+	return 0;
+}
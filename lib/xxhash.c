@@ -0,0 +1,289 @@
+/*
+ * xxHash - Extremely Fast Hash algorithm
+ * Copyright (C) 2012-2016, Yann Collet.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+ BSD-2-Clause
+ *
+ * You can contact the author at:
+ * - xxHash homepage: http://cyan4973.github.io/xxHash/
+ * - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include <common.h>
+#include <asm/unaligned.h>
+#include <linux/xxhash.h>
+
+#define PRIME32_1	2654435761U
+#define PRIME32_2	2246822519U
+#define PRIME32_3	3266489917U
+#define PRIME32_4	668265263U
+#define PRIME32_5	374761393U
+
+#define PRIME64_1	11400714785074694791ULL
+#define PRIME64_2	14029467366897019727ULL
+#define PRIME64_3	1609587929392839161ULL
+#define PRIME64_4	9650029242287828579ULL
+#define PRIME64_5	2870177450012600261ULL
+
+#define xxh_rotl32(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+#define xxh_rotl64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint32_t xxh32_round(uint32_t acc, const uint32_t input)
+{
+	acc += input * PRIME32_2;
+	acc = xxh_rotl32(acc, 13);
+	acc *= PRIME32_1;
+
+	return acc;
+}
+
+uint32_t xxh32(const void *input, size_t len, uint32_t seed)
+{
+	struct xxh32_state state;
+
+	xxh32_reset(&state, seed);
+	xxh32_update(&state, input, len);
+
+	return xxh32_digest(&state);
+}
+
+void xxh32_reset(struct xxh32_state *state, uint32_t seed)
+{
+	memset(state, 0, sizeof(*state));
+	state->v1 = seed + PRIME32_1 + PRIME32_2;
+	state->v2 = seed + PRIME32_2;
+	state->v3 = seed + 0;
+	state->v4 = seed - PRIME32_1;
+}
+
+/* Hash whole 16-byte stripes, returns the number of bytes used */
+static size_t xxh32_stripes(struct xxh32_state *state, const uint8_t *p,
+			    size_t len)
+{
+	const uint8_t *start = p;
+	uint32_t v1 = state->v1;
+	uint32_t v2 = state->v2;
+	uint32_t v3 = state->v3;
+	uint32_t v4 = state->v4;
+
+	while (len >= 16) {
+		v1 = xxh32_round(v1, get_unaligned_le32(p));
+		v2 = xxh32_round(v2, get_unaligned_le32(p + 4));
+		v3 = xxh32_round(v3, get_unaligned_le32(p + 8));
+		v4 = xxh32_round(v4, get_unaligned_le32(p + 12));
+		p += 16;
+		len -= 16;
+	}
+	state->v1 = v1;
+	state->v2 = v2;
+	state->v3 = v3;
+	state->v4 = v4;
+
+	return p - start;
+}
+
+void xxh32_update(struct xxh32_state *state, const void *input, size_t len)
+{
+	const uint8_t *p = input;
+	uint8_t *mem = (uint8_t *)state->mem32;
+	size_t n;
+
+	state->total_len += len;
+	state->large_len |= len >= 16 || state->total_len >= 16;
+
+	if (state->memsize) {
+		n = min_t(size_t, len, 16 - state->memsize);
+		memcpy(mem + state->memsize, p, n);
+		state->memsize += n;
+		p += n;
+		len -= n;
+		if (state->memsize < 16)
+			return;
+		xxh32_stripes(state, mem, 16);
+		state->memsize = 0;
+	}
+
+	n = xxh32_stripes(state, p, len);
+	p += n;
+	len -= n;
+	if (len) {
+		memcpy(mem, p, len);
+		state->memsize = len;
+	}
+}
+
+uint32_t xxh32_digest(const struct xxh32_state *state)
+{
+	const uint8_t *p = (const uint8_t *)state->mem32;
+	const uint8_t *end = p + state->memsize;
+	uint32_t h;
+
+	if (state->large_len) {
+		h = xxh_rotl32(state->v1, 1) + xxh_rotl32(state->v2, 7) +
+		    xxh_rotl32(state->v3, 12) + xxh_rotl32(state->v4, 18);
+	} else {
+		h = state->v3 + PRIME32_5;
+	}
+	h += state->total_len;
+
+	while (p + 4 <= end) {
+		h += get_unaligned_le32(p) * PRIME32_3;
+		h = xxh_rotl32(h, 17) * PRIME32_4;
+		p += 4;
+	}
+	while (p < end) {
+		h += *p * PRIME32_5;
+		h = xxh_rotl32(h, 11) * PRIME32_1;
+		p++;
+	}
+
+	h ^= h >> 15;
+	h *= PRIME32_2;
+	h ^= h >> 13;
+	h *= PRIME32_3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static uint64_t xxh64_round(uint64_t acc, const uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = xxh_rotl64(acc, 31);
+	acc *= PRIME64_1;
+
+	return acc;
+}
+
+static uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+	val = xxh64_round(0, val);
+	acc ^= val;
+	acc = acc * PRIME64_1 + PRIME64_4;
+
+	return acc;
+}
+
+/* Hash the tail of the input, less than 32 bytes, into @h */
+static uint64_t xxh64_finish(uint64_t h, const uint8_t *p, size_t len)
+{
+	const uint8_t *end = p + len;
+
+	while (p + 8 <= end) {
+		h ^= xxh64_round(0, get_unaligned_le64(p));
+		h = xxh_rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end) {
+		h ^= (uint64_t)get_unaligned_le32(p) * PRIME64_1;
+		h = xxh_rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	while (p < end) {
+		h ^= *p * PRIME64_5;
+		h = xxh_rotl64(h, 11) * PRIME64_1;
+		p++;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+uint64_t xxh64(const void *input, size_t len, uint64_t seed)
+{
+	struct xxh64_state state;
+
+	xxh64_reset(&state, seed);
+	xxh64_update(&state, input, len);
+
+	return xxh64_digest(&state);
+}
+
+void xxh64_reset(struct xxh64_state *state, uint64_t seed)
+{
+	memset(state, 0, sizeof(*state));
+	state->v1 = seed + PRIME64_1 + PRIME64_2;
+	state->v2 = seed + PRIME64_2;
+	state->v3 = seed + 0;
+	state->v4 = seed - PRIME64_1;
+}
+
+/* Hash whole 32-byte stripes, returns the number of bytes used */
+static size_t xxh64_stripes(struct xxh64_state *state, const uint8_t *p,
+			    size_t len)
+{
+	const uint8_t *start = p;
+	uint64_t v1 = state->v1;
+	uint64_t v2 = state->v2;
+	uint64_t v3 = state->v3;
+	uint64_t v4 = state->v4;
+
+	while (len >= 32) {
+		v1 = xxh64_round(v1, get_unaligned_le64(p));
+		v2 = xxh64_round(v2, get_unaligned_le64(p + 8));
+		v3 = xxh64_round(v3, get_unaligned_le64(p + 16));
+		v4 = xxh64_round(v4, get_unaligned_le64(p + 24));
+		p += 32;
+		len -= 32;
+	}
+	state->v1 = v1;
+	state->v2 = v2;
+	state->v3 = v3;
+	state->v4 = v4;
+
+	return p - start;
+}
+
+void xxh64_update(struct xxh64_state *state, const void *input, size_t len)
+{
+	const uint8_t *p = input;
+	uint8_t *mem = (uint8_t *)state->mem64;
+	size_t n;
+
+	state->total_len += len;
+
+	if (state->memsize) {
+		n = min_t(size_t, len, 32 - state->memsize);
+		memcpy(mem + state->memsize, p, n);
+		state->memsize += n;
+		p += n;
+		len -= n;
+		if (state->memsize < 32)
+			return;
+		xxh64_stripes(state, mem, 32);
+		state->memsize = 0;
+	}
+
+	n = xxh64_stripes(state, p, len);
+	p += n;
+	len -= n;
+	if (len) {
+		memcpy(mem, p, len);
+		state->memsize = len;
+	}
+}
+
+uint64_t xxh64_digest(const struct xxh64_state *state)
+{
+	uint64_t h;
+
+	if (state->total_len >= 32) {
+		h = xxh_rotl64(state->v1, 1) + xxh_rotl64(state->v2, 7) +
+		    xxh_rotl64(state->v3, 12) + xxh_rotl64(state->v4, 18);
+		h = xxh64_merge_round(h, state->v1);
+		h = xxh64_merge_round(h, state->v2);
+		h = xxh64_merge_round(h, state->v3);
+		h = xxh64_merge_round(h, state->v4);
+	} else {
+		h = state->v3 + PRIME64_5;
+	}
+	h += state->total_len;
+
+	return xxh64_finish(h, (const uint8_t *)state->mem64,
+			    state->memsize);
+}
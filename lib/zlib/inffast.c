@@ -66,6 +66,241 @@
       requires strm->avail_out >= 258 for each loop to avoid checking for
       output space.
  */
+#ifdef CONFIG_ZLIB_INFLATE_FAST64
+int zlib_inflate_reference;
+
+/*
+   Copy a match of len bytes from dist bytes back in the output.  The
+   source may overlap the destination, so words are only used when they
+   cannot read bytes that are not written yet.  Up to seven bytes past the
+   match may be written, which inflate_fast64() leaves room for.
+ */
+local unsigned char FAR *inflate_copy64(unsigned char FAR *out,
+                                        const unsigned char FAR *from,
+                                        unsigned len, unsigned dist)
+{
+    unsigned char FAR *end = out + len;
+
+    if (dist >= 8) {
+        do {
+            put_unaligned(get_unaligned((u64 *)from), (u64 *)out);
+            out += 8;
+            from += 8;
+        } while (out < end);
+    }
+    else if (dist == 1)
+        memset(out, *from, len);
+    else {
+        do {
+            *out++ = *from++;
+        } while (out < end);
+    }
+    return end;
+}
+
+/*
+   Variant of inflate_fast() for machines with 64-bit registers.
+
+   The bit buffer is refilled with a single 64-bit load, which leaves at
+   least 56 bits in it: enough for a whole length/distance pair, so there is
+   one refill per loop instead of one per code.  Only the bytes wholly taken
+   into the buffer are consumed; the partial byte above them is loaded again
+   by the next refill, which ORs in the same bits.  Runs of literals are
+   decoded from one refill, and matches are copied eight bytes at a time
+   where the distance allows.
+
+   Entry assumptions are those of inflate_fast(), with strm->avail_in >= 8
+   since each refill reads eight bytes, and strm->avail_out >= 265 for the
+   bytes that inflate_copy64() may write past a match.
+ */
+local void inflate_fast64(z_streamp strm, unsigned start)
+{
+    struct inflate_state FAR *state;
+    unsigned char FAR *in;      /* local strm->next_in */
+    unsigned char FAR *last;    /* while in <= last, a refill can be done */
+    unsigned char FAR *out;     /* local strm->next_out */
+    unsigned char FAR *beg;     /* inflate()'s initial strm->next_out */
+    unsigned char FAR *end;     /* while out < end, enough space available */
+#ifdef INFLATE_STRICT
+    unsigned dmax;              /* maximum distance from zlib header */
+#endif
+    unsigned wsize;             /* window size or zero if not using window */
+    unsigned whave;             /* valid bytes in the window */
+    unsigned write;             /* window write index */
+    unsigned char FAR *window;  /* allocated sliding window, if wsize != 0 */
+    u64 hold;                   /* local strm->hold */
+    unsigned bits;              /* local strm->bits */
+    code const FAR *lcode;      /* local strm->lencode */
+    code const FAR *dcode;      /* local strm->distcode */
+    unsigned lbits;             /* bits in first level of length codes */
+    unsigned lmask;             /* mask for first level of length codes */
+    unsigned dmask;             /* mask for first level of distance codes */
+    code this;                  /* retrieved table entry */
+    unsigned op;                /* code bits, operation, extra bits, or */
+                                /*  window position, window bytes to copy */
+    unsigned len;               /* match length, unused bytes */
+    unsigned dist;              /* match distance */
+    unsigned char FAR *from;    /* where to copy match from */
+
+    /* copy state to local variables */
+    state = (struct inflate_state FAR *)strm->state;
+    in = strm->next_in;
+    last = in + (strm->avail_in - 8);
+    out = strm->next_out;
+    beg = out - (start - strm->avail_out);
+    end = out + (strm->avail_out - 264);
+#ifdef INFLATE_STRICT
+    dmax = state->dmax;
+#endif
+    wsize = state->wsize;
+    whave = state->whave;
+    write = state->write;
+    window = state->window;
+    hold = state->hold;
+    bits = state->bits;
+    lcode = state->lencode;
+    dcode = state->distcode;
+    lbits = state->lenbits;
+    lmask = (1U << lbits) - 1;
+    dmask = (1U << state->distbits) - 1;
+
+    /* decode literals and length/distances until end-of-block or not enough
+       input data or output space */
+    do {
+        hold |= get_unaligned_le64(in) << bits;
+        in += (63 - bits) >> 3;
+        bits |= 56;
+        this = lcode[hold & lmask];
+        if (this.op == 0) {
+            /* first-level literals need at most lbits each; out < end
+               leaves room for all that one refill can hold */
+            do {
+                Tracevv((stderr, this.val >= 0x20 && this.val < 0x7f ?
+                        "inflate:         literal '%c'\n" :
+                        "inflate:         literal 0x%02x\n", this.val));
+                *out++ = (unsigned char)(this.val);
+                hold >>= this.bits;
+                bits -= this.bits;
+                this = lcode[hold & lmask];
+            } while (this.op == 0 && bits >= lbits);
+            continue;
+        }
+      dolen:
+        op = (unsigned)(this.bits);
+        hold >>= op;
+        bits -= op;
+        op = (unsigned)(this.op);
+        if (op == 0) {                          /* literal */
+            Tracevv((stderr, this.val >= 0x20 && this.val < 0x7f ?
+                    "inflate:         literal '%c'\n" :
+                    "inflate:         literal 0x%02x\n", this.val));
+            *out++ = (unsigned char)(this.val);
+        }
+        else if (op & 16) {                     /* length base */
+            len = (unsigned)(this.val);
+            op &= 15;                           /* number of extra bits */
+            len += (unsigned)hold & ((1U << op) - 1);
+            hold >>= op;
+            bits -= op;
+            Tracevv((stderr, "inflate:         length %u\n", len));
+            this = dcode[hold & dmask];
+          dodist:
+            op = (unsigned)(this.bits);
+            hold >>= op;
+            bits -= op;
+            op = (unsigned)(this.op);
+            if (op & 16) {                      /* distance base */
+                dist = (unsigned)(this.val);
+                op &= 15;                       /* number of extra bits */
+                dist += (unsigned)hold & ((1U << op) - 1);
+#ifdef INFLATE_STRICT
+                if (dist > dmax) {
+                    strm->msg = (char *)"invalid distance too far back";
+                    state->mode = BAD;
+                    break;
+                }
+#endif
+                hold >>= op;
+                bits -= op;
+                Tracevv((stderr, "inflate:         distance %u\n", dist));
+                op = (unsigned)(out - beg);     /* max distance in output */
+                if (dist > op) {                /* see if copy from window */
+                    op = dist - op;             /* distance back in window */
+                    if (op > whave) {
+                        strm->msg = (char *)"invalid distance too far back";
+                        state->mode = BAD;
+                        break;
+                    }
+                    from = window;
+                    if (write == 0)             /* very common case */
+                        from += wsize - op;
+                    else if (write < op) {      /* wrap around window */
+                        from += wsize + write - op;
+                        op -= write;
+                        if (op < len) {         /* some from end of window */
+                            len -= op;
+                            memcpy(out, from, op);
+                            out += op;
+                            from = window;      /* then from start */
+                            op = write;
+                        }
+                    }
+                    else                        /* contiguous in window */
+                        from += write - op;
+                    /* no words here, to not read past the window */
+                    op = min(op, len);
+                    memcpy(out, from, op);
+                    out += op;
+                    len -= op;
+                    if (len)                    /* rest from output */
+                        out = inflate_copy64(out, out - dist, len, dist);
+                }
+                else {
+                    out = inflate_copy64(out, out - dist, len, dist);
+                }
+            }
+            else if ((op & 64) == 0) {          /* 2nd level distance code */
+                this = dcode[this.val + (hold & ((1U << op) - 1))];
+                goto dodist;
+            }
+            else {
+                strm->msg = (char *)"invalid distance code";
+                state->mode = BAD;
+                break;
+            }
+        }
+        else if ((op & 64) == 0) {              /* 2nd level length code */
+            this = lcode[this.val + (hold & ((1U << op) - 1))];
+            goto dolen;
+        }
+        else if (op & 32) {                     /* end-of-block */
+            Tracevv((stderr, "inflate:         end of block\n"));
+            state->mode = TYPE;
+            break;
+        }
+        else {
+            strm->msg = (char *)"invalid literal/length code";
+            state->mode = BAD;
+            break;
+        }
+    } while (in <= last && out < end);
+
+    /* return unused bytes, dropping the bits loaded above them */
+    len = bits >> 3;
+    in -= len;
+    bits -= len << 3;
+    hold &= (1ULL << bits) - 1;
+
+    /* update state and return */
+    strm->next_in = in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(8 + (last - in));
+    strm->avail_out = (unsigned)(264 + (end - out));
+    state->hold = hold;
+    state->bits = bits;
+}
+#endif /* CONFIG_ZLIB_INFLATE_FAST64 */
+
 void inflate_fast(z_streamp strm, unsigned start)
 /* start: inflate()'s starting value for strm->avail_out */
 {
@@ -95,6 +330,14 @@ void inflate_fast(z_streamp strm, unsigned start)
     unsigned dist;              /* match distance */
     unsigned char FAR *from;    /* where to copy match from */
 
+#ifdef CONFIG_ZLIB_INFLATE_FAST64
+    if (!zlib_inflate_reference && strm->avail_in >= 8 &&
+        strm->avail_out >= 265) {
+        inflate_fast64(strm, start);
+        return;
+    }
+#endif
+
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
@@ -0,0 +1,1116 @@
+/*
+ * (C) Copyright 2017 Rockchip Electronics Co., Ltd
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/*
+ * Zstandard decompression, following the format description in RFC 8878.
+ *
+ * This is a small decoder written for boot images rather than a port of
+ * the reference library: it keeps no state besides the entropy tables of
+ * the current frame and a buffer for the literals of one block, about
+ * 140KB in all, and needs no working memory for the window since matches
+ * are copied from the output itself. Dictionaries are not supported.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <console.h>
+#include <div64.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <watchdog.h>
+#include <asm/unaligned.h>
+#include <linux/xxhash.h>
+#include <u-boot/zstd.h>
+
+#define ZSTD_MAGIC		0xFD2FB528
+#define ZSTD_SKIP_MAGIC		0x184D2A50
+#define ZSTD_SKIP_MASK		0xFFFFFFF0
+
+#define ZSTD_BLOCK_MAX		(128 * 1024)
+#define ZSTD_HUF_LOG_MAX	11
+#define ZSTD_HUF_SYMS		256
+#define ZSTD_FSE_LOG_MAX	9
+#define ZSTD_FSE_SYMS		64
+
+#define ZSTD_LL_LOG_MAX		9
+#define ZSTD_OF_LOG_MAX		8
+#define ZSTD_ML_LOG_MAX		9
+#define ZSTD_LL_MAX		35
+#define ZSTD_OF_MAX		31
+#define ZSTD_ML_MAX		52
+
+enum {
+	ZSTD_BLOCK_RAW,
+	ZSTD_BLOCK_RLE,
+	ZSTD_BLOCK_COMPRESSED,
+};
+
+enum {
+	ZSTD_LIT_RAW,
+	ZSTD_LIT_RLE,
+	ZSTD_LIT_COMPRESSED,
+	ZSTD_LIT_TREELESS,
+};
+
+enum {
+	ZSTD_MODE_PREDEFINED,
+	ZSTD_MODE_RLE,
+	ZSTD_MODE_FSE,
+	ZSTD_MODE_REPEAT,
+};
+
+struct zstd_fse {
+	u8 sym[1 << ZSTD_FSE_LOG_MAX];
+	u8 bits[1 << ZSTD_FSE_LOG_MAX];
+	u16 base[1 << ZSTD_FSE_LOG_MAX];
+	int log;		/* -1 if there is no table */
+};
+
+struct zstd_huf {
+	u8 sym;
+	u8 bits;
+};
+
+struct zstd_dctx {
+	/* Current frame */
+	u64 window;
+	u64 content_size;
+	u64 out;		/* bytes of the frame decompressed so far */
+	bool has_size;
+	bool checksum;
+	u32 rep[3];		/* repeat offsets */
+	struct xxh64_state xxh;
+	u32 frame_csum;		/* checksum stored at the end of the frame */
+	u32 csum;		/* low 32 bits of the xxh64 of its output */
+
+	/* Entropy tables, kept from block to block within a frame */
+	struct zstd_huf huf[1 << ZSTD_HUF_LOG_MAX];
+	int huf_log;		/* 0 if there is no table */
+	struct zstd_fse ll;
+	struct zstd_fse of;
+	struct zstd_fse ml;
+	struct zstd_fse tmp;	/* for Huffman weights */
+
+	/* Literals of the current block */
+	const u8 *lit;
+	size_t lit_len;
+	u8 lit_buf[ZSTD_BLOCK_MAX];
+};
+
+/* Default distributions, for the predefined mode */
+static const s16 zstd_ll_norm[ZSTD_LL_MAX + 1] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1,
+};
+
+static const s16 zstd_of_norm[29] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1,
+};
+
+static const s16 zstd_ml_norm[ZSTD_ML_MAX + 1] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1,
+};
+
+/* Literal and match length codes: baseline and number of extra bits */
+static const u32 zstd_ll_base[ZSTD_LL_MAX + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048,
+	4096, 8192, 16384, 32768, 65536,
+};
+
+static const u8 zstd_ll_bits[ZSTD_LL_MAX + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+	13, 14, 15, 16,
+};
+
+static const u32 zstd_ml_base[ZSTD_ML_MAX + 1] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027,
+	2051, 4099, 8195, 16387, 32771, 65539,
+};
+
+static const u8 zstd_ml_bits[ZSTD_ML_MAX + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16,
+};
+
+/* Get 57 or more bits starting at bit @bit of @buf, zeroes past the end */
+static inline u64 zstd_load(const u8 *buf, size_t len, size_t bit)
+{
+	size_t i = bit >> 3;
+	u64 v = 0;
+	size_t n;
+
+	if (i >= len)
+		return 0;
+	if (i + 8 <= len) {
+		v = get_unaligned_le64(buf + i);
+	} else {
+		for (n = len - i; n--; )
+			v = v << 8 | buf[i + n];
+	}
+
+	return v >> (bit & 7);
+}
+
+/*
+ * Entropy coded streams are read backwards: from the last byte, whose top
+ * set bit marks the end, down to bit 0 of the first. Reading past the start
+ * gives zero bits, and leaves @pos negative.
+ */
+struct zstd_bits {
+	const u8 *buf;
+	size_t len;
+	long pos;		/* bits left */
+};
+
+static int zstd_bits_init(struct zstd_bits *b, const u8 *src, size_t len)
+{
+	if (!len || !src[len - 1])
+		return -EINVAL;
+	b->buf = src;
+	b->len = len;
+	b->pos = (len - 1) * 8 + fls(src[len - 1]) - 1;
+
+	return 0;
+}
+
+static inline u32 zstd_bits_peek(const struct zstd_bits *b, uint n)
+{
+	long start = b->pos - n;
+
+	if (!n || start <= -(long)n)
+		return 0;
+	if (start >= 0)
+		return zstd_load(b->buf, b->len, start) & ((1ULL << n) - 1);
+
+	return (zstd_load(b->buf, b->len, 0) & ((1ULL << (n + start)) - 1)) <<
+		-start;
+}
+
+static inline u32 zstd_bits_read(struct zstd_bits *b, uint n)
+{
+	u32 v = zstd_bits_peek(b, n);
+
+	b->pos -= n;
+
+	return v;
+}
+
+static void zstd_fse_rle(struct zstd_fse *t, u8 sym)
+{
+	t->sym[0] = sym;
+	t->bits[0] = 0;
+	t->base[0] = 0;
+	t->log = 0;
+}
+
+/* Build the decoding table for a normalised distribution */
+static int zstd_fse_build(struct zstd_fse *t, const s16 *norm, int nsym,
+			  int log)
+{
+	u16 next[ZSTD_FSE_SYMS];
+	int size = 1 << log;
+	int mask = size - 1;
+	int step = (size >> 1) + (size >> 3) + 3;
+	int high = size - 1;
+	int pos = 0;
+	int s, i;
+	u16 x;
+
+	/* Symbols with a "less than 1" probability go at the end */
+	for (s = 0; s < nsym; s++) {
+		if (norm[s] == -1) {
+			if (high < 0)
+				return -EINVAL;
+			t->sym[high--] = s;
+			next[s] = 1;
+		} else {
+			next[s] = norm[s];
+		}
+	}
+
+	for (s = 0; s < nsym; s++) {
+		for (i = 0; i < norm[s]; i++) {
+			t->sym[pos] = s;
+			do {
+				pos = (pos + step) & mask;
+			} while (pos > high);
+		}
+	}
+	if (pos)
+		return -EINVAL;
+
+	for (i = 0; i < size; i++) {
+		x = next[t->sym[i]]++;
+		t->bits[i] = log - (fls(x) - 1);
+		t->base[i] = (x << t->bits[i]) - size;
+	}
+	t->log = log;
+
+	return 0;
+}
+
+/* Read an FSE table description, returns the number of bytes used */
+static int zstd_fse_header(struct zstd_fse *t, const u8 *src, size_t len,
+			   int max_log, int max_sym)
+{
+	s16 norm[ZSTD_FSE_SYMS];
+	size_t bit = 4;
+	int remaining, nbits, log, sym = 0;
+	u32 val, lower, threshold, rep;
+	int prob, ret;
+
+	if (!len)
+		return -EINVAL;
+	log = (src[0] & 15) + 5;
+	if (log > max_log)
+		return -EINVAL;
+
+	remaining = 1 << log;
+	while (remaining > 0 && sym <= max_sym) {
+		nbits = fls(remaining + 1);
+		val = zstd_load(src, len, bit) & ((1 << nbits) - 1);
+		bit += nbits;
+		lower = (1 << (nbits - 1)) - 1;
+		threshold = (1 << nbits) - 1 - (remaining + 1);
+		if ((val & lower) < threshold) {
+			bit--;
+			val &= lower;
+		} else if (val > lower) {
+			val -= threshold;
+		}
+
+		prob = (int)val - 1;
+		remaining -= prob < 0 ? -prob : prob;
+		norm[sym++] = prob;
+		if (prob)
+			continue;
+
+		/* Runs of zero probabilities, two bits at a time */
+		do {
+			rep = zstd_load(src, len, bit) & 3;
+			bit += 2;
+			if (sym + rep > max_sym + 1)
+				return -EINVAL;
+			memset(&norm[sym], 0, rep * sizeof(*norm));
+			sym += rep;
+		} while (rep == 3);
+	}
+	if (remaining || bit > len * 8)
+		return -EINVAL;
+
+	ret = zstd_fse_build(t, norm, sym, log);
+	if (ret)
+		return ret;
+
+	return DIV_ROUND_UP(bit, 8);
+}
+
+/* Read the FSE compressed weights of a Huffman tree, returns their number */
+static int zstd_huf_weights(struct zstd_dctx *dc, const u8 *src, size_t len,
+			    u8 *w)
+{
+	struct zstd_fse *t = &dc->tmp;
+	struct zstd_bits b;
+	u32 s1, s2;
+	int n = 0;
+	int ret;
+
+	ret = zstd_fse_header(t, src, len, 6, ZSTD_HUF_LOG_MAX);
+	if (ret < 0)
+		return ret;
+	if (zstd_bits_init(&b, src + ret, len - ret))
+		return -EINVAL;
+
+	/* Two interleaved states, until the stream is used up */
+	s1 = zstd_bits_read(&b, t->log);
+	s2 = zstd_bits_read(&b, t->log);
+	for (;;) {
+		if (n > ZSTD_HUF_SYMS - 3)
+			return -EINVAL;
+		w[n++] = t->sym[s1];
+		s1 = t->base[s1] + zstd_bits_read(&b, t->bits[s1]);
+		if (b.pos < 0) {
+			w[n++] = t->sym[s2];
+			break;
+		}
+		w[n++] = t->sym[s2];
+		s2 = t->base[s2] + zstd_bits_read(&b, t->bits[s2]);
+		if (b.pos < 0) {
+			w[n++] = t->sym[s1];
+			break;
+		}
+	}
+
+	return n;
+}
+
+/* Build the Huffman decoding table from the weights of all but one symbol */
+static int zstd_huf_build(struct zstd_dctx *dc, u8 *w, int n)
+{
+	u32 start[ZSTD_HUF_LOG_MAX + 1];
+	u32 count[ZSTD_HUF_LOG_MAX + 1] = { 0 };
+	u32 sum = 0, left, pos, i, j;
+	int log;
+
+	for (i = 0; i < n; i++) {
+		if (w[i] > ZSTD_HUF_LOG_MAX)
+			return -EINVAL;
+		if (w[i])
+			sum += 1 << (w[i] - 1);
+	}
+	if (!sum)
+		return -EINVAL;
+	log = fls(sum);
+	if (log > ZSTD_HUF_LOG_MAX)
+		return -EINVAL;
+
+	/* The last weight brings the total to a power of two */
+	left = (1 << log) - sum;
+	if (left & (left - 1))
+		return -EINVAL;
+	w[n++] = fls(left);
+
+	for (i = 0; i < n; i++)
+		count[w[i]]++;
+	for (pos = 0, i = 1; i <= log; i++) {
+		start[i] = pos;
+		pos += count[i] << (i - 1);
+	}
+
+	/* Longest codes first, in symbol order */
+	for (i = 0; i < n; i++) {
+		if (!w[i])
+			continue;
+		for (j = 0; j < 1 << (w[i] - 1); j++) {
+			dc->huf[start[w[i]] + j].sym = i;
+			dc->huf[start[w[i]] + j].bits = log + 1 - w[i];
+		}
+		start[w[i]] += j;
+	}
+	dc->huf_log = log;
+
+	return 0;
+}
+
+/* Read a Huffman tree description, returns the number of bytes used */
+static int zstd_huf_table(struct zstd_dctx *dc, const u8 *src, size_t len)
+{
+	u8 w[ZSTD_HUF_SYMS];
+	size_t used;
+	int n, i, ret;
+
+	if (!len)
+		return -EINVAL;
+	if (src[0] >= 128) {
+		/* Weights stored as is, four bits each */
+		n = src[0] - 127;
+		used = 1 + (n + 1) / 2;
+		if (used > len)
+			return -EINVAL;
+		for (i = 0; i < n; i++)
+			w[i] = i & 1 ? src[1 + i / 2] & 15 : src[1 + i / 2] >> 4;
+	} else {
+		used = 1 + src[0];
+		if (used > len)
+			return -EINVAL;
+		n = zstd_huf_weights(dc, src + 1, src[0], w);
+		if (n < 0)
+			return n;
+	}
+
+	ret = zstd_huf_build(dc, w, n);
+	if (ret)
+		return ret;
+
+	return used;
+}
+
+/* Decode one Huffman stream of @len bytes into @n literals at @dst */
+static int zstd_huf_stream(struct zstd_dctx *dc, const u8 *src, size_t len,
+			   u8 *dst, size_t n)
+{
+	const struct zstd_huf *e;
+	struct zstd_bits b;
+	int log = dc->huf_log;
+
+	if (zstd_bits_init(&b, src, len))
+		return -EINVAL;
+	while (n--) {
+		e = &dc->huf[zstd_bits_peek(&b, log)];
+		*dst++ = e->sym;
+		b.pos -= e->bits;
+	}
+
+	return b.pos ? -EINVAL : 0;
+}
+
+static int zstd_huf_streams(struct zstd_dctx *dc, const u8 *src, size_t len,
+			    size_t regen, bool four)
+{
+	u8 *dst = dc->lit_buf;
+	size_t size[4], seg;
+	int i, ret;
+
+	if (!four)
+		return zstd_huf_stream(dc, src, len, dst, regen);
+
+	/* A jump table gives the size of the first three streams */
+	if (len < 6)
+		return -EINVAL;
+	size[0] = get_unaligned_le16(src);
+	size[1] = get_unaligned_le16(src + 2);
+	size[2] = get_unaligned_le16(src + 4);
+	src += 6;
+	len -= 6;
+	if (size[0] + size[1] + size[2] > len)
+		return -EINVAL;
+	size[3] = len - size[0] - size[1] - size[2];
+
+	seg = (regen + 3) / 4;
+	if (3 * seg > regen)
+		return -EINVAL;
+	for (i = 0; i < 4; i++) {
+		ret = zstd_huf_stream(dc, src, size[i], dst,
+				      i < 3 ? seg : regen - 3 * seg);
+		if (ret)
+			return ret;
+		src += size[i];
+		dst += seg;
+	}
+
+	return 0;
+}
+
+/* Read the literals section of a block, returns the number of bytes used */
+static int zstd_literals(struct zstd_dctx *dc, const u8 *src, size_t len)
+{
+	int type, format, ret;
+	size_t hdr, regen, comp;
+	u64 h = 0;
+	int i;
+
+	if (!len)
+		return -EINVAL;
+	type = src[0] & 3;
+	format = (src[0] >> 2) & 3;
+	for (i = min_t(size_t, len, 5) - 1; i >= 0; i--)
+		h = h << 8 | src[i];
+
+	if (type == ZSTD_LIT_RAW || type == ZSTD_LIT_RLE) {
+		switch (format) {
+		case 1:
+			hdr = 2;
+			regen = (h >> 4) & 0xfff;
+			break;
+		case 3:
+			hdr = 3;
+			regen = (h >> 4) & 0xfffff;
+			break;
+		default:
+			hdr = 1;
+			regen = (h >> 3) & 0x1f;
+			break;
+		}
+		if (regen > ZSTD_BLOCK_MAX || hdr >= len)
+			return -EINVAL;
+		dc->lit_len = regen;
+		if (type == ZSTD_LIT_RLE) {
+			memset(dc->lit_buf, src[hdr], regen);
+			dc->lit = dc->lit_buf;
+			return hdr + 1;
+		}
+		if (hdr + regen > len)
+			return -EINVAL;
+		dc->lit = src + hdr;
+		return hdr + regen;
+	}
+
+	switch (format) {
+	case 0:
+	case 1:
+		hdr = 3;
+		regen = (h >> 4) & 0x3ff;
+		comp = (h >> 14) & 0x3ff;
+		break;
+	case 2:
+		hdr = 4;
+		regen = (h >> 4) & 0x3fff;
+		comp = (h >> 18) & 0x3fff;
+		break;
+	default:
+		hdr = 5;
+		regen = (h >> 4) & 0x3ffff;
+		comp = (h >> 22) & 0x3ffff;
+		break;
+	}
+	if (regen > ZSTD_BLOCK_MAX || hdr + comp > len)
+		return -EINVAL;
+
+	src += hdr;
+	len = comp;
+	if (type == ZSTD_LIT_COMPRESSED) {
+		ret = zstd_huf_table(dc, src, len);
+		if (ret < 0)
+			return ret;
+		src += ret;
+		len -= ret;
+	} else if (!dc->huf_log) {
+		return -EINVAL;
+	}
+
+	ret = zstd_huf_streams(dc, src, len, regen, format != 0);
+	if (ret)
+		return ret;
+	dc->lit = dc->lit_buf;
+	dc->lit_len = regen;
+
+	return hdr + comp;
+}
+
+/* Set up the table for one of the sequence codes */
+static int zstd_seq_table(struct zstd_fse *t, int mode, const u8 *src,
+			  size_t len, const s16 *norm, int nnorm, int def_log,
+			  int max_log, int max_sym)
+{
+	int ret;
+
+	switch (mode) {
+	case ZSTD_MODE_PREDEFINED:
+		ret = zstd_fse_build(t, norm, nnorm, def_log);
+		return ret ? ret : 0;
+	case ZSTD_MODE_RLE:
+		if (!len || src[0] > max_sym)
+			return -EINVAL;
+		zstd_fse_rle(t, src[0]);
+		return 1;
+	case ZSTD_MODE_FSE:
+		return zstd_fse_header(t, src, len, max_log, max_sym);
+	default:
+		/* The table of the previous block */
+		return t->log < 0 ? -EINVAL : 0;
+	}
+}
+
+/* Work out the offset of a sequence, updating the repeat offsets */
+static u32 zstd_offset(struct zstd_dctx *dc, u32 val, u32 ll)
+{
+	u32 *rep = dc->rep;
+	u32 off;
+	int idx;
+
+	if (val > 3) {
+		off = val - 3;
+	} else {
+		idx = val - 1 + !ll;
+		if (!idx)
+			return rep[0];
+		off = idx < 3 ? rep[idx] : rep[0] - 1;
+		if (idx == 1) {
+			rep[1] = rep[0];
+			rep[0] = off;
+			return off;
+		}
+	}
+	rep[2] = rep[1];
+	rep[1] = rep[0];
+	rep[0] = off;
+
+	return off;
+}
+
+/*
+ * Read the sequences section of a block and execute the sequences to @out,
+ * returns the number of bytes written.
+ */
+static int zstd_sequences(struct zstd_dctx *dc, const u8 *src, size_t len,
+			  u8 *out, u8 *out_end, const u8 *hist)
+{
+	const u8 *lit = dc->lit;
+	const u8 *lit_end = lit + dc->lit_len;
+	struct zstd_bits b = { 0 };
+	u8 *op = out;
+	u32 ll_s = 0, of_s = 0, ml_s = 0;
+	u32 ll, ml, off, i;
+	u8 ll_c, of_c, ml_c;
+	u32 nseq, seq;
+	size_t p;
+	int ret;
+
+	if (!len)
+		return -EINVAL;
+	if (src[0] < 128) {
+		nseq = src[0];
+		p = 1;
+	} else if (src[0] < 255) {
+		if (len < 2)
+			return -EINVAL;
+		nseq = ((src[0] - 128) << 8) + src[1];
+		p = 2;
+	} else {
+		if (len < 3)
+			return -EINVAL;
+		nseq = src[1] + (src[2] << 8) + 0x7f00;
+		p = 3;
+	}
+
+	if (nseq) {
+		if (p >= len || (src[p] & 3))
+			return -EINVAL;
+		i = src[p++];
+		ret = zstd_seq_table(&dc->ll, i >> 6, src + p, len - p,
+				     zstd_ll_norm, ARRAY_SIZE(zstd_ll_norm), 6,
+				     ZSTD_LL_LOG_MAX, ZSTD_LL_MAX);
+		if (ret < 0)
+			return ret;
+		p += ret;
+		ret = zstd_seq_table(&dc->of, (i >> 4) & 3, src + p, len - p,
+				     zstd_of_norm, ARRAY_SIZE(zstd_of_norm), 5,
+				     ZSTD_OF_LOG_MAX, ZSTD_OF_MAX);
+		if (ret < 0)
+			return ret;
+		p += ret;
+		ret = zstd_seq_table(&dc->ml, (i >> 2) & 3, src + p, len - p,
+				     zstd_ml_norm, ARRAY_SIZE(zstd_ml_norm), 6,
+				     ZSTD_ML_LOG_MAX, ZSTD_ML_MAX);
+		if (ret < 0)
+			return ret;
+		p += ret;
+		if (zstd_bits_init(&b, src + p, len - p))
+			return -EINVAL;
+
+		ll_s = zstd_bits_read(&b, dc->ll.log);
+		of_s = zstd_bits_read(&b, dc->of.log);
+		ml_s = zstd_bits_read(&b, dc->ml.log);
+	}
+
+	for (seq = 1; seq <= nseq; seq++) {
+		ll_c = dc->ll.sym[ll_s];
+		of_c = dc->of.sym[of_s];
+		ml_c = dc->ml.sym[ml_s];
+		off = (1U << of_c) + zstd_bits_read(&b, of_c);
+		ml = zstd_ml_base[ml_c] + zstd_bits_read(&b, zstd_ml_bits[ml_c]);
+		ll = zstd_ll_base[ll_c] + zstd_bits_read(&b, zstd_ll_bits[ll_c]);
+		off = zstd_offset(dc, off, ll);
+		if (seq < nseq) {
+			ll_s = dc->ll.base[ll_s] +
+				zstd_bits_read(&b, dc->ll.bits[ll_s]);
+			ml_s = dc->ml.base[ml_s] +
+				zstd_bits_read(&b, dc->ml.bits[ml_s]);
+			of_s = dc->of.base[of_s] +
+				zstd_bits_read(&b, dc->of.bits[of_s]);
+		}
+
+		if (ll > lit_end - lit)
+			return -EINVAL;
+		if (ll + ml > out_end - op)
+			return -ENOBUFS;
+		memcpy(op, lit, ll);
+		op += ll;
+		lit += ll;
+
+		if (!off || off > op - hist)
+			return -EINVAL;
+		if (off >= ml) {
+			memcpy(op, op - off, ml);
+			op += ml;
+		} else {
+			for (i = 0; i < ml; i++, op++)
+				*op = *(op - off);
+		}
+	}
+	if (b.pos)
+		return -EINVAL;
+
+	ll = lit_end - lit;
+	if (ll > out_end - op)
+		return -ENOBUFS;
+	memcpy(op, lit, ll);
+	op += ll;
+
+	return op - out;
+}
+
+/*
+ * Start the frame at *@srcp, skipping a skippable frame. Returns 1 if a
+ * zstd frame starts, 0 if a skippable frame was skipped.
+ */
+static int zstd_frame_start(struct zstd_dctx *dc, const u8 **srcp,
+			    const u8 *end)
+{
+	static const u8 did_size[4] = { 0, 1, 2, 4 };
+	const u8 *src = *srcp;
+	size_t len = end - src;
+	size_t size, fcs_size, did_len;
+	u32 magic, did = 0;
+	u64 base;
+	u8 fhd;
+	int i;
+
+	if (len < 8)
+		return -EINVAL;
+	magic = get_unaligned_le32(src);
+	if ((magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+		size = get_unaligned_le32(src + 4);
+		if (size > len - 8)
+			return -EINVAL;
+		*srcp = src + 8 + size;
+		return 0;
+	}
+	if (magic != ZSTD_MAGIC)
+		return -EINVAL;
+
+	fhd = src[4];
+	if (fhd & 0x08)
+		return -EINVAL;
+	did_len = did_size[fhd & 3];
+	fcs_size = fhd >> 6 ? 1 << (fhd >> 6) : (fhd & 0x20) ? 1 : 0;
+	size = 5 + !(fhd & 0x20) + did_len + fcs_size;
+	if (size > len)
+		return -EINVAL;
+
+	src += 5;
+	if (!(fhd & 0x20)) {
+		base = 1ULL << (10 + (*src >> 3));
+		dc->window = base + (base >> 3) * (*src & 7);
+		src++;
+	}
+	for (i = did_len - 1; i >= 0; i--)
+		did = did << 8 | src[i];
+	src += did_len;
+	if (did)
+		return -EPROTONOSUPPORT;
+
+	dc->content_size = 0;
+	for (i = fcs_size - 1; i >= 0; i--)
+		dc->content_size = dc->content_size << 8 | src[i];
+	if (fcs_size == 2)
+		dc->content_size += 256;
+	dc->has_size = fcs_size;
+	if (fhd & 0x20)
+		dc->window = dc->content_size;
+
+	dc->checksum = fhd & 0x04;
+	dc->out = 0;
+	dc->rep[0] = 1;
+	dc->rep[1] = 4;
+	dc->rep[2] = 8;
+	dc->huf_log = 0;
+	dc->ll.log = -1;
+	dc->of.log = -1;
+	dc->ml.log = -1;
+	xxh64_reset(&dc->xxh, 0);
+	dc->frame_csum = 0;
+	dc->csum = 0;
+	*srcp += size;
+
+	return 1;
+}
+
+/*
+ * Decompress the next block of the current frame to @out. Matches may
+ * refer back down to @hist. Returns the number of bytes written, and sets
+ * @last once the frame is done.
+ */
+static int zstd_next_block(struct zstd_dctx *dc, const u8 **srcp,
+			   const u8 *end, u8 *out, u8 *out_end,
+			   const u8 *hist, bool *last)
+{
+	const u8 *src = *srcp;
+	size_t size;
+	u32 h;
+	int ret;
+
+	if (end - src < 3)
+		return -EINVAL;
+	h = src[0] | src[1] << 8 | src[2] << 16;
+	size = h >> 3;
+	src += 3;
+	if (size > ZSTD_BLOCK_MAX)
+		return -EINVAL;
+	if (out_end - out > ZSTD_BLOCK_MAX)
+		out_end = out + ZSTD_BLOCK_MAX;
+
+	switch ((h >> 1) & 3) {
+	case ZSTD_BLOCK_RAW:
+		if (size > end - src)
+			return -EINVAL;
+		if (size > out_end - out)
+			return -ENOBUFS;
+		memcpy(out, src, size);
+		src += size;
+		ret = size;
+		break;
+	case ZSTD_BLOCK_RLE:
+		if (src == end)
+			return -EINVAL;
+		if (size > out_end - out)
+			return -ENOBUFS;
+		memset(out, *src++, size);
+		ret = size;
+		break;
+	case ZSTD_BLOCK_COMPRESSED:
+		if (size > end - src)
+			return -EINVAL;
+		ret = zstd_literals(dc, src, size);
+		if (ret < 0)
+			return ret;
+		ret = zstd_sequences(dc, src + ret, size - ret, out, out_end,
+				     hist);
+		if (ret < 0)
+			return ret;
+		src += size;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	dc->out += ret;
+	if (dc->checksum)
+		xxh64_update(&dc->xxh, out, ret);
+
+	*last = h & 1;
+	if (*last) {
+		if (dc->has_size && dc->out != dc->content_size)
+			return -EINVAL;
+		if (dc->checksum) {
+			if (end - src < 4)
+				return -EINVAL;
+			dc->frame_csum = get_unaligned_le32(src);
+			dc->csum = xxh64_digest(&dc->xxh);
+			if (dc->frame_csum != dc->csum)
+				return -EINVAL;
+			src += 4;
+		}
+	}
+	*srcp = src;
+
+	return ret;
+}
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	struct zstd_dctx *dc;
+	const u8 *in = src;
+	const u8 *end = in + srcn;
+	u8 *out = dst;
+	u8 *out_end = out + *dstn;
+	u8 *frame;
+	bool last;
+	int ret = 0;
+
+	dc = malloc(sizeof(*dc));
+	if (!dc)
+		return -ENOMEM;
+
+	while (in < end) {
+		ret = zstd_frame_start(dc, &in, end);
+		if (ret < 0)
+			break;
+		if (!ret)
+			continue;
+
+		frame = out;
+		do {
+			ret = zstd_next_block(dc, &in, end, out, out_end, frame,
+					      &last);
+			if (ret < 0)
+				goto out;
+			out += ret;
+		} while (!last);
+		ret = 0;
+	}
+
+out:
+	*dstn = out - (u8 *)dst;
+	free(dc);
+
+	return ret;
+}
+
+#ifdef CONFIG_CMD_UNZIP
+/*
+ * Output buffer of zstdwrite(): the window of the frame, for matches to
+ * refer to, and room behind it for the next block and for a write buffer
+ * being filled. When the buffer is full, the window is moved back to the
+ * start.
+ */
+struct zstd_wbuf {
+	u8 *buf;
+	size_t size;
+	size_t pos;		/* end of the output */
+	size_t flushed;		/* end of the output written out */
+	u8 *hist;		/* start of the current frame */
+};
+
+static void zstd_wbuf_slide(struct zstd_wbuf *w, u64 window)
+{
+	size_t move;
+
+	move = min_t(size_t, w->pos - window, w->flushed);
+	move = rounddown(move, ARCH_DMA_MINALIGN);
+	memmove(w->buf, w->buf + move, w->pos - move);
+	w->pos -= move;
+	w->flushed -= move;
+	w->hist = (size_t)(w->hist - w->buf) < move ? w->buf : w->hist - move;
+}
+
+int zstdwrite(unsigned char *src, int len, struct blk_desc *dev,
+	      unsigned long szwritebuf, u64 startoffs, u64 szexpected)
+{
+	struct zstd_dctx *dc;
+	struct zstd_wbuf w = { 0 };
+	const u8 *end = src + len;
+	const u8 *in = src;
+	lbaint_t blksperbuf, outblock, n;
+	u64 window, size = 0, total = 0;
+	int iteration = 0;
+	bool last;
+	int r = -1;
+	int ret;
+
+	if (!szwritebuf ||
+	    (szwritebuf % dev->blksz) ||
+	    (szwritebuf < dev->blksz)) {
+		printf("%s: size %lu not a multiple of %lu\n",
+		       __func__, szwritebuf, dev->blksz);
+		return -1;
+	}
+
+	if (startoffs & (dev->blksz-1)) {
+		printf("%s: start offset %llu not a multiple of %lu\n",
+		       __func__, startoffs, dev->blksz);
+		return -1;
+	}
+
+	blksperbuf = szwritebuf / dev->blksz;
+	outblock = lldiv(startoffs, dev->blksz);
+
+	/* Zeroed, so there are no checksums to report before a frame */
+	dc = calloc(1, sizeof(*dc));
+	if (!dc)
+		return -1;
+
+	do {
+		ret = zstd_frame_start(dc, &in, end);
+	} while (!ret);
+	if (ret < 0) {
+		puts("Error: Bad zstd data\n");
+		goto out;
+	}
+
+	/* Later frames must not need a larger window than the first */
+	window = dc->window;
+	if (window > CONFIG_SYS_MALLOC_LEN) {
+		printf("%s: window of %llu bytes is too large\n", __func__,
+		       window);
+		goto out;
+	}
+	/*
+	 * Each frame checks its own size. The first one's is only a lower
+	 * bound of the total, as more frames may follow.
+	 */
+	size = szexpected;
+	if (!size && dc->has_size)
+		size = dc->content_size;
+	if (lldiv(size, dev->blksz) > (dev->lba - outblock)) {
+		printf("%s: uncompressed size %llu exceeds device size\n",
+		       __func__, size);
+		goto out;
+	}
+
+	w.size = window + max_t(size_t, window, szwritebuf) + ZSTD_BLOCK_MAX +
+		 ARCH_DMA_MINALIGN + dev->blksz;
+	w.buf = malloc_cache_aligned(w.size);
+	if (!w.buf) {
+		printf("%s: out of memory\n", __func__);
+		goto out;
+	}
+	w.hist = w.buf;
+
+	gzwrite_progress_init(size);
+
+	for (;;) {
+		if (w.pos + ZSTD_BLOCK_MAX > w.size - dev->blksz)
+			zstd_wbuf_slide(&w, window);
+		ret = zstd_next_block(dc, &in, end, w.buf + w.pos,
+				      w.buf + w.size - dev->blksz, w.hist,
+				      &last);
+		if (ret < 0) {
+			printf("Error: zstd block error %d\n", ret);
+			goto out;
+		}
+		w.pos += ret;
+		total += ret;
+
+		while (w.pos - w.flushed >= szwritebuf) {
+			gzwrite_progress(iteration++, total, size);
+			n = blk_dwrite(dev, outblock, blksperbuf,
+				       w.buf + w.flushed);
+			if (n != blksperbuf)
+				goto out;
+			outblock += n;
+			w.flushed += szwritebuf;
+		}
+		if (ctrlc()) {
+			puts("abort\n");
+			goto out;
+		}
+		WATCHDOG_RESET();
+
+		if (!last)
+			continue;
+		if (in == end)
+			break;
+
+		/* Next frame, if there is more than skippable frames */
+		do {
+			ret = zstd_frame_start(dc, &in, end);
+		} while (!ret && in < end);
+		if (ret < 0) {
+			puts("Error: Bad zstd data\n");
+			goto out;
+		}
+		if (!ret)
+			break;
+		if (dc->window > window) {
+			printf("%s: frame needs a larger window\n", __func__);
+			goto out;
+		}
+		w.hist = w.buf + w.pos;
+	}
+
+	/* Last partial write, padded to whole blocks */
+	n = DIV_ROUND_UP(w.pos - w.flushed, dev->blksz);
+	if (n) {
+		memset(w.buf + w.pos, 0,
+		       n * dev->blksz - (w.pos - w.flushed));
+		if (blk_dwrite(dev, outblock, n, w.buf + w.flushed) != n)
+			goto out;
+	}
+
+	r = szexpected && szexpected != total ? -1 : 0;
+
+out:
+	/* The checksums of the last frame, as far as it got */
+	gzwrite_progress_finish(r, total, max(size, total), dc->frame_csum,
+				dc->csum);
+	free(w.buf);
+	free(dc);
+
+	return r;
+}
+#endif
@@ -9,8 +9,11 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <decomp_stream.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <asm/io.h>
 
 #include <u-boot/zlib.h>
@@ -21,6 +24,7 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <u-boot/zstd.h>
 
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
@@ -117,6 +121,263 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/*
+ * The same in two linked blocks, the second copying from the first, with
+ * block checksums, content size and content checksum
+ */
+static const char lz4_linked_compressed[] =
+	"\x04\x22\x4d\x18\x5c\x40\x5e\x01\x00\x00\x00\x00\x00\x00\x8d\x66"
+	"\x00\x00\x00\xff\x19\x49\x20\x61\x6d\x20\x61\x20\x68\x69\x67\x68"
+	"\x6c\x79\x20\x63\x6f\x6d\x70\x72\x65\x73\x73\x61\x62\x6c\x65\x20"
+	"\x62\x69\x74\x20\x6f\x66\x20\x74\x65\x78\x74\x2e\x0a\x28\x00\x3d"
+	"\xf0\x28\x54\x68\x65\x72\x65\x20\x61\x72\x65\x20\x6d\x61\x6e\x79"
+	"\x20\x6c\x69\x6b\x65\x20\x6d\x65\x2c\x20\x62\x75\x74\x20\x74\x68"
+	"\x69\x73\x20\x6f\x6e\x65\x20\x69\x73\x20\x6d\x69\x6e\x65\x2e\x0a"
+	"\x49\x66\x20\x49\x20\x77\x65\x72\x65\x25\x01\x53\x0a\x9d\x00\x00"
+	"\x00\x10\x20\x2d\x00\xa1\x73\x68\x6f\x72\x74\x65\x72\x2c\x20\x74"
+	"\x45\x00\xf4\x0b\x77\x6f\x75\x6c\x64\x6e\x27\x74\x20\x62\x65\x20"
+	"\x6d\x75\x63\x68\x20\x73\x65\x6e\x73\x65\x20\x69\x6e\x0a\xcf\x00"
+	"\x50\x69\x6e\x67\x20\x6d\x12\x00\x00\x32\x00\xf0\x11\x20\x66\x69"
+	"\x72\x73\x74\x20\x70\x6c\x61\x63\x65\x2e\x20\x41\x74\x20\x6c\x65"
+	"\x61\x73\x74\x20\x77\x69\x74\x68\x20\x6c\x7a\x6f\x2c\x63\x00\xf5"
+	"\x14\x77\x61\x79\x2c\x0a\x77\x68\x69\x63\x68\x20\x61\x70\x70\x65"
+	"\x61\x72\x73\x20\x74\x6f\x20\x62\x65\x68\x61\x76\x65\x20\x70\x6f"
+	"\x6f\x72\x6c\x79\x4e\x00\x30\x61\x63\x65\x27\x01\x01\x95\x00\x01"
+	"\x2d\x01\xb0\x0a\x6d\x65\x73\x73\x61\x67\x65\x73\x2e\x0a\xe9\x3b"
+	"\x18\x88\x00\x00\x00\x00\x9d\x12\x8c\x9d";
+static const unsigned long lz4_linked_compressed_size = 298;
+
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * zstd -19 --target-compressed-block-size=1340 of zstd_test_text(), 4500
+ * bytes: two blocks, the second with treeless 4-stream literals and
+ * repeated FSE tables
+ */
+static const char zstd_blocks[] =
+	"\x28\xb5\x2f\xfd\x64\x94\x10\x8c\x1f\x00\xaa\x43\xb8\x0a\x11\xa0"
+	"\x6f\x60\x4b\x76\xb5\xd7\x5f\x7f\xed\x35\x55\x55\x01\x54\x0f\x03"
+	"\xa5\x00\xa6\x00\xa6\x00\xbe\x56\xa1\xa1\xe3\x68\x04\x3d\x23\xb0"
+	"\x79\x89\x0a\xc6\xed\x3c\x6a\xf0\x8b\x67\x87\x0b\x27\x30\x24\xa5"
+	"\xe8\x21\x88\x73\xe1\xe5\xa9\x68\x1a\x31\x50\x2f\x1f\x87\xe2\x92"
+	"\x58\x86\xa7\x28\xbc\x88\xe8\x26\xba\xe4\x67\x6a\x07\xd2\x5e\xa3"
+	"\x03\x92\x81\x17\xc6\xe9\x9d\x94\xc4\x6d\xf7\xad\x7e\xb6\x54\x4b"
+	"\x55\xda\x19\x21\xa1\x7e\xdf\xe5\xf2\x16\x87\xb3\x8d\x38\x84\x5d"
+	"\x99\x6f\x44\x93\xc7\x75\xcf\x3d\xa9\x26\x3d\x5b\x04\x13\xb3\xad"
+	"\x0a\xc8\x91\xcc\xb3\x4a\xc5\xaa\x11\xe8\xc0\x34\xa5\xa9\x3c\xe7"
+	"\xf5\x9f\x95\x53\x40\x5d\x37\x44\xd1\x7c\x5a\x85\x92\x2b\x42\x3b"
+	"\x85\xab\xcf\xcd\x5b\x62\xbe\x47\xf7\x72\x8e\x5b\x6e\x6b\xf3\x75"
+	"\x58\x81\x1a\x6e\x89\x7a\x0e\x68\xe9\x17\x8f\x9f\xef\x5a\xde\xc2"
+	"\x0e\x57\xe8\xc2\xb7\x46\x0c\xb8\x0e\xb3\xeb\x63\xc3\x30\x22\xa3"
+	"\xe0\x2d\xde\x31\x0f\x2c\x1a\x16\x9d\x9a\xb4\xe7\xe1\x78\x5d\x43"
+	"\xa7\x4d\x7a\x73\xf1\x09\x5d\x31\x6e\x21\x92\xa9\x0a\xab\x47\x71"
+	"\xa6\x27\xbc\x49\x52\xd7\xde\x7f\x22\xac\x19\x91\xa9\xbd\x88\x11"
+	"\x3b\x02\xba\x22\xc5\x98\x9a\xa8\x9d\x97\xce\xfe\x47\x14\x75\x78"
+	"\x59\x5d\x35\xa4\xcf\x4c\xa1\x43\x0d\xad\x96\x6a\x14\x42\xe5\x7c"
+	"\x5f\x3d\xa5\x35\xbc\xbe\x14\x35\xcb\x63\x03\xa7\x78\x1e\xca\xcc"
+	"\x09\x2c\x9a\xbd\xc4\xe9\x70\x46\xc0\x74\x88\x45\xc3\xd4\x55\xae"
+	"\x35\x29\x38\xb3\xcf\xb9\x23\xe4\xa3\x96\x94\x10\x73\x4c\xa1\xe5"
+	"\x9e\x62\xc0\xfb\x1a\x76\xb5\x0d\xd6\xcb\xd0\xf4\xb4\xb0\x70\x55"
+	"\xb4\xc9\x1f\x7d\xe6\x1c\xea\xd3\x61\x52\x6a\xf1\xe4\x94\x33\x2c"
+	"\xd3\x45\x83\x39\xc7\x20\x65\xb8\x5a\xfa\x33\xe3\x6f\x3a\xd9\x3a"
+	"\xf0\x1c\xe2\x21\x7c\x32\xdf\x14\x54\x61\xda\x97\x8b\x30\x13\xad"
+	"\xb8\x62\xad\x89\xc2\x68\x29\x32\x14\x13\x8d\xb9\xb9\x60\x3a\x2c"
+	"\x16\x2e\x16\xaf\x2a\x3c\xd9\x91\x36\x1c\xfc\x66\x60\xbd\xac\x3b"
+	"\xcf\xca\x2b\xca\x65\x04\xde\x8f\x5f\xfd\x89\x6d\x59\x50\xb4\xe6"
+	"\xaf\xe0\x12\xe6\xda\x91\xa5\x9e\xab\xdc\x32\x06\x6b\x4c\x24\xc7"
+	"\xc6\xbc\xd6\x8f\x89\xd5\x31\x97\xcb\x8c\xf5\xd6\x70\x5c\x08\xaa"
+	"\x1a\x57\x3c\x8b\xef\x38\x89\xe8\xa3\xea\xad\x56\xbe\x74\x19\xa3"
+	"\x1c\x4c\x6a\xd9\x45\x70\x71\x2a\x75\x59\x99\x0b\x69\x70\xf1\xbf"
+	"\xc4\x24\xad\x39\x39\xb5\x0c\x38\xd0\xf4\x98\x63\x54\x35\xbc\x66"
+	"\x4a\x0a\xb7\xaf\xe6\x05\x25\x49\xb9\x41\x51\xe3\x49\x1d\x64\x03"
+	"\xca\xc8\xc3\xaf\x93\xee\xf1\x18\x92\x52\x79\xbc\x48\xd4\xaa\x2a"
+	"\xe9\x63\x41\xd2\x43\xa1\xe2\x2b\x5f\x0c\x97\x76\x5a\x1e\xac\x6d"
+	"\x69\xb7\xe4\xf4\x46\xb6\x72\xc9\x09\x4b\x26\xf9\x08\x13\xde\x7a"
+	"\xd0\x11\xf9\x16\x43\x65\xa1\x68\xe4\x5e\xbb\x6d\x7e\x34\x56\xb1"
+	"\x33\xf6\x74\xb8\x56\xae\xe3\x88\x4c\x17\xee\x50\x33\xc6\xb8\xb2"
+	"\x18\x50\xb2\x38\xe8\x22\xcd\x9a\xa3\xec\x51\x9a\xb6\x31\x6f\xc5"
+	"\x56\xe1\x7f\x07\xfd\x5a\x2d\xf9\x92\x9d\x53\x9b\x2b\x7d\x93\x86"
+	"\x13\x54\x93\x26\x67\x72\xc9\x79\x2b\x63\xb0\x35\x8c\x59\xfe\x11"
+	"\x7d\x1e\x61\xa4\xea\x33\x08\x79\x8d\x15\xf9\x05\x80\x8d\xa8\x61"
+	"\x1c\xa7\x10\x43\x08\x19\x23\x42\x22\xb3\x49\xd2\x01\x21\x08\x01"
+	"\x44\x92\xce\x42\xee\x06\x11\x40\x40\xd2\x3c\x49\xa1\x03\xe5\x08"
+	"\x9d\xa6\x2f\x9b\x33\x6f\x42\x91\xd1\x42\x60\x5d\x25\x57\xba\x20"
+	"\x39\x00\x6b\xa1\x0a\x6f\x87\xb0\xe0\xaa\x4b\x6e\x30\x3b\x41\xfe"
+	"\x51\x07\xcd\x5b\xb9\x73\x16\xc1\x69\xac\x62\x01\x4b\x71\xbe\xaf"
+	"\xf9\x6d\x81\x84\x1c\x60\xd5\xc5\x8b\x07\xcf\x7d\x15\x20\xe0\xae"
+	"\x3f\xee\x8a\x3d\xea\x02\xce\x37\xf1\x09\x95\x7b\x35\xf0\x82\xc0"
+	"\xe0\x5b\x4a\x53\x41\x60\x68\x46\xc2\x38\x4c\x6a\x20\xa9\x79\x35"
+	"\x82\x53\xa2\x8d\x22\x35\x04\x85\x32\x00\x6e\x59\xd1\xf5\xd5\x8d"
+	"\xc2\x58\xc6\xcd\xa4\xb5\xb8\x63\xcb\x9a\x6a\xab\xff\x64\xba\xe1"
+	"\x2e\x14\x14\xe5\x40\x31\xa7\xc0\x5e\xfa\xd5\x92\xa2\x00\x61\xba"
+	"\xd9\xab\xdf\xdc\x08\x76\xe9\x09\x7b\x5b\xa2\x62\xeb\x5e\xa9\x78"
+	"\x3f\xcf\xf0\xeb\x4a\x16\xc0\x4a\x44\xe0\xe4\xe2\x86\xc5\x67\xb9"
+	"\x31\xf5\xdf\x76\xd2\x2e\x7d\x83\x60\x4a\x78\x38\x85\xe3\x0a\x30"
+	"\xaf\xab\xf2\x9a\x04\xcf\x68\x2a\x94\x67\xf5\x2d\xa9\x75\x15\x36"
+	"\x4f\x0c\x44\xd8\xb3\xdd\x6b\xc9\x7b\x4f\xe8\xc1\xfe\xda\xd1\xe0"
+	"\x61\xfb\x0b\x96\xe6\xd6\x89\x32\xd6\x0c\xd7\x69\x21\x8d\x28\xd9"
+	"\x11\x5c\xf1\x5e\x01\x8f\x41\xd8\x71\xde\x0d\x8b\x25\xd4\x70\x99"
+	"\xbd\x42\x44\x8e\x67\x07\x2f\xc4\x15\xf3\xf9\x04\xab\x50\xc4\x3e"
+	"\xab\xe1\x7f\x63\x27\x18\x2e\x44\x21\xf3\x03\x5d\x26\x00\xbb\x53"
+	"\xdc\x0c\xcc\x00\xcc\x00\xcc\x00\x2e\xc9\x13\x15\x74\xd7\x1d\x8c"
+	"\xd7\x35\xec\x61\x3b\xf8\xf4\xb9\x94\x06\xe2\xaf\xdc\x79\xa6\x2c"
+	"\x69\xff\xa5\xab\x29\xb2\x19\x7a\x3e\x4b\x54\x7b\x9a\x6c\x65\x78"
+	"\x34\x64\x10\x22\xcb\xbe\x08\xe5\x8b\x1a\x57\xa1\x86\xd2\x92\xc2"
+	"\xa4\xef\xc1\x73\xeb\xb2\xf2\x65\x5b\xa2\x53\xa7\x6d\xb5\x0d\xd3"
+	"\x3a\xeb\xba\x5e\xd1\xce\x35\xa8\x94\xc2\xea\x75\xd6\x85\xa9\xa6"
+	"\xda\x60\xf5\x37\x18\x41\x8f\xe9\x80\x0d\x3f\xaa\xf5\xc0\x2c\x83"
+	"\x4a\x83\x10\x05\x07\xc1\x42\xa9\x50\xe7\xf2\xd9\xb3\xf9\xf7\x48"
+	"\x35\xda\xf6\x0e\xb5\xaf\xbb\xb6\x09\xd4\xbc\x8a\x26\x1d\xe6\x4c"
+	"\x43\xe7\x1a\x9a\xdb\xf0\x5e\x37\xe0\x3b\x2b\x5b\x0e\xc1\xd6\xcb"
+	"\x0a\x6c\x9e\xfd\xaf\xfe\xe6\x8c\xd1\x38\x11\x88\x3c\x81\xec\x82"
+	"\xb8\xdc\x86\x2e\x3b\xf9\x4e\x4d\x3b\xe3\x45\x45\xbf\x9e\x76\xad"
+	"\x4d\xbb\x28\x6f\xde\x74\xcf\xf4\x3b\xea\x18\x41\x36\x69\xb3\x88"
+	"\x8d\xc6\x25\x27\xc7\x7c\x5b\x46\xb4\x80\x33\x43\x0e\x62\x1b\x07"
+	"\x96\xa8\xe2\xb7\x11\x7d\x53\x77\xb3\x65\xeb\x2a\x5d\x74\x56\x73"
+	"\xd9\x19\x22\x01\x67\x21\x19\x22\xc1\x1c\xf9\x03\x6b\xd7\x39\x45"
+	"\x26\x9f\xe6\xb1\x46\x9a\x73\x2f\x13\xb8\xad\x02\x5d\xa4\xf5\xe2"
+	"\x85\x1b\x5a\x15\x4a\xec\x3f\xc4\x03\x16\x39\x98\x3a\x70\xad\xcb"
+	"\x30\x6c\xdb\xe6\xe2\xd2\xe7\x0d\x6a\xdd\x3e\x1b\x71\x7c\x69\x28"
+	"\x26\x2b\x13\x8e\xdf\x4c\x80\x1e\x67\x32\x4e\xad\xc3\x59\x39\xc6"
+	"\x8f\x1c\x82\xa1\x56\x42\xae\x3b\x29\x28\x9e\x66\xaa\xcd\xd1\x4b"
+	"\xcc\x9c\x47\xf1\x43\x09\x0c\x8d\x35\x7e\x2c\xbe\xaa\x89\x30\x89"
+	"\x12\xa7\x11\x2e\x79\x89\x2e\x8d\x63\xd5\x56\x81\x38\x2d\xa8\xae"
+	"\x1a\x2c\x0c\x54\x50\x13\xcf\x3d\x0d\xc2\x76\x28\x65\xd6\x51\x59"
+	"\x23\x7b\x72\x49\x57\x7e\xfe\xa0\x46\xe0\x18\xc1\x41\x53\x45\xbf"
+	"\x44\x99\x21\xe6\xab\x0b\xbc\x42\x05\xe8\x86\xc5\x90\x9e\x27\x6a"
+	"\x10\xb9\x50\xdd\x70\x22\x2f\x75\x5f\x44\xd2\x5e\xeb\xeb\x5c\x4e"
+	"\x14\x75\xd0\x23\x9a\xcd\x96\x55\x9c\x84\x96\x1a\xb2\x08\x6b\xcf"
+	"\xec\x58\x4c\x1d\x94\xba\x28\xf1\x10\xbd\x30\x86\xd5\x36\x31\xba"
+	"\xc0\x17\x85\x7b\x4d\x47\x33\xd2\xe5\x79\x6d\x61\x0c\xf6\x20\xa1"
+	"\x6e\xc4\x4a\xbd\x84\xbc\xdc\x6e\xa5\xd9\xaa\xea\x48\xd2\xdc\x5b"
+	"\x8f\xc2\x0c\x69\xb9\x52\xc0\x8c\x9d\x9a\x77\xd7\x9b\x47\xf5\xae"
+	"\x6e\xae\xbd\x4d\xc9\xa1\x62\x6f\xd7\xcb\x5d\x97\xd6\x08\x09\xb6"
+	"\x48\x71\x77\x43\xb5\x5e\x1f\x72\xd1\xcb\xf4\x4b\x35\x91\x53\xac"
+	"\x72\xea\x2c\xad\x28\xb0\xa5\xd7\x6a\x53\x33\xbd\x6a\x19\xb1\x07"
+	"\x32\xe5\x51\x56\x69\x9e\x42\xf8\x70\xc0\xd1\xec\x19\xf9\x97\xb7"
+	"\x61\x89\x20\x18\x0a\x7b\x59\x56\x66\x98\xc4\xcc\xc5\x3e\x8a\x04"
+	"\xfa\x94\x62\x93\x1d\x3b\xca\x11\xcc\xd4\x91\x5b\x75\xee\x6d\x91"
+	"\x79\xb2\x4e\x44\xd0\x10\x0a\xf4\xd4\x6e\x25\x13\x38\x4d\x26\x5c"
+	"\x74\x0e\x39\x5b\x6b\xa8\x6a\x2f\x19\xa8\x4a\xa5\x4a\x7a\x8f\xc2"
+	"\xc3\xd2\xca\x67\xc9\x3b\x13\xc5\x16\x93\x48\x07\xd3\x60\xc5\x91"
+	"\x3b\xac\xbe\xe2\x90\x64\x8b\x20\x28\x5b\x8b\xd4\x36\xb9\xb4\x58"
+	"\x35\xc6\xa5\x7a\x31\xa9\x6c\x18\xe5\xd8\xc9\x47\x37\x91\x62\x61"
+	"\x93\xf1\xf9\xfa\xb6\x26\x86\x44\x5a\x47\x8a\xe2\xbd\xec\xbe\x9d"
+	"\xb2\xb6\x45\xb1\x82\x32\x1e\xf6\xe4\xbc\x6c\xb9\x33\xfe\xbc\xc7"
+	"\x11\x71\x58\x15\x7b\x36\xf9\x56\x3c\x71\x28\x59\x55\xd2\xa4\x39"
+	"\xff\x2d\xcb\x20\x6e\x04\xa6\x46\x59\x16\xb3\x72\x41\x8c\x18\xcc"
+	"\xdf\xe4\x22\xca\x01\x6b\xc0\xb5\xbc\x47\x42\x39\x2e\xb8\xb7\x0e"
+	"\x92\x2d\xeb\x52\x41\x39\xd9\x8f\xcf\x89\xf3\xd2\x28\xe3\xea\x58"
+	"\xd2\x37\x24\xe2\x01\x9a\x96\xb0\x34\x51\xaa\x17\x5c\x1d\x24\xbf"
+	"\xc5\x82\x43\x83\xa8\x65\x7a\x9d\x41\x82\x4a\x93\x67\xb8\x2b\xd1"
+	"\x14\xf2\xab\x2b\xc6\x4c\xf2\xbd\x17\x80\xb8\xfc\x0c\xae\x27\x13"
+	"\xe8\xd0\x20\x01\xc0\xc8\xe3\xf5\x2b\x4a\xe9\xff\xc1\x55\x4d\x55"
+	"\x12\x69\x15\xf0\x5a\x6a\x7f\x93\xdf\xd7\x87\xf2\xd3\x66\x08\x24"
+	"\xc1\x48\xe3\x89\xf0\xaf\xeb\xec\x5c\x11\xd3\xe0\x2a\x0f\x06\x08"
+	"\x97\x81\xad\x34\x38\xa9\x57\xe8\x6f\xa5\x61\x30\x45\xc1\x36\x2a"
+	"\x7b\x5d\x1c\xb2\x7b\x55\x5c\x2e\x46\xbc\x84\x41\x65\xcf\x5f\xe1"
+	"\x10\xd0\x08\xf0\x78\x91\xc0\xcb\x79\xbc\x1f\x89\x31\x5a\x54\xfe"
+	"\x81\x73\x0e\xb9\x66\x8d\x16\xd6\xdd\x34\x9e\x4c\x5d\xa5\xa4\xe2"
+	"\x05\xaf\x75\x64\xf6\xe7\x04\x30\x51\xd1\x0d\x4e\x59\x93\x2f\xa1"
+	"\xe2\x84\x16\xf0\x8d\xd2\xb2\xa2\x5f\x9d\xcd\xf6\x0d\x74\x01\x53"
+	"\x35\xb0\x69\xe1\xca\x30\x33\x7f\xeb\xd3\xf5\x46\x5d\x89\x82\x0e"
+	"\x5c\x12\x0c\x1c\xe6\x26\x04\x94\xf7\x94\xc7\xf9\x1c\xe9\xd4\xcd"
+	"\x9b\xa0\x65\xa4\x31\x28\xea\x50\x23\xb4\xe4\x97\x19\xd8\x98\x41"
+	"\xbf\x1d\x6f\x1c\xcd\xf1\x93\xe1\x5e\xe3\x57\x59\xd3\x8c\xbf\xd1"
+	"\xb2\x80\x17\x5a\xbd\x63\x51\x2a\xb7\x7f\x8f\x52\x50\xbf\x09\x3e"
+	"\xa2\x80\x8d\x1a\x32\xc7\xd6\xef\x0a\xe1\x47\xcd\x09\xc4\xd0\x64"
+	"\x5e\x60\x00\xfa\x65\x16\xae\xa8\x28\xf9\xb2\x3f\x3c\x02\x8e\x81"
+	"\x59\x82\xed\x95\x36\xe5\x85\x40\x42\x29\x47\x3e\x13\x9d\x56\x46"
+	"\xa3\x22\x53\x34\xf2\xb3\x50\xb7\x96\xd5\x01\x0e\x59\xe3\x71\x7a"
+	"\x39\x67\x07\x09\xcb\x23\x02\xa9\x72\x84\x86\xb6\x02\x4f\x5c\x25"
+	"\x0c\x97\x31\x1d\xf0\xb4\xa8\xbe\x13\xe1\xf0\x53\x5f\xe3\xa8\x4b"
+	"\xfd\x58\xeb\x93\x05\x7c\xb9\xb3\xd9\xb8\x1a\x6f\x08\xcf\xcb\x09"
+	"\xa4\x3e\x27\x7e\x89\x6a\x1f\x57\xcb\x41\x80\x22\x3f\x43\xa5\x73"
+	"\x39\xfe\xde\x7e\xbb\x80\xea\xb1\xfa\xd1\x73\x76\x17\xca\x2e\x97"
+	"\xfa\x6a\x4c\xf7\x20\x64\xd7\x4a\x08\x40\x7c\xbf\xff\x30\xf1\x11"
+	"\xf8\xa3\x5c\x09\x89\x76\x75\x7f\x0a\x46\x17\x79\x60";
+
+/*
+ * zstd -19 --zstd=wlog=10 of zstd_test_periodic(), 32768 bytes: a 1KB
+ * window and 32 blocks, each after the first copied from the one before
+ */
+static const char zstd_window[] =
+	"\x28\xb5\x2f\xfd\x44\x00\x00\x7f\xec\x0b\x00\xc6\xab\x5c\x0b\xd0"
+	"\x0f\x24\x49\x92\x24\xc9\x07\x00\x28\x0f\x58\x00\x58\x00\x58\x00"
+	"\x1d\x6c\x43\x44\xbe\xa7\xf5\x2f\x87\x3b\x28\x12\x1c\xff\x45\xab"
+	"\xab\x69\x7f\x56\x5f\xbc\xb8\x2b\xfe\xf5\xcc\x1c\x2b\xde\xf4\xcb"
+	"\x25\xfc\x95\x72\x06\x80\x9e\x79\x95\x79\x9e\x84\x85\xb0\x1b\x53"
+	"\x04\x9a\x4c\x50\x3c\x8a\x10\x84\xe5\x6d\x34\xe2\xb1\xfd\x11\x0a"
+	"\xee\xde\xec\x47\x88\x33\xa4\xe2\x65\x1a\x07\xad\x37\x4c\x6e\x29"
+	"\x2d\x3e\x1d\xe1\x52\x23\xe4\x1c\x0b\x5a\x4c\x55\xb2\xf0\xda\x53"
+	"\x7e\x7e\x1e\xcf\x31\xe7\x79\xec\xf9\x2c\x45\xf7\x2d\xb9\x7a\xfa"
+	"\x54\xd6\xb9\x6b\x7e\x97\x84\xce\x69\xcc\x23\x4f\xce\xf2\x80\xc9"
+	"\xf1\x50\x6c\xf2\x14\x0b\x48\x3c\xe5\xc2\x5d\xb6\x1b\x12\x94\x59"
+	"\xfd\x63\xcf\xdb\xab\x9a\x4e\x9f\xf3\x85\x7b\xc3\x8d\xb2\x2e\x31"
+	"\xb0\x88\x3a\xae\x9b\xdc\x0e\x8e\x0c\xad\xe4\xff\xad\x49\xb6\x19"
+	"\xac\x49\x28\xf7\xfa\xd7\x59\xc5\xe0\xd3\x39\xa2\x18\xa4\x87\x0f"
+	"\x16\x70\x70\xf4\x3e\x47\x4b\x3a\x5c\xb6\xdc\x52\x5a\x45\xc3\xcb"
+	"\xbd\x29\x7a\x70\xa8\x42\x0a\x47\x28\x5e\x56\xd3\x16\xd4\x1e\x63"
+	"\xd8\xda\x9d\x01\xc1\x70\x0c\x95\xdc\x43\x4d\xaf\xc5\xbb\xf0\x70"
+	"\x10\x1d\x62\x21\x20\x3a\xd9\x9a\xc2\xee\x1a\x3d\xef\x71\xd3\x79"
+	"\xfd\x49\x61\x57\x3e\x17\xea\x10\xe3\xa2\x48\xe9\x05\xc0\x65\x16"
+	"\xe0\x23\x1a\x61\x8a\x4a\xeb\xa6\xa2\x31\xe3\x8f\xe4\x2f\x1f\x40"
+	"\x79\xa6\x04\x0c\x84\x47\x24\xae\xb6\x3b\xbd\xc1\xab\x7b\x89\xb9"
+	"\xab\xba\x40\x87\xba\x75\x71\x39\x98\x0a\x1d\x38\xe1\x3e\x3c\xf8"
+	"\xee\xe5\x76\x8c\x93\x7e\x3b\xcf\xdf\x24\xab\x4c\x1f\xff\xb0\x77"
+	"\xbb\xa1\x0e\x61\xb7\xa9\x0a\xe8\xd4\x33\xd0\x95\xbc\x35\x7b\x1c"
+	"\x01\x00\xbc\x82\x7e\xa9\x22\x0d\x44\x00\x00\x00\x01\x00\xfd\x7f"
+	"\x55\x02\x08\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00"
+	"\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00"
+	"\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01"
+	"\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c"
+	"\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd"
+	"\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00"
+	"\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00"
+	"\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01"
+	"\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c"
+	"\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd"
+	"\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00"
+	"\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00"
+	"\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01"
+	"\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c"
+	"\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd"
+	"\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00"
+	"\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00"
+	"\x04\x3c\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\x3c\x00\x00\x00\x01"
+	"\x00\xfd\x2b\x00\x04\x3d\x00\x00\x00\x01\x00\xfd\x2b\x00\x04\xe5"
+	"\xc8\xeb\xc0";
+
+/*
+ * A skippable frame, zstd -19 --zstd=wlog=10 of 3000 'z' (a compressed
+ * and two RLE blocks), zstd -19 of zstd_test_noise(), 64 bytes (a raw
+ * block), and an empty skippable frame
+ */
+static const char zstd_frames[] =
+	"\x5e\x2a\x4d\x18\x04\x00\x00\x00\x73\x6b\x69\x70\x28\xb5\x2f\xfd"
+	"\x44\x00\xb8\x0a\x44\x00\x00\x08\x7a\x01\x00\xfc\x2b\x20\x04\x02"
+	"\x20\x00\x7a\xc3\x1d\x00\x7a\xa8\xc9\xe4\x79\x28\xb5\x2f\xfd\x24"
+	"\x40\x01\x02\x00\x53\xc3\x7d\x78\x8e\xb4\x4d\xb7\x48\x2f\x6d\x46"
+	"\x3d\x19\xe5\x70\x24\x4c\xbb\xa0\xe3\x58\xfc\x78\x74\xfa\x8c\xb1"
+	"\x95\x5c\xaf\xb5\x32\x12\x53\xfe\x93\xd1\x23\x2c\x45\xed\x4c\xe9"
+	"\xc9\x99\x0d\x7d\xff\xdc\x01\x30\x51\x55\x2c\x63\xa0\xb0\xc7\x6d"
+	"\xee\xe4\xcc\x36\x95\xe9\x9a\x37\x50\x2a\x4d\x18\x00\x00\x00\x00";
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -267,6 +528,23 @@ static int compress_using_lz4(void *in, unsigned long in_size,
 	return 0;
 }
 
+static int compress_using_lz4_linked(void *in, unsigned long in_size,
+				     void *out, unsigned long out_max,
+				     unsigned long *out_size)
+{
+	assert(in_size == strlen(plain));
+	assert(memcmp(plain, in, in_size) == 0);
+
+	if (lz4_linked_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, lz4_linked_compressed, lz4_linked_compressed_size);
+	if (out_size)
+		*out_size = lz4_linked_compressed_size;
+
+	return 0;
+}
+
 static int uncompress_using_lz4(void *in, unsigned long in_size,
 				void *out, unsigned long out_max,
 				unsigned long *out_size)
@@ -282,6 +560,38 @@ static int uncompress_using_lz4(void *in, unsigned long in_size,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	assert(in_size == strlen(plain));
+	assert(memcmp(plain, in, in_size) == 0);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -371,6 +681,314 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_ZLIB_INFLATE_FAST64
+#define BENCH_SIZE	(4 << 20)
+#define BENCH_ROUNDS	4
+
+/* Time BENCH_ROUNDS calls to gunzip(), returns microseconds or 0 on error */
+static ulong time_gunzip(void *dst, void *src, unsigned long len)
+{
+	unsigned long size;
+	ulong start;
+	int i;
+
+	start = timer_get_us();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		size = len;
+		if (gunzip(dst, BENCH_SIZE, src, &size))
+			return 0;
+	}
+
+	return max(timer_get_us() - start, 1UL);
+}
+
+/**
+ * run_inflate_bench() - Compare the speed of the two inflate loops
+ *
+ * The input is made of pieces of the plain test string, picked at random,
+ * with some runs of random bytes between them. This gives a mix of
+ * literals and short and long matches, not unlike a ramdisk.
+ *
+ * @return 0 if both loops give the right output, 1 if not
+ */
+static int run_inflate_bench(void)
+{
+	unsigned long compressed_size = BENCH_SIZE;
+	int plain_size = strlen(plain);
+	char *orig_buf, *compressed_buf = NULL, *uncompressed_buf = NULL;
+	ulong ref_us, fast_us;
+	u32 seed = 1;
+	int pos, len, i, ret;
+
+	printf(" benchmarking inflate ...\n");
+	orig_buf = malloc(BENCH_SIZE);
+	errcheck(orig_buf != NULL);
+	compressed_buf = malloc(BENCH_SIZE);
+	errcheck(compressed_buf != NULL);
+	uncompressed_buf = malloc(BENCH_SIZE);
+	errcheck(uncompressed_buf != NULL);
+
+	for (pos = 0; pos < BENCH_SIZE; pos += len) {
+		seed = seed * 1103515245 + 12345;
+		len = min(4 + (int)(seed >> 27), BENCH_SIZE - pos);
+		if ((seed >> 8) % 8) {
+			memcpy(orig_buf + pos,
+			       plain + (seed >> 8) % (plain_size - 36), len);
+		} else {
+			for (i = 0; i < len; i++) {
+				seed = seed * 1103515245 + 12345;
+				orig_buf[pos + i] = seed >> 24;
+			}
+		}
+	}
+	errcheck(gzip(compressed_buf, &compressed_size,
+		      (uchar *)orig_buf, BENCH_SIZE) == 0);
+	printf("\torig_size:%d compressed_size:%lu\n", BENCH_SIZE,
+	       compressed_size);
+
+	zlib_inflate_reference = 1;
+	ref_us = time_gunzip(uncompressed_buf, compressed_buf,
+			     compressed_size);
+	zlib_inflate_reference = 0;
+	errcheck(ref_us != 0);
+	errcheck(memcmp(orig_buf, uncompressed_buf, BENCH_SIZE) == 0);
+
+	memset(uncompressed_buf, 'A', BENCH_SIZE);
+	fast_us = time_gunzip(uncompressed_buf, compressed_buf,
+			      compressed_size);
+	errcheck(fast_us != 0);
+	errcheck(memcmp(orig_buf, uncompressed_buf, BENCH_SIZE) == 0);
+
+	printf("\treference: %lu MB/s, fast64: %lu MB/s\n",
+	       (ulong)BENCH_SIZE * BENCH_ROUNDS / ref_us,
+	       (ulong)BENCH_SIZE * BENCH_ROUNDS / fast_us);
+	ret = 0;
+
+out:
+	printf(" inflate benchmark: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	free(uncompressed_buf);
+	free(compressed_buf);
+	free(orig_buf);
+
+	return ret;
+}
+#endif
+
+/* Check that each LZ4 checksum is checked, by breaking it */
+static int run_lz4_checksum_test(void)
+{
+	static const int offsets[] = {
+		14,	/* header checksum */
+		121,	/* first block checksum */
+		200,	/* data in the second block */
+		297,	/* content checksum */
+	};
+	char buf[TEST_BUFFER_SIZE];
+	char out[TEST_BUFFER_SIZE];
+	size_t out_len;
+	int i, ret;
+
+	printf(" testing lz4 checksums ...\n");
+	for (i = 0; i < ARRAY_SIZE(offsets); i++) {
+		memcpy(buf, lz4_linked_compressed, lz4_linked_compressed_size);
+		buf[offsets[i]] ^= 0x10;
+		out_len = sizeof(out);
+		errcheck(ulz4fn(buf, lz4_linked_compressed_size, out,
+				&out_len) != 0);
+	}
+	ret = 0;
+out:
+	printf(" lz4 checksums: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+/* Pseudo-random numbers for the zstd test data, as made for the vectors */
+static uint zstd_test_rand(u32 *x)
+{
+	*x = *x * 1103515245 + 12345;
+
+	return *x >> 16;
+}
+
+/* Words and letters, for both matches and Huffman-coded literals */
+static void zstd_test_text(char *buf, ulong len)
+{
+	static const char *const words[] = {
+		"the ", "zstd ", "block ", "window ",
+	};
+	ulong pos, n;
+	u32 x = 1;
+	uint r;
+
+	for (pos = 0; pos < len; pos += n) {
+		r = zstd_test_rand(&x) & 31;
+		if (r < ARRAY_SIZE(words)) {
+			n = min(strlen(words[r]), len - pos);
+			memcpy(buf + pos, words[r], n);
+		} else {
+			buf[pos] = 'a' + r - ARRAY_SIZE(words);
+			n = 1;
+		}
+	}
+}
+
+/* 700 random letters, over and over */
+static void zstd_test_periodic(char *buf, ulong len)
+{
+	ulong pos;
+	u32 x = 7;
+
+	for (pos = 0; pos < len; pos++) {
+		if (pos < 700)
+			buf[pos] = 'a' + (zstd_test_rand(&x) & 15);
+		else
+			buf[pos] = buf[pos - 700];
+	}
+}
+
+static void zstd_test_noise(char *buf, ulong len)
+{
+	u32 x = 3;
+
+	while (len--)
+		*buf++ = zstd_test_rand(&x);
+}
+
+static void zstd_test_frames(char *buf, ulong len)
+{
+	memset(buf, 'z', 3000);
+	zstd_test_noise(buf + 3000, len - 3000);
+}
+
+static const struct {
+	const char *name;
+	const char *data;
+	ulong size;
+	void (*fill)(char *buf, ulong len);
+	ulong len;
+} zstd_vectors[] = {
+	{ "blocks", zstd_blocks, sizeof(zstd_blocks) - 1, zstd_test_text,
+	  4500 },
+	{ "window", zstd_window, sizeof(zstd_window) - 1, zstd_test_periodic,
+	  32768 },
+	{ "frames", zstd_frames, sizeof(zstd_frames) - 1, zstd_test_frames,
+	  3064 },
+};
+
+#ifdef CONFIG_CMD_UNZIP
+#define ZSTD_TEST_FILE		"zstd_test.img"
+#define ZSTD_TEST_FILE_SIZE	(64 << 10)
+
+/*
+ * Write @len bytes at @src with zstdwrite() to a host file and check that
+ * @expect comes back, or that it fails if @expect is NULL. Writes of 512
+ * bytes are smaller than any window.
+ */
+static int zstd_test_write(const char *src, ulong len, const char *expect,
+			   ulong expect_len)
+{
+	struct blk_desc *desc;
+	char *buf = NULL;
+	ulong blks;
+	int ret, fd;
+
+	fd = os_open(ZSTD_TEST_FILE, OS_O_RDWR | OS_O_CREAT);
+	errcheck(fd >= 0);
+	errcheck(os_lseek(fd, ZSTD_TEST_FILE_SIZE - 1, OS_SEEK_SET) ==
+		 ZSTD_TEST_FILE_SIZE - 1);
+	errcheck(os_write(fd, "", 1) == 1);
+	os_close(fd);
+	errcheck(host_dev_bind(0, ZSTD_TEST_FILE) == 0);
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	errcheck(desc != NULL);
+
+	ret = zstdwrite((unsigned char *)src, len, desc, 512, 0, 0);
+	errcheck(expect ? ret == 0 : ret != 0);
+	if (expect) {
+		blks = DIV_ROUND_UP(expect_len, desc->blksz);
+		buf = malloc(blks * desc->blksz);
+		errcheck(buf != NULL);
+		errcheck(blk_dread(desc, 0, blks, buf) == blks);
+		errcheck(memcmp(buf, expect, expect_len) == 0);
+	}
+
+	ret = 0;
+out:
+	free(buf);
+	host_dev_bind(0, NULL);
+	os_unlink(ZSTD_TEST_FILE);
+
+	return ret;
+}
+#endif
+
+/* Decompress zstd frames made of each kind of block and table */
+static int run_zstd_test(void)
+{
+	char *expect = NULL, *out = NULL, *bad = NULL;
+	ulong len, size;
+	size_t out_len;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(zstd_vectors); i++) {
+		printf(" testing zstd %s ...\n", zstd_vectors[i].name);
+		len = zstd_vectors[i].len;
+		size = zstd_vectors[i].size;
+		expect = malloc(len);
+		errcheck(expect != NULL);
+		out = malloc(len + 1);
+		errcheck(out != NULL);
+		zstd_vectors[i].fill(expect, len);
+
+		memset(out, 'A', len + 1);
+		out_len = len + 1;
+		errcheck(zstd_decompress(zstd_vectors[i].data, size, out,
+					 &out_len) == 0);
+		errcheck(out_len == len);
+		errcheck(memcmp(out, expect, len) == 0);
+		errcheck(out[len] == 'A');
+
+		/* Output does not fit */
+		out_len = len - 1;
+		errcheck(zstd_decompress(zstd_vectors[i].data, size, out,
+					 &out_len) == -ENOBUFS);
+#ifdef CONFIG_CMD_UNZIP
+		errcheck(zstd_test_write(zstd_vectors[i].data, size, expect,
+					 len) == 0);
+#endif
+		free(out);
+		out = NULL;
+		free(expect);
+		expect = NULL;
+	}
+
+	/* A wrong content checksum is an error */
+	printf(" testing zstd checksum ...\n");
+	size = sizeof(zstd_blocks) - 1;
+	bad = malloc(size);
+	errcheck(bad != NULL);
+	memcpy(bad, zstd_blocks, size);
+	bad[size - 1] ^= 0x10;
+	out_len = zstd_vectors[0].len;
+	out = malloc(out_len);
+	errcheck(out != NULL);
+	errcheck(zstd_decompress(bad, size, out, &out_len) == -EINVAL);
+#ifdef CONFIG_CMD_UNZIP
+	errcheck(zstd_test_write(bad, size, NULL, 0) == 0);
+#endif
+
+	ret = 0;
+out:
+	free(bad);
+	free(out);
+	free(expect);
+	printf(" zstd: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
 static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 			     char *const argv[])
 {
@@ -381,6 +999,14 @@ static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
 	err += run_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_test("lz4 linked", compress_using_lz4_linked,
+			uncompress_using_lz4);
+	err += run_lz4_checksum_test();
+	err += run_test("zstd", compress_using_zstd, uncompress_using_zstd);
+	err += run_zstd_test();
+#ifdef CONFIG_ZLIB_INFLATE_FAST64
+	err += run_inflate_bench();
+#endif
 
 	printf("ut_compression %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -448,6 +1074,87 @@ static int run_bootm_test(int comp_type, mutate_func compress)
 	return 0;
 }
 
+#ifdef CONFIG_DECOMP_STREAM
+/* Feed @len bytes at @src to a new stream in pieces of @piece bytes */
+static int stream_decomp(int comp_type, const char *src, ulong len,
+			 ulong piece, void *dst, ulong dst_len, ulong *out_len)
+{
+	struct decomp_stream ds;
+	ulong pos, n;
+	int ret, err;
+
+	ret = decomp_stream_init(&ds, comp_type, dst, dst_len);
+	if (ret)
+		return ret;
+	for (pos = 0; pos < len && !ret; pos += n) {
+		n = min(piece, len - pos);
+		ret = decomp_stream_write(&ds, src + pos, n);
+	}
+	err = decomp_stream_finish(&ds, out_len);
+
+	return ret ? ret : err;
+}
+
+/**
+ * run_stream_test() - Run tests on streaming decompression
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_test(int comp_type, mutate_func compress)
+{
+	static const ulong pieces[] = { 1, 7, 64, TEST_BUFFER_SIZE };
+	ulong unc_len = strlen(plain);
+	ulong compress_size = TEST_BUFFER_SIZE;
+	ulong out_len;
+	char *compress_buff = NULL;
+	char *out = NULL;
+	int ret;
+	int i;
+
+	printf("Testing stream: %s\n", genimg_get_comp_name(comp_type));
+	compress_buff = malloc(TEST_BUFFER_SIZE);
+	errcheck(compress_buff != NULL);
+	out = malloc(TEST_BUFFER_SIZE);
+	errcheck(out != NULL);
+	errcheck(compress((void *)plain, unc_len, compress_buff,
+			  compress_size, &compress_size) == 0);
+	errcheck(decomp_stream_detect(compress_buff, compress_size) ==
+		 comp_type);
+
+	/* Any split of the input gives the same output */
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		memset(out, 'A', TEST_BUFFER_SIZE);
+		errcheck(stream_decomp(comp_type, compress_buff,
+				       compress_size, pieces[i], out,
+				       TEST_BUFFER_SIZE, &out_len) == 0);
+		errcheck(out_len == unc_len);
+		errcheck(memcmp(out, plain, unc_len) == 0);
+		errcheck(out[unc_len] == 'A');
+	}
+
+	/* Output does not fit */
+	memset(out, 'A', TEST_BUFFER_SIZE);
+	errcheck(stream_decomp(comp_type, compress_buff, compress_size, 7,
+			       out, unc_len - 1, &out_len) != 0);
+	errcheck(out[unc_len - 1] == 'A');
+
+	/* Stream stops early, which only compressed data can tell */
+	if (comp_type != IH_COMP_NONE)
+		errcheck(stream_decomp(comp_type, compress_buff,
+				       compress_size - 1, 7, out,
+				       TEST_BUFFER_SIZE, &out_len) != 0);
+
+	ret = 0;
+out:
+	free(out);
+	free(compress_buff);
+
+	return ret;
+}
+#endif
+
 static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 			      char *const argv[])
 {
@@ -458,7 +1165,15 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 	err |= run_bootm_test(IH_COMP_LZMA, compress_using_lzma);
 	err |= run_bootm_test(IH_COMP_LZO, compress_using_lzo);
 	err |= run_bootm_test(IH_COMP_LZ4, compress_using_lz4);
+	err |= run_bootm_test(IH_COMP_ZSTD, compress_using_zstd);
 	err |= run_bootm_test(IH_COMP_NONE, compress_using_none);
+#ifdef CONFIG_DECOMP_STREAM
+	err |= run_stream_test(IH_COMP_GZIP, compress_using_gzip);
+	err |= run_stream_test(IH_COMP_LZO, compress_using_lzo);
+	err |= run_stream_test(IH_COMP_LZ4, compress_using_lz4);
+	err |= run_stream_test(IH_COMP_LZ4, compress_using_lz4_linked);
+	err |= run_stream_test(IH_COMP_NONE, compress_using_none);
+#endif
 
 	printf("ut_image_decomp %s\n", err == 0 ? "ok" : "FAILED");
 
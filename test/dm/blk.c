@@ -6,6 +6,9 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <part.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -168,3 +171,98 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+#define PART_CACHE_TEST_FILE	"part_cache_test.img"
+#define PART_CACHE_TEST_SIZE	(1 << 20)
+
+static const char * const part_cache_uuids[] = {
+	"24ee5bac-0a3c-4d7d-a97b-0f0fd3f26ea6",
+	"0d7a3b3e-7a1b-4b9e-9a9a-5bd1b6f0e2c1",
+	"4a1e5f7d-2c9e-4f3b-8d2a-7e6b9c1d0f3a",
+};
+
+/* Write a GPT with one partition of 16 blocks for each name, from block 64 */
+static int part_cache_write_gpt(struct blk_desc *desc, const char **names,
+				int count)
+{
+	disk_partition_t parts[ARRAY_SIZE(part_cache_uuids)];
+	int i;
+
+	memset(parts, '\0', sizeof(parts));
+	for (i = 0; i < count; i++) {
+		strcpy((char *)parts[i].name, names[i]);
+		strcpy(parts[i].uuid, part_cache_uuids[i]);
+		parts[i].start = 64 + i * 16;
+		parts[i].size = 16;
+	}
+
+	return gpt_restore(desc, (char *)part_cache_uuids[0], parts, count);
+}
+
+/* Test that partition lookups by name are cached until the table changes */
+static int dm_test_blk_part_cache(struct unit_test_state *uts)
+{
+	const char *names[] = { "boot", "system", "boot" };
+	disk_partition_t info;
+	struct blk_desc *desc;
+	unsigned int gen;
+	char zero[512];
+	int fd;
+
+	fd = os_open(PART_CACHE_TEST_FILE, OS_O_RDWR | OS_O_CREAT);
+	ut_assert(fd >= 0);
+	ut_asserteq(PART_CACHE_TEST_SIZE - 1,
+		    os_lseek(fd, PART_CACHE_TEST_SIZE - 1, OS_SEEK_SET));
+	ut_asserteq(1, os_write(fd, "", 1));
+	ut_assertok(host_dev_bind(0, PART_CACHE_TEST_FILE));
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	ut_assertnonnull(desc);
+
+	/* The first of two partitions with the same name is found */
+	ut_assertok(part_cache_write_gpt(desc, names, 3));
+	ut_asserteq(1, part_get_info_by_name(desc, "boot", &info));
+	ut_asserteq(2, part_get_info_by_name(desc, "system", &info));
+	ut_asserteq_str("system", (char *)info.name);
+	ut_asserteq(-1, part_get_info_by_name(desc, "misc", &info));
+
+	/* Lookups do not read the device: wipe both GPT headers under it */
+	gen = part_cache_generation();
+	memset(zero, '\0', sizeof(zero));
+	ut_asserteq(512, os_lseek(fd, 512, OS_SEEK_SET));
+	ut_asserteq(512, os_write(fd, zero, sizeof(zero)));
+	ut_asserteq(PART_CACHE_TEST_SIZE - 512,
+		    os_lseek(fd, PART_CACHE_TEST_SIZE - 512, OS_SEEK_SET));
+	ut_asserteq(512, os_write(fd, zero, sizeof(zero)));
+	ut_asserteq(2, part_get_info_by_name(desc, "system", &info));
+	ut_asserteq(gen, part_cache_generation());
+
+	/* Dropping the cache reads the (now broken) table again */
+	part_cache_invalidate(desc);
+	ut_assert(part_cache_generation() != gen);
+	ut_asserteq(-1, part_get_info_by_name(desc, "system", &info));
+
+	/* Writing a new table drops the cached one */
+	names[0] = "misc";
+	ut_assertok(part_cache_write_gpt(desc, names, 2));
+	ut_asserteq(1, part_get_info_by_name(desc, "misc", &info));
+	ut_asserteq(-1, part_get_info_by_name(desc, "boot", &info));
+
+	/* Writes away from any table keep it */
+	gen = part_cache_generation();
+	ut_asserteq(1, blk_dwrite(desc, 1024, 1, zero));
+	ut_asserteq(gen, part_cache_generation());
+	ut_asserteq(1, part_get_info_by_name(desc, "misc", &info));
+
+	/* Removing the device drops it too */
+	gen = part_cache_generation();
+	ut_assertok(host_dev_bind(0, NULL));
+	ut_assert(part_cache_generation() != gen);
+
+	os_close(fd);
+	os_unlink(PART_CACHE_TEST_FILE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_part_cache, 0);
+#endif
@@ -41,10 +41,23 @@ static int do_dm_dump_devres(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+static int do_dm_dump_timing(cmd_tbl_t *cmdtp, int flag, int argc,
+			     char * const argv[])
+{
+	dm_dump_timing();
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t test_commands[] = {
 	U_BOOT_CMD_MKENT(tree, 0, 1, do_dm_dump_all, "", ""),
 	U_BOOT_CMD_MKENT(uclass, 1, 1, do_dm_dump_uclass, "", ""),
 	U_BOOT_CMD_MKENT(devres, 1, 1, do_dm_dump_devres, "", ""),
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	U_BOOT_CMD_MKENT(timing, 1, 1, do_dm_dump_timing, "", ""),
+#endif
 };
 
 static __maybe_unused void dm_reloc(void)
@@ -80,10 +93,18 @@ static int do_dm(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	return cmd_process_error(test_cmd, ret);
 }
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+#define DM_TIMING_HELP \
+	"\ndm timing        Dump bind and probe time of each device"
+#else
+#define DM_TIMING_HELP	""
+#endif
+
 U_BOOT_CMD(
 	dm,	3,	1,	do_dm,
 	"Driver model low level access",
 	"tree         Dump driver model tree ('*' = activated)\n"
 	"dm uclass        Dump list of instances for each uclass\n"
 	"dm devres        Dump list of device resources for each device"
+	DM_TIMING_HELP
 );
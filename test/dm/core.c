@@ -12,6 +12,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -862,3 +863,155 @@ static int dm_test_device_get_uclass_id(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_device_get_uclass_id, DM_TESTF_SCAN_PDATA);
+
+/* Search each driver in turn, as lists_bind_fdt() did before the index */
+static int dm_test_compat_search(const char *compat, struct driver **drvp,
+				 const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*drvp = entry;
+				*idp = id;
+				return 0;
+			}
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* Time looking up each of @count compatible strings, @rounds times */
+static ulong dm_test_compat_time(const char **compat, int count, int rounds,
+				 bool indexed)
+{
+	const struct udevice_id *id;
+	struct driver *drv;
+	ulong start;
+	int i;
+
+	start = timer_get_us();
+	while (rounds--) {
+		for (i = 0; i < count; i++) {
+			if (indexed)
+				lists_driver_lookup_compat(compat[i], &drv, &id);
+			else
+				dm_test_compat_search(compat[i], &drv, &id);
+		}
+	}
+
+	return timer_get_us() - start;
+}
+
+/* Test that looking up a compatible string finds the first matching driver */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *found_id, *expect_id;
+	struct driver *entry, *found, *expect;
+	const void *blob = gd->fdt_blob;
+	const char *compat[256], *list;
+	int node, len, i, count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			ut_assertok(lists_driver_lookup_compat(id->compatible,
+							       &found,
+							       &found_id));
+			ut_assertok(dm_test_compat_search(id->compatible,
+							  &expect, &expect_id));
+			ut_asserteq_ptr(expect, found);
+			ut_asserteq_ptr(expect_id, found_id);
+		}
+	}
+	ut_asserteq(-ENOENT, lists_driver_lookup_compat("not,compatible",
+							&found, &found_id));
+
+	/* Report the time to look up the device tree's compatible strings */
+	for (node = fdt_next_node(blob, 0, NULL); node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		list = fdt_getprop(blob, node, "compatible", &len);
+		for (i = 0; list && i < len; i += strlen(list + i) + 1) {
+			if (count < ARRAY_SIZE(compat))
+				compat[count++] = list + i;
+		}
+	}
+	printf("%d compatible strings, 100 lookups each: %lu us, ", count,
+	       dm_test_compat_time(compat, count, 100, true));
+	printf("searching each driver: %lu us\n",
+	       dm_test_compat_time(compat, count, 100, false));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/* Test that the time spent binding and probing a device is recorded */
+static int dm_test_timing(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev, *child;
+	struct dm_timing before, bus_before;
+	ulong bind_us = 0;
+	const char *name;
+	void *blob;
+	int node, next;
+
+	/* The bus binds its children when probed, which is not charged to it */
+	ut_assertok(uclass_get_device(UCLASS_TEST_BUS, 0, &bus));
+	ut_asserteq(1, bus->timing.probe_count);
+	list_for_each_entry(child, &bus->child_head, sibling_node)
+		bind_us += child->timing.bind_us;
+	ut_assert(bus->timing.probe_total_us >=
+		  bus->timing.probe_us + bind_us);
+
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+	ut_asserteq(0, dev->timing.probe_count);
+	ut_assertok(device_probe(dev));
+	ut_asserteq(1, dev->timing.probe_count);
+	ut_assertok(device_probe(dev));
+	ut_asserteq(1, dev->timing.probe_count);
+	ut_asserteq(1, bus->timing.probe_count);
+
+	/* Probing the device again probes its parent first */
+	ut_assertok(device_remove(bus, DM_REMOVE_NORMAL));
+	before = dev->timing;
+	bus_before = bus->timing;
+	ut_assertok(device_probe(dev));
+	ut_asserteq(2, dev->timing.probe_count);
+	ut_asserteq(2, bus->timing.probe_count);
+	ut_assert(dev->timing.probe_total_us - before.probe_total_us >=
+		  dev->timing.probe_us - before.probe_us +
+		  dev->timing.ofdata_us - before.ofdata_us);
+	ut_assert(dev->timing.probe_total_us - before.probe_total_us >=
+		  bus->timing.probe_total_us - bus_before.probe_total_us);
+
+	/* Binding all the devices took some time, so some are reported */
+	blob = malloc(0x10000);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_create_empty_tree(blob, 0x10000));
+	node = fdt_add_subnode(blob, 0, "bootstage");
+	ut_assert(node > 0);
+	next = dm_timing_add_fdt(blob, node, 5);
+	ut_assert(next > 5);
+	node = fdt_subnode_offset(blob, node, "5");
+	ut_assert(node > 0);
+	name = fdt_getprop(blob, node, "name", NULL);
+	ut_assertnonnull(name);
+	ut_assert(!strncmp(name, "dm:", 3));
+	ut_assertnonnull(fdt_getprop(blob, node, "accum", NULL));
+	ut_assertnonnull(fdt_getprop(blob, node, "probe-count", NULL));
+	free(blob);
+
+	dm_dump_timing();
+
+	return 0;
+}
+DM_TEST(dm_test_timing, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
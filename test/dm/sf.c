@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <dm.h>
 #include <fdtdec.h>
 #include <spi.h>
@@ -41,3 +42,56 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test the block device on top of the sandbox SPI flash */
+static int dm_test_spi_flash_blk(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk;
+	struct spi_flash *flash;
+	struct blk_desc *desc;
+	u8 buf[3 * 512];
+	u8 check[512];
+
+	ut_asserteq(0, run_command_list(
+		"sb save hostfs - 0 spi.bin 200000;"
+		"sf probe", -1,  0));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	desc = dev_get_uclass_platdata(blk);
+	ut_asserteq(IF_TYPE_SPINOR, desc->if_type);
+	ut_asserteq(512, desc->blksz);
+	ut_asserteq(flash->size / 512, desc->lba);
+	ut_asserteq_ptr(desc, blk_get_devnum_by_typename("spinor",
+							 desc->devnum));
+
+	/* Writing part of a sector keeps the rest of it */
+	memset(buf, 0x5a, 512);
+	ut_asserteq(1, blk_dwrite(desc, 8, 1, buf));
+	memset(buf, 0xa5, sizeof(buf));
+	ut_asserteq(3, blk_dwrite(desc, 9, 3, buf));
+	ut_asserteq(1, blk_dread(desc, 8, 1, check));
+	memset(buf, 0x5a, 512);
+	ut_assertok(memcmp(buf, check, 512));
+	memset(buf, 0, sizeof(buf));
+	ut_asserteq(3, blk_dread(desc, 9, 3, buf));
+	memset(check, 0xa5, 512);
+	ut_assertok(memcmp(buf + 2 * 512, check, 512));
+
+	/* Erase needs whole sectors */
+	ut_asserteq(0, blk_derase(desc, 9, 1));
+	ut_asserteq(0, blk_derase(desc, 8, flash->erase_size / 512));
+	ut_asserteq(flash->erase_size / 512,
+		    blk_derase(desc, 0, flash->erase_size / 512));
+	ut_asserteq(1, blk_dread(desc, 9, 1, check));
+	memset(buf, 0xff, 512);
+	ut_assertok(memcmp(buf, check, 512));
+
+	/* Nothing past the end of the flash */
+	ut_asserteq(0, blk_dread(desc, desc->lba, 1, buf));
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -13,6 +13,7 @@
 #include <dm/test.h>
 #include <dm/root.h>
 #include <dm/device-internal.h>
+#include <dm/of_access.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
 #include <test/ut.h>
@@ -299,6 +300,153 @@ static int dm_test_fdt_offset(struct unit_test_state *uts)
 DM_TEST(dm_test_fdt_offset,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT | DM_TESTF_FLAT_TREE);
 
+#if CONFIG_IS_ENABLED(OF_LIBFDT_CACHE)
+/* Find a phandle by walking the whole tree, as libfdt does without a cache */
+static int dm_test_phandle_search(const void *blob, uint32_t phandle)
+{
+	int node;
+
+	for (node = fdt_next_node(blob, -1, NULL);
+	     node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		if (fdt_get_phandle(blob, node) == phandle)
+			return node;
+	}
+
+	return node;
+}
+
+/* Check every phandle in @blob against a search, returning the largest */
+static int dm_test_phandle_check(struct unit_test_state *uts,
+				 const void *blob, uint32_t *maxp)
+{
+	uint32_t phandle;
+	int node;
+
+	*maxp = 0;
+	for (node = fdt_next_node(blob, -1, NULL);
+	     node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		phandle = fdt_get_phandle(blob, node);
+		if (!phandle)
+			continue;
+		ut_asserteq(dm_test_phandle_search(blob, phandle),
+			    fdt_node_offset_by_phandle(blob, phandle));
+		*maxp = max(*maxp, phandle);
+	}
+
+	return 0;
+}
+
+static ulong dm_test_phandle_time(const void *blob, uint32_t max,
+				  int rounds, bool cached)
+{
+	uint32_t phandle;
+	ulong start;
+
+	start = timer_get_us();
+	while (rounds--) {
+		for (phandle = 1; phandle <= max; phandle++) {
+			if (cached)
+				fdt_node_offset_by_phandle(blob, phandle);
+			else
+				dm_test_phandle_search(blob, phandle);
+		}
+	}
+
+	return timer_get_us() - start;
+}
+
+/* Test that cached phandle and path lookups follow changes to the tree */
+static int dm_test_fdt_lookup_cache(struct unit_test_state *uts)
+{
+	struct device_node *np, *found;
+	uint32_t max;
+	char path[64];
+	void *blob;
+	int node, size, aliases;
+	uint walks;
+
+	size = fdt_totalsize(gd->fdt_blob) + 4096;
+	blob = malloc(size);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_open_into(gd->fdt_blob, blob, size));
+
+	/* The first pass walks the tree once, the second not at all */
+	walks = fdt_cache_phandle_walks();
+	ut_assertok(dm_test_phandle_check(uts, blob, &max));
+	ut_asserteq(walks + 1, fdt_cache_phandle_walks());
+	ut_assertok(dm_test_phandle_check(uts, blob, &max));
+	ut_asserteq(walks + 1, fdt_cache_phandle_walks());
+	ut_assert(max > 0);
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_node_offset_by_phandle(blob, max + 1));
+
+	node = fdt_path_offset(blob, "testfdt1");
+	ut_assert(node > 0);
+	ut_asserteq(node, fdt_path_offset(blob, "testfdt1"));
+	ut_asserteq(node, fdt_path_offset(blob, "/some-bus/c-test@1"));
+
+	/* Growing the root node moves every other node */
+	ut_assertok(fdt_setprop_string(blob, 0, "u-boot,cache-test",
+				       "move all nodes along"));
+	node = fdt_path_offset(blob, "testfdt1");
+	ut_assert(node > 0);
+	ut_assertok(fdt_get_path(blob, node, path, sizeof(path)));
+	ut_asserteq_str("/some-bus/c-test@1", path);
+	walks = fdt_cache_phandle_walks();
+	ut_assertok(dm_test_phandle_check(uts, blob, &max));
+	ut_asserteq(walks + 1, fdt_cache_phandle_walks());
+
+	/* Changing a phandle in place does not tell the cache */
+	node = fdt_node_offset_by_phandle(blob, max);
+	ut_assert(node > 0);
+	ut_assertok(fdt_setprop_inplace_u32(blob, node, "phandle", max + 1));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_node_offset_by_phandle(blob, max));
+	ut_asserteq(node, fdt_node_offset_by_phandle(blob, max + 1));
+	ut_assertok(dm_test_phandle_check(uts, blob, &max));
+
+	/* Pointing an alias in place at a node of the same name */
+	node = fdt_add_subnode(blob, 0, "cachetst");
+	ut_assert(node > 0);
+	node = fdt_add_subnode(blob, node, "c-test@0");
+	ut_assert(node > 0);
+	aliases = fdt_path_offset(blob, "/aliases");
+	ut_assert(aliases > 0);
+	ut_assertok(fdt_setprop_string(blob, aliases, "cachetest",
+				       "/some-bus/c-test@0"));
+	node = fdt_path_offset(blob, "cachetest");
+	ut_asserteq(fdt_path_offset(blob, "/some-bus/c-test@0"), node);
+	ut_asserteq(node, fdt_path_offset(blob, "cachetest"));
+	aliases = fdt_path_offset(blob, "/aliases");
+	ut_assertok(fdt_setprop_inplace(blob, aliases, "cachetest",
+					"/cachetst/c-test@0", 19));
+	ut_asserteq(fdt_path_offset(blob, "/cachetst/c-test@0"),
+		    fdt_path_offset(blob, "cachetest"));
+
+	printf("cached phandle lookups: %lu us\n",
+	       dm_test_phandle_time(blob, max, 100, true));
+	printf("searching the tree: %lu us\n",
+	       dm_test_phandle_time(blob, max, 100, false));
+	free(blob);
+
+	if (of_live_active()) {
+		for_each_of_allnodes(np) {
+			if (!np->phandle)
+				continue;
+			for_each_of_allnodes(found) {
+				if (found->phandle == np->phandle)
+					break;
+			}
+			ut_asserteq_ptr(found,
+					of_find_node_by_phandle(np->phandle));
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lookup_cache, 0);
+#endif
+
 /**
  * Test various error conditions with uclass_first_device() and
  * uclass_next_device()
@@ -0,0 +1,225 @@
+/*
+ * Conformance test for the SHA1/SHA256 and crc32 implementations
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <hash.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#ifdef CONFIG_SHA_ARMV8_CE
+#include <u-boot/sha_ce.h>
+#endif
+
+#define HASH_TEST_SIZE		(64 * 1024 + 77)
+#define HASH_TEST_ROUNDS	200
+#define HASH_BENCH_SIZE		(4 << 20)
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+struct hash_vector {
+	const char *algo;
+	const char *input;
+	const char *digest;
+};
+
+/* From FIPS 180-2 appendices A and B */
+static const struct hash_vector hash_vectors[] = {
+	{ "sha1", "abc",
+	  "\xa9\x99\x3e\x36\x47\x06\x81\x6a\xba\x3e\x25\x71\x78\x50\xc2\x6c"
+	  "\x9c\xd0\xd8\x9d" },
+	{ "sha1", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	  "\x84\x98\x3e\x44\x1c\x3b\xd2\x6e\xba\xae\x4a\xa1\xf9\x51\x29\xe5"
+	  "\xe5\x46\x70\xf1" },
+	{ "sha256", "abc",
+	  "\xba\x78\x16\xbf\x8f\x01\xcf\xea\x41\x41\x40\xde\x5d\xae\x22\x23"
+	  "\xb0\x03\x61\xa3\x96\x17\x7a\x9c\xb4\x10\xff\x61\xf2\x00\x15\xad" },
+	{ "sha256", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	  "\x24\x8d\x6a\x61\xd2\x06\x38\xb8\xe5\xc0\x26\x93\x0c\x3e\x60\x39"
+	  "\xa3\x3c\xe4\x59\x64\xff\x21\x67\xf6\xec\xed\xd4\x19\xdb\x06\xc1" },
+};
+
+static uint32_t hash_test_seed = 1;
+
+/* Deterministic xorshift generator so that failures can be reproduced */
+static uint32_t hash_test_rand(void)
+{
+	hash_test_seed ^= hash_test_seed << 13;
+	hash_test_seed ^= hash_test_seed >> 17;
+	hash_test_seed ^= hash_test_seed << 5;
+
+	return hash_test_seed;
+}
+
+/* Hash @buf through the progressive API, fed in random-sized pieces */
+static int hash_pieces(struct hash_algo *algo, const uint8_t *buf, uint len,
+		       uint8_t *digest)
+{
+	uint piece;
+	void *ctx;
+
+	if (algo->hash_init(algo, &ctx))
+		return -1;
+	do {
+		/* Mostly short pieces, with some that span many blocks */
+		piece = hash_test_rand() % (hash_test_rand() & 1 ? 130 : 9000);
+		piece = min(piece, len);
+		if (algo->hash_update(algo, ctx, buf, piece, piece == len))
+			return -1;
+		buf += piece;
+		len -= piece;
+	} while (len);
+
+	return algo->hash_finish(algo, ctx, digest, algo->digest_size);
+}
+
+static int run_hash_test(const char *name)
+{
+	uint8_t expect[HASH_MAX_DIGEST_SIZE], digest[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo, *prog;
+	uint8_t *buf;
+	uint i, off, len;
+	int ret = 0;
+
+	printf(" testing %s ...\n", name);
+	buf = malloc(HASH_TEST_SIZE + 8);
+	errcheck(buf != NULL);
+	errcheck(!hash_lookup_algo(name, &algo));
+	errcheck(!hash_progressive_lookup_algo(name, &prog));
+
+	for (i = 0; i < ARRAY_SIZE(hash_vectors); i++) {
+		const struct hash_vector *v = &hash_vectors[i];
+
+		if (strcmp(v->algo, name))
+			continue;
+		algo->hash_func_ws((const uint8_t *)v->input, strlen(v->input),
+				   digest, algo->chunk_size);
+		errcheck(!memcmp(digest, v->digest, algo->digest_size));
+	}
+
+	for (i = 0; i < HASH_TEST_SIZE + 8; i++)
+		buf[i] = hash_test_rand();
+
+	for (i = 0; i < HASH_TEST_ROUNDS; i++) {
+		off = hash_test_rand() & 7;
+		len = hash_test_rand() % (i & 1 ? 300 : HASH_TEST_SIZE);
+
+		algo->hash_func_ws(buf + off, len, expect, algo->chunk_size);
+		errcheck(!hash_pieces(prog, buf + off, len, digest));
+		errcheck(!memcmp(digest, expect, algo->digest_size));
+#ifdef CONFIG_SHA_ARMV8_CE
+		/* Compare the Crypto Extensions with the C code */
+		sha_ce_disable = 1;
+		algo->hash_func_ws(buf + off, len, digest, algo->chunk_size);
+		sha_ce_disable = 0;
+		errcheck(!memcmp(digest, expect, algo->digest_size));
+#endif
+	}
+	ret = 0;
+out:
+	free(buf);
+
+	return ret;
+}
+
+/* Bit-at-a-time crc32, the reference for the table and CPU versions */
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *p, uint len)
+{
+	int i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+static int run_crc32_test(void)
+{
+	uint32_t seed, expect;
+	uint8_t *buf;
+	uint i, off, len;
+	int ret = 0;
+
+	printf(" testing crc32 ...\n");
+	buf = malloc(HASH_TEST_SIZE + 8);
+	errcheck(buf != NULL);
+	errcheck(crc32(0, (const uint8_t *)"123456789", 9) == 0xcbf43926);
+
+	for (i = 0; i < HASH_TEST_SIZE + 8; i++)
+		buf[i] = hash_test_rand();
+
+	for (i = 0; i < HASH_TEST_ROUNDS; i++) {
+		off = hash_test_rand() & 7;
+		len = hash_test_rand() % (i & 1 ? 40 : HASH_TEST_SIZE);
+		seed = hash_test_rand();
+
+		expect = crc32_bitwise(seed, buf + off, len);
+		errcheck(crc32(seed, buf + off, len) == expect);
+		errcheck(crc32_no_comp(~seed, buf + off, len) == ~expect);
+#ifdef CONFIG_CRC32_ARMV8
+		/* Compare the CRC32 instructions with the tables */
+		crc32_armv8_disable = 1;
+		errcheck(crc32(seed, buf + off, len) == expect);
+		crc32_armv8_disable = 0;
+#endif
+	}
+	ret = 0;
+out:
+	free(buf);
+
+	return ret;
+}
+
+static void run_hash_bench(const char *name)
+{
+	uint8_t digest[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	unsigned long us;
+	uint8_t *buf;
+
+	if (hash_lookup_algo(name, &algo))
+		return;
+	buf = calloc(1, HASH_BENCH_SIZE);
+	if (!buf)
+		return;
+	us = timer_get_us();
+	algo->hash_func_ws(buf, HASH_BENCH_SIZE, digest, algo->chunk_size);
+	us = max(timer_get_us() - us, 1UL);
+	printf(" %s: %lu KiB/s\n", name,
+	       (unsigned long)((u64)HASH_BENCH_SIZE * 1000000 / 1024 / us));
+	free(buf);
+}
+
+static int do_ut_hash(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	int err = 0;
+
+	err |= run_hash_test("sha1");
+	err |= run_hash_test("sha256");
+	err |= run_crc32_test();
+	run_hash_bench("sha1");
+	run_hash_bench("sha256");
+	run_hash_bench("crc32");
+
+	printf("ut_hash %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err;
+}
+
+U_BOOT_CMD(
+	ut_hash,	1,	1,	do_ut_hash,
+	"Conformance test of SHA1/SHA256 and crc32", ""
+);
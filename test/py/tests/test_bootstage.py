@@ -0,0 +1,30 @@
+# SPDX-License-Identifier: GPL-2.0
+
+import pytest
+import u_boot_utils
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_initcall')
+def test_bootstage_initcall(u_boot_console):
+    """Test that 'bootstage report' shows the time taken by each initcall"""
+
+    output = u_boot_console.run_command('bootstage report')
+    assert 'Initcalls' in output
+    if u_boot_console.config.buildconfig.get('config_kallsyms', 'n') == 'y':
+        assert 'initf_bootstage' in output
+        assert 'initr_dm' in output
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_export(u_boot_console):
+    """Test that 'bootstage export' writes a trace and sets 'filesize'"""
+
+    addr = '%08x' % u_boot_utils.find_ram_base(u_boot_console)
+    u_boot_console.run_command('setenv filesize 0')
+    output = u_boot_console.run_command('bootstage export %s 10000' % addr)
+    assert output == ''
+    output = u_boot_console.run_command('printenv filesize')
+    assert output != 'filesize=0'
+    output = u_boot_console.run_command('md.b %s 10' % addr)
+    assert '{"displayTimeUn' in output
+    output = u_boot_console.run_command('bootstage export %s 10' % addr)
+    assert 'Trace needs' in output
@@ -0,0 +1,213 @@
+#!/usr/bin/env python
+#
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# Merge U-Boot and Linux boot timings into a single trace
+#
+# U-Boot's 'bootstage export' command writes its boot timings in the Chrome
+# trace-event JSON format. This tool adds the initcall timings from a Linux
+# kernel log (boot with 'initcall_debug', then save the output of dmesg) so
+# that the whole boot can be seen on one timeline in chrome://tracing or
+# https://ui.perfetto.dev
+#
+# For example:
+#    => bootstage export 1000000 10000 mmc 0:1 uboot-trace.json
+#    $ dmesg > dmesg.txt
+#    $ tools/boot-timeline.py -u uboot-trace.json -k dmesg.txt -o boot.json
+#
+# Linux is placed at U-Boot's 'start_kernel' mark. A trace exported from the
+# prompt does not have that mark, so it is then read from the bootstage node
+# which U-Boot adds to the kernel's device tree (with CONFIG_BOOTSTAGE_FDT),
+# /proc/device-tree/bootstage on the target. Copy that directory to the host
+# and pass it with -d, or give the time with -t.
+
+from __future__ import print_function
+
+from optparse import OptionParser
+import json
+import os
+import re
+import struct
+import sys
+
+UBOOT_PID = 1
+LINUX_PID = 2
+
+# Bootstage name of the mark made just before jumping to the kernel
+HANDOFF_NAME = 'start_kernel'
+
+# Bootstage node that U-Boot passes to the kernel, as seen by Linux
+BOOTSTAGE_NODE = '/proc/device-tree/bootstage'
+
+RE_CALLING = re.compile(r'\[\s*(\d+\.\d+)\]\s+calling\s+([^\s+]+)\S*\s+'
+                        r'@\s+(\d+)')
+RE_RETURNED = re.compile(r'\[\s*(\d+\.\d+)\]\s+initcall\s+([^\s+]+)\S*\s+'
+                         r'returned\s+(-?\d+)\s+after\s+(\d+)\s+usecs')
+RE_INIT = re.compile(r'\[\s*(\d+\.\d+)\]\s+Run\s+(\S+)\s+as init process')
+
+def ReadUboot(fname):
+    """Read the trace written by U-Boot's 'bootstage export' command
+
+    Args:
+        fname: Name of the file to read
+    Returns:
+        List of trace events, each a dict
+    """
+    with open(fname) as fd:
+        trace = json.load(fd)
+    if isinstance(trace, list):
+        return trace
+    return trace['traceEvents']
+
+def HandoffTime(events):
+    """Work out when U-Boot handed over to the kernel
+
+    Args:
+        events: List of U-Boot trace events
+    Returns:
+        Time of the 'start_kernel' mark in microseconds, or None if there
+        is no such mark
+    """
+    for event in events:
+        if event['ph'] != 'M' and event['name'] == HANDOFF_NAME:
+            return event['ts']
+    return None
+
+def HandoffTimeFdt(dirname):
+    """Read when U-Boot handed over to the kernel from its bootstage node
+
+    Args:
+        dirname: Directory holding the bootstage node, as found in
+            /proc/device-tree, with one subdirectory per record
+    Returns:
+        Time of the 'start_kernel' mark in microseconds, or None if there
+        is no such mark
+    """
+    for record in os.listdir(dirname):
+        path = os.path.join(dirname, record)
+        try:
+            with open(os.path.join(path, 'name'), 'rb') as fd:
+                name = fd.read().rstrip(b'\0').decode('utf-8', 'replace')
+            if name != HANDOFF_NAME:
+                continue
+            with open(os.path.join(path, 'mark'), 'rb') as fd:
+                return struct.unpack('>I', fd.read(4))[0]
+        except (IOError, OSError, struct.error):
+            continue
+    return None
+
+def ReadLinux(fname, offset):
+    """Read the initcall timings from a Linux kernel log
+
+    Args:
+        fname: Name of file containing the kernel log
+        offset: Time in microseconds to add to the kernel's timestamps
+    Returns:
+        List of trace events, each a dict
+    """
+    events = [{'name': 'process_name', 'ph': 'M', 'pid': LINUX_PID,
+               'tid': 1, 'args': {'name': 'Linux'}}]
+    calls = {}
+    with open(fname) as fd:
+        for line in fd:
+            m = RE_CALLING.search(line)
+            if m:
+                calls[m.group(2)] = (float(m.group(1)), int(m.group(3)))
+                continue
+            m = RE_RETURNED.search(line)
+            if m:
+                name = m.group(2)
+                dur = int(m.group(4))
+                end = int(float(m.group(1)) * 1000000)
+                start, tid = end - dur, 1
+                if name in calls:
+                    start = int(calls[name][0] * 1000000)
+                    tid = calls.pop(name)[1]
+                events.append({'name': name, 'cat': 'initcall', 'ph': 'X',
+                               'pid': LINUX_PID, 'tid': tid,
+                               'ts': start + offset, 'dur': dur,
+                               'args': {'ret': int(m.group(3))}})
+                continue
+            m = RE_INIT.search(line)
+            if m:
+                events.append({'name': 'init: %s' % m.group(2),
+                               'cat': 'mark', 'ph': 'i', 's': 'p',
+                               'pid': LINUX_PID, 'tid': 1,
+                               'ts': int(float(m.group(1)) * 1000000) +
+                               offset})
+    if len(events) > 1:
+        events.append({'name': 'kernel', 'cat': 'mark', 'ph': 'i', 's': 'p',
+                       'pid': LINUX_PID, 'tid': 1, 'ts': offset})
+    return events
+
+def ShowSlowest(events, count):
+    """Print the events which took the longest
+
+    Args:
+        events: List of trace events
+        count: Number of events to show
+    """
+    spans = [event for event in events if event['ph'] == 'X']
+    spans.sort(key=lambda event: event['dur'], reverse=True)
+    print('%12s %10s  %-6s %s' % ('Start', 'Elapsed', 'Where', 'Name'))
+    for event in spans[:count]:
+        where = 'U-Boot' if event['pid'] == UBOOT_PID else 'Linux'
+        print('%12d %10d  %-6s %s' % (event['ts'], event['dur'], where,
+                                      event['name']))
+
+def BootTimeline():
+    parser = OptionParser()
+    parser.add_option('-u', '--uboot', type='string', action='store',
+                      help="Trace file from U-Boot's 'bootstage export'")
+    parser.add_option('-k', '--kernel', type='string', action='store',
+                      help='Linux kernel log, booted with initcall_debug')
+    parser.add_option('-d', '--devicetree', type='string', action='store',
+                      help="U-Boot's bootstage node from the kernel's device "
+                      'tree, used when the trace has no start_kernel mark '
+                      '(default %s if it exists)' % BOOTSTAGE_NODE)
+    parser.add_option('-t', '--offset', type='int', action='store',
+                      help='Time when Linux started, in microseconds since '
+                      "reset (default is U-Boot's 'start_kernel' mark)")
+    parser.add_option('-o', '--outfile', type='string', action='store',
+                      help='Filename to write the merged trace to (- for '
+                      'stdout)')
+    parser.add_option('-s', '--slowest', type='int', action='store',
+                      default=0, help='Print the N slowest events')
+    (options, args) = parser.parse_args()
+    if args or not (options.uboot or options.kernel):
+        parser.error('Please provide a U-Boot trace and/or a kernel log')
+
+    events = []
+    if options.uboot:
+        events = ReadUboot(options.uboot)
+    if options.kernel:
+        offset = options.offset
+        if offset is None:
+            offset = HandoffTime(events)
+        dtdir = options.devicetree
+        if dtdir is None and os.path.isdir(BOOTSTAGE_NODE):
+            dtdir = BOOTSTAGE_NODE
+        if offset is None and dtdir:
+            offset = HandoffTimeFdt(dtdir)
+            if offset is not None:
+                print("Warning: no '%s' mark in U-Boot trace, using %d us "
+                      'from %s' % (HANDOFF_NAME, offset, dtdir),
+                      file=sys.stderr)
+        if offset is None:
+            parser.error("Cannot tell when Linux started: no '%s' mark in "
+                         'the U-Boot trace or bootstage node; please use -t' %
+                         HANDOFF_NAME)
+        events += ReadLinux(options.kernel, offset)
+
+    if options.outfile:
+        trace = {'traceEvents': events, 'displayTimeUnit': 'ms'}
+        if options.outfile == '-':
+            json.dump(trace, sys.stdout, indent=0)
+        else:
+            with open(options.outfile, 'w') as fd:
+                json.dump(trace, fd, indent=0)
+    if options.slowest:
+        ShowSlowest(events, options.slowest)
+
+if __name__ == "__main__":
+    BootTimeline()